@@ -0,0 +1,576 @@
+#include "brushes.h"
+#include "noise.h"
+#include "stamp.h"
+#include "terrainio.h"
+#include "terrainmesh.h"
+#include "threadpool.h"
+#include "tiledheightfield.h"
+#include "undohistory.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <map>
+#include <vector>
+
+// =================================================================
+// === HEIGHTMAP BENCH
+// =================================================================
+// heightmap_bench [opciones]: mide las rutas calientes de heightmap_core
+// (generación por tipo de ruido, pinceles por pincelada, mallas de la
+// vista 3D, exportación/importación y deshacer) y escribe el resultado
+// en JSON. Con --baseline compara las medianas con una ejecución
+// anterior y termina con error si alguna empeora más de la tolerancia.
+
+namespace {
+
+enum ExitCode {
+    ExitOk = 0,
+    ExitUsage = 1,
+    ExitFailure = 2,
+    ExitRegression = 3
+};
+
+// Cada caso se repite hasta sumar el tiempo mínimo y al menos
+// MinIterations veces, salvo que una sola pasada ya supere SlowCaseMs
+const int MinIterations = 3;
+const int MaxIterations = 100000;
+const double SlowCaseMs = 2000.0;
+
+const unsigned BenchSeed = 1234;
+
+struct Result {
+    QString name;
+    int iterations = 0;
+    double meanUs = 0.0;
+    double medianUs = 0.0;
+    double minUs = 0.0;
+};
+
+class Bench
+{
+public:
+    Bench(const QString &filter, double minTimeMs, QTextStream &log)
+        : m_filter(filter), m_minTimeMs(minTimeMs), m_log(log) {}
+
+    // true si el caso (o grupo) pasa el filtro de --filter
+    bool selected(const QString &name) const
+    {
+        return m_filter.isEmpty() || name.contains(m_filter);
+    }
+
+    // Mide body() por iteración; setup() se ejecuta antes de cada una
+    // fuera del tiempo medido
+    void run(const QString &name, const std::function<void()> &body,
+             const std::function<void()> &setup = {})
+    {
+        if (!selected(name)) return;
+
+        using Clock = std::chrono::steady_clock;
+        std::vector<double> samples;
+        double totalMs = 0.0;
+
+        while (static_cast<int>(samples.size()) < MaxIterations
+               && (static_cast<int>(samples.size()) < MinIterations || totalMs < m_minTimeMs)) {
+            if (setup) setup();
+
+            const auto start = Clock::now();
+            body();
+            const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+            samples.push_back(us);
+            totalMs += us / 1000.0;
+            if (totalMs >= SlowCaseMs) break;
+        }
+
+        Result result;
+        result.name = name;
+        result.iterations = static_cast<int>(samples.size());
+        double sum = 0.0;
+        for (double us : samples) sum += us;
+        result.meanUs = sum / samples.size();
+        std::sort(samples.begin(), samples.end());
+        result.medianUs = samples[samples.size() / 2];
+        result.minUs = samples.front();
+        m_results.push_back(result);
+
+        m_log << name << ": " << QString::number(result.medianUs, 'f', 1) << " us (x"
+              << result.iterations << ")\n";
+        m_log.flush();
+    }
+
+    const std::vector<Result> &results() const { return m_results; }
+
+private:
+    QString m_filter;
+    double m_minTimeMs;
+    QTextStream &m_log;
+    std::vector<Result> m_results;
+};
+
+// Mapa de prueba con el mismo terreno en cada ejecución
+TiledHeightField makeTerrain(int size, HeightFormat format)
+{
+    NoiseContext ctx;
+    ctx.reseed(BenchSeed);
+    TiledHeightField field(size, size, format, 0.0f);
+    Noise::generate(field, ctx, NoiseType::Perlin, Noise::terrainBaseFrequency(size, size, 8.0));
+    return field;
+}
+
+// Posiciones de pincelada deterministas repartidas por el mapa
+struct DabCursor {
+    explicit DabCursor(int size) : m_size(size) {}
+
+    int next()
+    {
+        m_state = m_state * 1103515245u + 12345u;
+        return static_cast<int>((m_state >> 8) % static_cast<unsigned>(m_size));
+    }
+
+private:
+    int m_size;
+    unsigned m_state = BenchSeed;
+};
+
+// =================================================================
+// === CASOS
+// =================================================================
+
+void benchNoise(Bench &bench, const std::vector<int> &sizes, const std::vector<int> &octaves, HeightFormat format)
+{
+    for (const NoiseName &entry : Noise::noiseNames()) {
+        for (int size : sizes) {
+            for (int octaveCount : octaves) {
+                const QString name = QString("noise/%1/%2/o%3").arg(entry.name).arg(size).arg(octaveCount);
+                if (!bench.selected(name)) continue;
+
+                NoiseContext ctx;
+                ctx.reseed(BenchSeed);
+                ctx.octaves = octaveCount;
+                TiledHeightField field(size, size, format, 0.0f);
+                const double baseFrequency = Noise::terrainBaseFrequency(size, size, 8.0);
+
+                bench.run(name, [&] { Noise::generate(field, ctx, entry.type, baseFrequency); });
+            }
+        }
+    }
+}
+
+void benchBrushes(Bench &bench, int size, const std::vector<int> &radii, HeightFormat format)
+{
+    // Los mapas se preparan con el primer caso que pase el filtro
+    TiledHeightField field;
+    auto prepare = [&] { if (field.empty()) field = makeTerrain(size, format); };
+    NoiseContext ctx;
+    ctx.reseed(BenchSeed);
+
+    // Una iteración = una pincelada en una posición nueva
+    for (int radius : radii) {
+        DabCursor cursor(size);
+        bench.run(QString("brush/raise/r%1").arg(radius), [&] {
+            Brushes::raiseLower(field, cursor.next(), cursor.next(), radius, 200.0, 0.3);
+        }, prepare);
+        bench.run(QString("brush/smooth/r%1").arg(radius), [&] {
+            Brushes::smooth(field, cursor.next(), cursor.next(), radius);
+        }, prepare);
+        bench.run(QString("brush/smooth-gaussian-k8/r%1").arg(radius), [&] {
+            Brushes::smooth(field, cursor.next(), cursor.next(), radius, 0.3, Brushes::SmoothKernel::Gaussian, 8);
+        }, prepare);
+        bench.run(QString("brush/flatten/r%1").arg(radius), [&] {
+            Brushes::flatten(field, cursor.next(), cursor.next(), radius, 128.0);
+        }, prepare);
+        bench.run(QString("brush/noise/r%1").arg(radius), [&] {
+            Brushes::noise(field, ctx, cursor.next(), cursor.next(), radius);
+        }, prepare);
+        // Un arrastre de 512 muestras en 8 eventos, pinceladas cada r / 4
+        // (el espaciado por defecto de la interfaz)
+        bench.run(QString("brush/stroke/512/r%1").arg(radius), [&] {
+            const int x = cursor.next();
+            const int y = cursor.next();
+            StrokeInterpolator stroke;
+            auto dab = [&](int dabX, int dabY) { Brushes::raiseLower(field, dabX, dabY, radius, 200.0, 0.3); };
+            stroke.begin(x, y, std::max(1.0, radius * 0.25), dab);
+            for (int step = 1; step <= 8; ++step) {
+                stroke.moveTo(x + step * 64 * 0.8, y + step * 64 * 0.6, dab);
+            }
+        }, prepare);
+    }
+
+    // Formas: una línea y un rectángulo de 256 muestras y un círculo de radio 100
+    DabCursor cursor(size - 256);
+    bench.run("brush/line/256/r10", [&] {
+        const int x = cursor.next();
+        const int y = cursor.next();
+        Brushes::line(field, x, y, x + 256, y + 128, 10, 200.0, 0.5);
+    }, prepare);
+    bench.run("brush/circle/100/r5", [&] {
+        Brushes::circle(field, size / 2, size / 2, 100, 5, 200.0, 0.5);
+    }, prepare);
+    bench.run("brush/rectangle/256/r10", [&] {
+        const int x = cursor.next();
+        const int y = cursor.next();
+        Brushes::rectangle(field, x, y, x + 256, y + 128, 10, 200.0, 0.5);
+    }, prepare);
+
+    // Relleno del mapa completo, alternando el nivel para que siempre cubra todo
+    TiledHeightField flat;
+    double level = 0.0;
+    bench.run(QString("brush/fill/%1").arg(size), [&] {
+        level = level == 0.0 ? 255.0 : 0.0;
+        Brushes::fill(flat, 0, 0, level);
+    }, [&] { if (flat.empty()) flat.assign(size, size, format, 0.0f); });
+}
+
+void benchMesh(Bench &bench, const std::vector<int> &sizes, HeightFormat format)
+{
+    const std::vector<std::vector<QColor>> noColors;
+    std::vector<TerrainMesh::Vertex> vertices;
+    std::vector<float> waterVertices;
+    std::vector<unsigned int> waterIndices;
+
+    for (int size : sizes) {
+        HeightField field;
+        auto prepare = [&] { if (field.empty()) field = makeTerrain(size, format).region(0, 0, size, size); };
+
+        bench.run(QString("mesh/terrain/%1").arg(size), [&] {
+            TerrainMesh::buildTerrain(field, noColors, vertices);
+        }, prepare);
+        // Un pincel de 64x64 sobre la malla ya construida: cuesta lo que
+        // el pincel, no lo que el mapa
+        std::vector<TerrainMesh::Vertex> meshVertices;
+        DabCursor cursor(std::max(1, size - 64));
+        bench.run(QString("mesh/terrain-update/%1").arg(size), [&] {
+            const int x = cursor.next();
+            const int y = cursor.next();
+            TerrainMesh::updateTerrain(field, noColors, QRect(x, y, 64, 64), meshVertices);
+        }, [&] {
+            prepare();
+            if (meshVertices.empty()) TerrainMesh::buildTerrain(field, noColors, meshVertices);
+        });
+        // Cámara cerca del suelo, como al recorrer la vista 3D
+        std::vector<TerrainMesh::Chunk> chunks;
+        std::vector<int> visible;
+        QMatrix4x4 mvp;
+        mvp.perspective(45.0f, 4.0f / 3.0f, 0.1f, 1000.0f);
+        mvp.translate(0.0f, -30.0f, -100.0f);
+        mvp.rotate(30.0f, 1.0f, 0.0f, 0.0f);
+        mvp.translate(-size / 2.0f, 0.0f, -size / 2.0f);
+        bench.run(QString("mesh/chunks/%1").arg(size), [&] {
+            TerrainMesh::buildChunks(field, chunks);
+        }, prepare);
+        bench.run(QString("mesh/cull/%1").arg(size), [&] {
+            TerrainMesh::visibleChunks(chunks, mvp, visible);
+        }, [&] {
+            prepare();
+            if (chunks.empty()) TerrainMesh::buildChunks(field, chunks);
+        });
+        // Misma cámara con detalle por distancia: los nodos dependen de
+        // los rangos y no del tamaño del mapa
+        TerrainMesh::LodPyramid pyramid;
+        std::vector<TerrainMesh::LodNode> nodes;
+        bench.run(QString("mesh/lod-select/%1").arg(size), [&] {
+            const std::vector<float> ranges = TerrainMesh::lodRanges(pyramid, 2.0f, 600, 45.0f);
+            TerrainMesh::selectLod(pyramid, mvp, QVector3D(size / 2.0f, 80.0f, size / 2.0f + 100.0f), ranges, nodes);
+        }, [&] {
+            prepare();
+            if (chunks.empty()) TerrainMesh::buildChunks(field, chunks);
+            if (pyramid.levels.empty()) TerrainMesh::buildLodPyramid(field, chunks, pyramid);
+        });
+        bench.run(QString("mesh/water/%1").arg(size), [&] {
+            TerrainMesh::buildWater(field, 50.0f, QVector3D(0.2f, 0.4f, 0.8f), waterVertices, waterIndices);
+        }, prepare);
+    }
+}
+
+bool benchIO(Bench &bench, const std::vector<int> &sizes, HeightFormat format, QTextStream &err)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err << "No se pudo crear el directorio temporal.\n";
+        return false;
+    }
+
+    bool ok = true;
+    auto check = [&](bool done, const QString &fileName) {
+        if (!done && ok) {
+            err << "Fallo de E/S en " << fileName << "\n";
+            ok = false;
+        }
+    };
+
+    for (int size : sizes) {
+        TiledHeightField field;
+        QImage texture;
+        auto prepare = [&] {
+            if (field.empty()) {
+                field = makeTerrain(size, format);
+                texture = TerrainIO::grayscaleImage(field);
+            }
+        };
+        const QString obj = dir.filePath(QString("bench%1.obj").arg(size));
+        const QString stl = dir.filePath(QString("bench%1.stl").arg(size));
+        const QString stlAscii = dir.filePath(QString("bench%1_ascii.stl").arg(size));
+        const QString hmt = dir.filePath(QString("bench%1.hmt").arg(size));
+        const QString png = dir.filePath(QString("bench%1.png").arg(size));
+
+        auto exportObj = [&] { check(TerrainIO::exportObj(field, obj), obj); };
+        auto exportStlAscii = [&] { check(TerrainIO::exportStl(field, stlAscii, false), stlAscii); };
+        auto exportHmt = [&] { check(TerrainIO::saveHmtProject(field, texture, hmt), hmt); };
+
+        bench.run(QString("export/png/%1").arg(size), [&] { check(TerrainIO::savePng(field, png), png); }, prepare);
+        bench.run(QString("export/obj/%1").arg(size), exportObj, prepare);
+        bench.run(QString("export/stl-binary/%1").arg(size), [&] {
+            check(TerrainIO::exportStl(field, stl, true), stl);
+        }, prepare);
+        bench.run(QString("export/stl-ascii/%1").arg(size), exportStlAscii, prepare);
+        bench.run(QString("export/hmt/%1").arg(size), exportHmt, prepare);
+
+        // Las importaciones leen lo exportado (que se escribe aquí si
+        // el filtro dejó fuera la exportación)
+        auto prepareFile = [&](const QString &fileName, const std::function<void()> &write) {
+            return [&, fileName, write] {
+                if (!QFile::exists(fileName)) {
+                    prepare();
+                    write();
+                }
+            };
+        };
+        TiledHeightField imported;
+        bench.run(QString("import/obj/%1").arg(size), [&] {
+            check(TerrainIO::importMesh(obj, format, imported) == TerrainIO::ImportResult::Ok, obj);
+        }, prepareFile(obj, exportObj));
+        bench.run(QString("import/stl-ascii/%1").arg(size), [&] {
+            check(TerrainIO::importMesh(stlAscii, format, imported) == TerrainIO::ImportResult::Ok, stlAscii);
+        }, prepareFile(stlAscii, exportStlAscii));
+        bench.run(QString("import/hmt/%1").arg(size), [&] {
+            QImage loadedTexture;
+            check(TerrainIO::loadHmtProject(hmt, imported, &loadedTexture), hmt);
+        }, prepareFile(hmt, exportHmt));
+
+        for (const QString &fileName : { obj, stl, stlAscii, hmt, png }) {
+            QFile::remove(fileName);
+        }
+    }
+    return ok;
+}
+
+void benchUndo(Bench &bench, const std::vector<int> &sizes, HeightFormat format)
+{
+    for (int size : sizes) {
+        TiledHeightField field;
+        auto prepare = [&] { if (field.empty()) field = makeTerrain(size, format); };
+        UndoHistory history;
+
+        bench.run(QString("undo/save/%1").arg(size), [&] { history.save(field); }, prepare);
+        bench.run(QString("undo/undo-redo/%1").arg(size), [&] {
+            history.undo(field);
+            history.redo(field);
+        }, [&] {
+            prepare();
+            if (!history.canUndo()) history.save(field);
+        });
+
+        // Paso por tiles de un trazo de 512 muestras con radio 20: el coste
+        // depende de los tiles tocados, no del mapa
+        DabCursor cursor(std::max(1, size - 512));
+        bench.run(QString("undo/stroke-step/%1").arg(size), [&] {
+            const int x = cursor.next();
+            const int y = cursor.next();
+            history.begin(field);
+            for (int i = 0; i <= 512; i += 5) {
+                Brushes::raiseLower(field, x + i, y + i / 2, 20, 200.0, 0.3);
+            }
+            history.commit();
+        }, prepare);
+        bench.run(QString("undo/stroke-undo-redo/%1").arg(size), [&] {
+            history.undo(field);
+            history.redo(field);
+        }, [&] {
+            prepare();
+            if (!history.canUndo()) {
+                history.begin(field);
+                Brushes::raiseLower(field, size / 2, size / 2, 20, 200.0, 0.3);
+                history.commit();
+            }
+        });
+        // Pasos ya comprimidos (más allá de los recientes): deshacer los
+        // descomprime y rehacer los vuelve a mandar al hilo
+        const int packedDepth = UndoHistory::RecentSteps + 1;
+        bench.run(QString("undo/packed-undo-redo/%1").arg(size), [&] {
+            for (int i = 0; i < packedDepth; ++i) history.undo(field);
+            for (int i = 0; i < packedDepth; ++i) history.redo(field);
+        }, [&] {
+            prepare();
+            while (history.undoSteps() < packedDepth) {
+                history.begin(field);
+                Brushes::raiseLower(field, size / 2, size / 2, 20, 200.0, 0.3);
+                history.commit();
+            }
+            history.flush();
+        });
+    }
+}
+
+// =================================================================
+// === JSON
+// =================================================================
+
+QJsonObject toJson(const std::vector<Result> &results, HeightFormat format, bool quick)
+{
+    QJsonArray entries;
+    for (const Result &result : results) {
+        QJsonObject entry;
+        entry["name"] = result.name;
+        entry["iterations"] = result.iterations;
+        entry["mean_us"] = result.meanUs;
+        entry["median_us"] = result.medianUs;
+        entry["min_us"] = result.minUs;
+        entries.append(entry);
+    }
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["simd"] = QString::fromLatin1(Noise::simdPathName());
+    root["threads"] = ThreadPool::instance().threadCount();
+    root["bits"] = bytesPerSample(format) * 8;
+    root["quick"] = quick;
+    root["results"] = entries;
+    return root;
+}
+
+// Compara las medianas con las de la referencia; devuelve cuántos casos
+// empeoran más de la tolerancia (fracción, 0.15 = 15 %)
+int compareWithBaseline(const std::vector<Result> &results, const QJsonObject &baseline, double tolerance,
+                        QTextStream &err)
+{
+    std::map<QString, double> reference;
+    for (const QJsonValue &value : baseline["results"].toArray()) {
+        const QJsonObject entry = value.toObject();
+        reference[entry["name"].toString()] = entry["median_us"].toDouble();
+    }
+
+    int regressions = 0;
+    for (const Result &result : results) {
+        const auto it = reference.find(result.name);
+        if (it == reference.end() || it->second <= 0.0) continue;
+
+        const double ratio = result.medianUs / it->second;
+        if (ratio > 1.0 + tolerance) {
+            err << "REGRESIÓN " << result.name << ": " << QString::number(it->second, 'f', 1) << " -> "
+                << QString::number(result.medianUs, 'f', 1) << " us (+"
+                << QString::number((ratio - 1.0) * 100.0, 'f', 0) << " %)\n";
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("heightmap_bench");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Mide el rendimiento de heightmap_core y escribe el resultado en JSON.");
+    parser.addHelpOption();
+
+    const QCommandLineOption outputOption({ "o", "output" }, "Archivo JSON de salida (por defecto, la salida estándar).",
+                                          "archivo");
+    const QCommandLineOption baselineOption({ "b", "baseline" }, "JSON de una ejecución anterior con el que comparar.",
+                                            "archivo");
+    const QCommandLineOption toleranceOption("tolerance", "Empeoramiento admitido frente a la referencia, en %.",
+                                             "porcentaje", "15");
+    const QCommandLineOption filterOption({ "f", "filter" }, "Sólo los casos cuyo nombre contiene el texto.", "texto");
+    const QCommandLineOption quickOption("quick", "Tamaños pequeños, para comprobar que todo funciona.");
+    const QCommandLineOption minTimeOption("min-time", "Tiempo mínimo por caso, en ms.", "ms", "300");
+    const QCommandLineOption precisionOption("precision", "Bits por altura de los mapas: 8, 16 o 32.", "bits", "8");
+    parser.addOptions({ outputOption, baselineOption, toleranceOption, filterOption, quickOption,
+                        minTimeOption, precisionOption });
+    parser.process(app);
+
+    bool ok = false;
+    const double minTimeMs = parser.value(minTimeOption).toDouble(&ok);
+    if (!ok || minTimeMs < 0.0) {
+        err << "Tiempo mínimo no válido.\n";
+        return ExitUsage;
+    }
+    const double tolerance = parser.value(toleranceOption).toDouble(&ok) / 100.0;
+    if (!ok || tolerance < 0.0) {
+        err << "Tolerancia no válida.\n";
+        return ExitUsage;
+    }
+
+    HeightFormat format;
+    const QString bits = parser.value(precisionOption);
+    if (bits == "8") format = HeightFormat::U8;
+    else if (bits == "16") format = HeightFormat::U16;
+    else if (bits == "32") format = HeightFormat::F32;
+    else {
+        err << "La precisión debe ser 8, 16 o 32.\n";
+        return ExitUsage;
+    }
+
+    QJsonObject baseline;
+    if (parser.isSet(baselineOption)) {
+        QFile file(parser.value(baselineOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "No se pudo abrir la referencia " << file.fileName() << "\n";
+            return ExitUsage;
+        }
+        baseline = QJsonDocument::fromJson(file.readAll()).object();
+        if (!baseline["results"].isArray()) {
+            err << "La referencia no es un resultado de heightmap_bench.\n";
+            return ExitUsage;
+        }
+    }
+
+    // === EJECUCIÓN ===
+    const bool quick = parser.isSet(quickOption);
+    Bench bench(parser.value(filterOption), minTimeMs, err);
+
+    try {
+        benchNoise(bench, quick ? std::vector<int>{ 256 } : std::vector<int>{ 512, 1024, 2048 },
+                   quick ? std::vector<int>{ 1, 6 } : std::vector<int>{ 1, 4, 8 }, format);
+        benchBrushes(bench, quick ? 1024 : 2048, { 5, 20, 50, 100 }, format);
+        benchMesh(bench, quick ? std::vector<int>{ 256 } : std::vector<int>{ 256, 512, 1024 }, format);
+        if (!benchIO(bench, quick ? std::vector<int>{ 256 } : std::vector<int>{ 512, 1024 }, format, err)) {
+            return ExitFailure;
+        }
+        benchUndo(bench, quick ? std::vector<int>{ 512 } : std::vector<int>{ 1024, 4096 }, format);
+    } catch (const std::exception &e) {
+        err << "Error: " << e.what() << "\n";
+        return ExitFailure;
+    }
+
+    // === SALIDA ===
+    const QByteArray json = QJsonDocument(toJson(bench.results(), format, quick)).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            err << "No se pudo escribir " << file.fileName() << "\n";
+            return ExitFailure;
+        }
+    } else {
+        out << json;
+        out.flush();
+    }
+
+    if (!baseline.isEmpty() && compareWithBaseline(bench.results(), baseline, tolerance, err) > 0) {
+        return ExitRegression;
+    }
+    return ExitOk;
+}
@@ -0,0 +1,410 @@
+#include "brushes.h"
+#include "floodfill.h"
+#include "stamp.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Brushes {
+
+namespace {
+
+bool validDab(const TiledHeightField &field, int centerX, int centerY, int &radius)
+{
+    if (radius < 1) radius = 1;
+    return field.contains(centerX, centerY);
+}
+
+QRect clipToField(const TiledHeightField &field, const QRect &rect)
+{
+    return rect & QRect(0, 0, field.width(), field.height());
+}
+
+// Cuadrado que cubre el círculo de radio `radius`, recortado al mapa
+QRect dabRect(const TiledHeightField &field, int centerX, int centerY, int radius)
+{
+    return clipToField(field, QRect(centerX - radius, centerY - radius, 2 * radius + 1, 2 * radius + 1));
+}
+
+} // namespace
+
+QRect raiseLower(TiledHeightField &field, int centerX, int centerY, int radius, double level, double strength,
+                 double hardness)
+{
+    if (!validDab(field, centerX, centerY, radius)) return QRect();
+    const std::shared_ptr<const FalloffMask> mask = FalloffMask::get(radius, hardness);
+
+    // Instancia tipada por formato; la altura objetivo está en escala de nivel
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+        const double goal = level * levelScale<T>();
+
+        stampMask<T>(field, centerX, centerY, *mask, [&](int, int, T &value, float weight) {
+            double currentValue = value;
+            value = HeightTraits<T>::fromValue(currentValue + (goal - currentValue) * weight * strength);
+        });
+    });
+
+    return dabRect(field, centerX, centerY, radius);
+}
+
+// Pesos w[0..2r] del núcleo separable de radio r
+static std::vector<float> smoothWeights(SmoothKernel kernel, int kernelRadius)
+{
+    std::vector<float> weights(2 * kernelRadius + 1, 1.0f);
+    if (kernel == SmoothKernel::Gaussian) {
+        // El radio cubre dos desviaciones típicas
+        const double sigma = kernelRadius / 2.0;
+        for (int k = -kernelRadius; k <= kernelRadius; ++k) {
+            weights[k + kernelRadius] = static_cast<float>(std::exp(-(k * k) / (2.0 * sigma * sigma)));
+        }
+    }
+    return weights;
+}
+
+QRect smooth(TiledHeightField &field, int centerX, int centerY, int radius, double strength,
+             SmoothKernel kernel, int kernelRadius, double hardness)
+{
+    if (!validDab(field, centerX, centerY, radius)) return QRect();
+    const std::shared_ptr<const FalloffMask> mask = FalloffMask::get(radius, hardness);
+    kernelRadius = std::clamp(kernelRadius, 1, MaxSmoothKernelRadius);
+
+    // Salida: el cuadrado del pincel. Entrada: una copia local de esa zona
+    // más el radio del núcleo, así que los promedios nunca leen valores
+    // ya modificados y nada depende del tamaño del mapa
+    const QRect dab = dabRect(field, centerX, centerY, radius);
+    const QRect scratchRect = clipToField(field, dab.adjusted(-kernelRadius, -kernelRadius,
+                                                             kernelRadius, kernelRadius));
+    const HeightField scratch = field.region(scratchRect.x(), scratchRect.y(),
+                                             scratchRect.width(), scratchRect.height());
+
+    const int scratchWidth = scratchRect.width();
+    const int scratchHeight = scratchRect.height();
+    const int outWidth = dab.width();
+    const int outHeight = dab.height();
+    const int offsetX = dab.x() - scratchRect.x();
+    const int offsetY = dab.y() - scratchRect.y();
+
+    const std::vector<float> weights = smoothWeights(kernel, kernelRadius);
+
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+
+        // Copia en float de la zona de entrada
+        std::vector<float> source(static_cast<std::size_t>(scratchWidth) * scratchHeight);
+        for (int y = 0; y < scratchHeight; ++y) {
+            const T *row = scratch.row<T>(y);
+            float *dst = source.data() + static_cast<std::size_t>(y) * scratchWidth;
+            for (int x = 0; x < scratchWidth; ++x) dst[x] = static_cast<float>(row[x]);
+        }
+
+        // Pasada horizontal sobre todas las filas de entrada, sólo en las
+        // columnas de salida. Cada peso es un bucle contiguo sobre la fila
+        // (vectorizable); en los bordes del mapa sólo cuentan las muestras
+        // que existen, y normX guarda la suma de sus pesos
+        std::vector<float> horizontal(static_cast<std::size_t>(outWidth) * scratchHeight, 0.0f);
+        std::vector<float> normX(outWidth, 0.0f);
+        for (int k = -kernelRadius; k <= kernelRadius; ++k) {
+            const float w = weights[k + kernelRadius];
+            const int begin = std::max(0, -offsetX - k);
+            const int end = std::min(outWidth, scratchWidth - offsetX - k);
+            for (int c = begin; c < end; ++c) normX[c] += w;
+
+            for (int y = 0; y < scratchHeight; ++y) {
+                const float *src = source.data() + static_cast<std::size_t>(y) * scratchWidth + offsetX + k;
+                float *acc = horizontal.data() + static_cast<std::size_t>(y) * outWidth;
+                for (int c = begin; c < end; ++c) acc[c] += w * src[c];
+            }
+        }
+
+        // Pasada vertical, fila a fila de salida
+        std::vector<float> average(static_cast<std::size_t>(outWidth) * outHeight, 0.0f);
+        for (int r = 0; r < outHeight; ++r) {
+            float *acc = average.data() + static_cast<std::size_t>(r) * outWidth;
+            float normY = 0.0f;
+            for (int k = -kernelRadius; k <= kernelRadius; ++k) {
+                const int sy = offsetY + r + k;
+                if (sy < 0 || sy >= scratchHeight) continue;
+
+                const float w = weights[k + kernelRadius];
+                const float *src = horizontal.data() + static_cast<std::size_t>(sy) * outWidth;
+                for (int c = 0; c < outWidth; ++c) acc[c] += w * src[c];
+                normY += w;
+            }
+            for (int c = 0; c < outWidth; ++c) acc[c] /= normX[c] * normY;
+        }
+
+        stampMask<T>(field, centerX, centerY, *mask, [&](int x, int y, T &value, float weight) {
+            const double target = average[static_cast<std::size_t>(y - dab.y()) * outWidth + (x - dab.x())];
+            const double currentValue = source[static_cast<std::size_t>(y - scratchRect.y()) * scratchWidth
+                                               + (x - scratchRect.x())];
+            value = HeightTraits<T>::fromValue(currentValue + (target - currentValue) * weight * strength);
+        });
+    });
+
+    return dab;
+}
+
+QRect flatten(TiledHeightField &field, int centerX, int centerY, int radius, double level, double strength,
+              double hardness)
+{
+    if (!validDab(field, centerX, centerY, radius)) return QRect();
+    const std::shared_ptr<const FalloffMask> mask = FalloffMask::get(radius, hardness);
+
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+        const double goal = level * levelScale<T>();
+
+        stampMask<T>(field, centerX, centerY, *mask, [&](int, int, T &value, float weight) {
+            double currentValue = value;
+            value = HeightTraits<T>::fromValue(currentValue + (goal - currentValue) * weight * strength);
+        });
+    });
+
+    return dabRect(field, centerX, centerY, radius);
+}
+
+QRect noise(TiledHeightField &field, const NoiseContext &ctx, int centerX, int centerY, int radius, double strength,
+            double hardness)
+{
+    if (!validDab(field, centerX, centerY, radius) || !ctx.isSeeded()) return QRect();
+    const std::shared_ptr<const FalloffMask> mask = FalloffMask::get(radius, hardness);
+
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+
+        stampMask<T>(field, centerX, centerY, *mask, [&](int x, int y, T &value, float weight) {
+            // Ruido en esta posición (cuantizado como el generador)
+            double noiseValue = Noise::perlin(ctx, x * 0.1, y * 0.1);
+            double noiseHeight = HeightTraits<T>::fromNoise(noiseValue);
+
+            double currentValue = value;
+            value = HeightTraits<T>::fromValue(currentValue + (noiseHeight - currentValue) * weight * strength);
+        });
+    });
+
+    return dabRect(field, centerX, centerY, radius);
+}
+
+QRect fill(TiledHeightField &field, int x, int y, double level, double tolerance)
+{
+    if (!field.contains(x, y)) return QRect();
+
+    QRect dirty;
+
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+
+        // Valor original de la muestra pulsada y margen, en el formato del mapa
+        const T targetColor = field.at<T>(x, y);
+        const T fillColor = HeightTraits<T>::fromValue(level * levelScale<T>());
+        const double margin = std::max(0.0, tolerance) * levelScale<T>();
+
+        // Si el valor de relleno es igual al objetivo, no hacer nada
+        if (targetColor == fillColor && margin == 0.0) return;
+
+        // Intervalo [low, high] de valores que pertenecen a la región, en T
+        // para que la comparación se vectorice
+        double low = targetColor - margin;
+        double high = targetColor + margin;
+        if (std::is_integral<T>::value) {
+            low = std::max(0.0, std::ceil(low));
+            high = std::min(HeightTraits<T>::maxValue, std::floor(high));
+        }
+        const T lowValue = static_cast<T>(low);
+        const T highValue = static_cast<T>(high);
+
+        // Las palabras de 64 muestras nunca cruzan un tile
+        static_assert(TiledHeightField::TileSize % 64 == 0, "FloodFill lee palabras dentro de un tile");
+
+        dirty = FloodFill::fill(field.width(), field.height(), x, y,
+            [&](int py, int x0, int count) {
+                const T *samples = &field.at<T>(x0, py);
+                return FloodFill::packBits(count, [&](int i) {
+                    return samples[i] >= lowValue && samples[i] <= highValue;
+                });
+            },
+            [&](int py, int x0, int x1) {
+                field.forEachSpan<T>(x0, py, x1 + 1, py + 1, [&](int, int, T *span, int count) {
+                    std::fill(span, span + count, fillColor);
+                });
+            });
+    });
+
+    return dirty;
+}
+
+QRect blend(TiledHeightField &field, int x, int y, double level, double t)
+{
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+        T &value = field.at<T>(x, y);
+        const double currentValue = value;
+        value = HeightTraits<T>::fromValue(currentValue + (level * levelScale<T>() - currentValue) * t);
+    });
+
+    return QRect(x, y, 1, 1);
+}
+
+// =================================================================
+// === FORMAS
+// =================================================================
+
+namespace {
+
+// Dibuja un trazo de grosor brushRadius alrededor de una forma en una
+// sola pasada: cada muestra a distancia d <= r del trazo se mezcla una
+// vez hacia goal con intensity * (1 - d² / r²), la caída de los
+// pinceles con dureza 0. spans(y, emit) llama a emit(x0, x1) con los
+// tramos disjuntos de la fila y que pueden quedar a menos de r del
+// trazo; distance(x, y) es la distancia al trazo.
+template <typename T, typename Spans, typename Distance>
+void rasterizeStroke(TiledHeightField &field, int y0, int y1, int brushRadius, double goal, double intensity,
+                     Spans &&spans, Distance &&distance)
+{
+    const double radius = brushRadius;
+    y0 = std::max(0, y0);
+    y1 = std::min(field.height() - 1, y1);
+
+    for (int y = y0; y <= y1; ++y) {
+        spans(y, [&](int x0, int x1) {
+            field.forEachSpan<T>(x0, y, x1 + 1, y + 1, [&](int, int spanX, T *samples, int count) {
+                for (int i = 0; i < count; ++i) {
+                    const double d = distance(spanX + i, y);
+                    if (d > radius) continue;
+
+                    const double t = d / radius;
+                    const double currentValue = samples[i];
+                    samples[i] = HeightTraits<T>::fromValue(currentValue + (goal - currentValue)
+                                                            * (1.0 - t * t) * intensity);
+                }
+            });
+        });
+    }
+}
+
+// Distancia de (px, py) al segmento (x1, y1)-(x2, y2)
+double segmentDistance(double px, double py, double x1, double y1, double x2, double y2)
+{
+    const double dx = x2 - x1;
+    const double dy = y2 - y1;
+    const double lengthSq = dx * dx + dy * dy;
+    double t = 0.0;
+    if (lengthSq > 0.0) {
+        t = std::clamp(((px - x1) * dx + (py - y1) * dy) / lengthSq, 0.0, 1.0);
+    }
+    return std::hypot(px - (x1 + t * dx), py - (y1 + t * dy));
+}
+
+} // namespace
+
+QRect line(TiledHeightField &field, int x1, int y1, int x2, int y2, int brushRadius, double level, double intensity)
+{
+    if (brushRadius < 1) brushRadius = 1;
+    const double radius = brushRadius;
+
+    // Tramo de la fila y: la parte del segmento con |py - y| <= r,
+    // ensanchada r a cada lado (los extremos quedan dentro al recortar t)
+    auto spans = [&](int y, auto &&emit) {
+        double t0 = 0.0;
+        double t1 = 1.0;
+        if (y1 != y2) {
+            t0 = std::clamp((y - radius - y1) / static_cast<double>(y2 - y1), 0.0, 1.0);
+            t1 = std::clamp((y + radius - y1) / static_cast<double>(y2 - y1), 0.0, 1.0);
+        }
+        const double xa = x1 + (x2 - x1) * t0;
+        const double xb = x1 + (x2 - x1) * t1;
+        emit(static_cast<int>(std::floor(std::min(xa, xb) - radius)),
+             static_cast<int>(std::ceil(std::max(xa, xb) + radius)));
+    };
+
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+        rasterizeStroke<T>(field, std::min(y1, y2) - brushRadius, std::max(y1, y2) + brushRadius, brushRadius,
+                           level * levelScale<T>(), intensity, spans, [&](int x, int y) {
+                               return segmentDistance(x, y, x1, y1, x2, y2);
+                           });
+    });
+
+    return clipToField(field, QRect(QPoint(std::min(x1, x2) - brushRadius, std::min(y1, y2) - brushRadius),
+                                    QPoint(std::max(x1, x2) + brushRadius, std::max(y1, y2) + brushRadius)));
+}
+
+QRect rectangle(TiledHeightField &field, int x1, int y1, int x2, int y2, int brushRadius, double level,
+                double intensity)
+{
+    if (brushRadius < 1) brushRadius = 1;
+    const int minX = std::min(x1, x2);
+    const int maxX = std::max(x1, x2);
+    const int minY = std::min(y1, y2);
+    const int maxY = std::max(y1, y2);
+
+    // Cerca de los lados superior e inferior, la fila entera; entre
+    // ellos, sólo las franjas de los lados izquierdo y derecho
+    auto spans = [&](int y, auto &&emit) {
+        if (y <= minY + brushRadius || y >= maxY - brushRadius || maxX - minX <= 2 * brushRadius) {
+            emit(minX - brushRadius, maxX + brushRadius);
+        } else {
+            emit(minX - brushRadius, minX + brushRadius);
+            emit(maxX - brushRadius, maxX + brushRadius);
+        }
+    };
+
+    // Distancia al contorno: fuera, al rectángulo; dentro, al lado más cercano
+    auto distance = [&](int x, int y) {
+        const int outsideX = std::max({ minX - x, 0, x - maxX });
+        const int outsideY = std::max({ minY - y, 0, y - maxY });
+        if (outsideX > 0 || outsideY > 0) return std::hypot(outsideX, outsideY);
+        return static_cast<double>(std::min({ x - minX, maxX - x, y - minY, maxY - y }));
+    };
+
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+        rasterizeStroke<T>(field, minY - brushRadius, maxY + brushRadius, brushRadius, level * levelScale<T>(),
+                           intensity, spans, distance);
+    });
+
+    return clipToField(field, QRect(QPoint(minX - brushRadius, minY - brushRadius),
+                                    QPoint(maxX + brushRadius, maxY + brushRadius)));
+}
+
+QRect circle(TiledHeightField &field, int centerX, int centerY, int radius, int brushRadius, double level,
+             double intensity)
+{
+    if (brushRadius < 1) brushRadius = 1;
+    radius = std::max(radius, 0);
+    const double outer = radius + brushRadius;
+    const double inner = radius - brushRadius;
+
+    // Corona entre los radios inner y outer: dos tramos por fila mientras
+    // la fila corta el círculo interior, uno en el resto
+    auto spans = [&](int y, auto &&emit) {
+        const double dy = y - centerY;
+        if (std::abs(dy) > outer) return;
+        const int outerX = static_cast<int>(std::floor(std::sqrt(outer * outer - dy * dy)));
+        if (inner > 0.0 && std::abs(dy) < inner) {
+            const int innerX = static_cast<int>(std::ceil(std::sqrt(inner * inner - dy * dy)));
+            emit(centerX - outerX, centerX - innerX);
+            emit(centerX + innerX, centerX + outerX);
+        } else {
+            emit(centerX - outerX, centerX + outerX);
+        }
+    };
+
+    dispatchHeightFormat(field.format(), [&](auto tag) {
+        using T = decltype(tag);
+        rasterizeStroke<T>(field, centerY - radius - brushRadius, centerY + radius + brushRadius, brushRadius,
+                           level * levelScale<T>(), intensity, spans, [&](int x, int y) {
+                               return std::abs(std::hypot(x - centerX, y - centerY) - radius);
+                           });
+    });
+
+    const int reach = radius + brushRadius;
+    return clipToField(field, QRect(centerX - reach, centerY - reach, 2 * reach + 1, 2 * reach + 1));
+}
+
+} // namespace Brushes
@@ -0,0 +1,65 @@
+#ifndef BRUSHES_H
+#define BRUSHES_H
+
+#include <QRect>
+#include "noise.h"
+#include "tiledheightfield.h"
+
+// =================================================================
+// === BRUSHES
+// =================================================================
+// Operaciones de edición sobre el mapa, sin dependencias de interfaz.
+// Los niveles están en la escala común 0..255; cada pincel trabaja en
+// el formato del mapa y sólo recorre los tiles bajo su área.
+//
+// Los pinceles circulares aplican una máscara de caída precalculada
+// (FalloffMask, en stamp.h) y mezclan cada muestra hacia su objetivo en
+// peso * strength. Con dureza 0 la caída es 1 - d² / r² desde el
+// centro; al subirla, el núcleo de peso 1 crece hasta el borde.
+//
+// Todas devuelven el rectángulo de muestras que pueden haber cambiado
+// (recortado al mapa; vacío si no tocaron nada), para refrescar sólo
+// esa zona de la vista.
+
+namespace Brushes {
+
+// Acerca las alturas al nivel indicado
+QRect raiseLower(TiledHeightField &field, int centerX, int centerY, int radius, double level, double strength,
+                 double hardness = 0.0);
+// Suavizado con un núcleo separable (caja o gaussiano) de radio
+// kernelRadius, calculado sobre una copia local de la zona del pincel;
+// el coste depende del pincel y del núcleo, no del mapa
+enum class SmoothKernel {
+    Box,
+    Gaussian
+};
+constexpr int MaxSmoothKernelRadius = 32;
+QRect smooth(TiledHeightField &field, int centerX, int centerY, int radius, double strength = 0.3,
+             SmoothKernel kernel = SmoothKernel::Box, int kernelRadius = 1, double hardness = 0.0);
+QRect flatten(TiledHeightField &field, int centerX, int centerY, int radius, double level, double strength = 0.1,
+              double hardness = 0.0);
+// Ruido Perlin a escala fija (0.1 por muestra)
+QRect noise(TiledHeightField &field, const NoiseContext &ctx, int centerX, int centerY, int radius,
+            double strength = 0.15, double hardness = 0.0);
+
+// Relleno por inundación (4-conectividad, por tramos de fila) de las
+// muestras que no se apartan más de tolerance (en escala de nivel) de
+// la de (x, y); con 0, sólo las iguales
+QRect fill(TiledHeightField &field, int x, int y, double level, double tolerance = 0.0);
+
+// Mezcla una sola muestra hacia level en la fracción t
+QRect blend(TiledHeightField &field, int x, int y, double level, double t);
+
+// === FORMAS ===
+// Trazos de grosor brushRadius alrededor de la forma, rasterizados en
+// una pasada por distancia al trazo: cada muestra se mezcla una sola
+// vez con intensity * (1 - d² / r²), sin acumular pinceladas solapadas
+QRect line(TiledHeightField &field, int x1, int y1, int x2, int y2, int brushRadius, double level, double intensity);
+QRect rectangle(TiledHeightField &field, int x1, int y1, int x2, int y2, int brushRadius, double level,
+                double intensity);
+QRect circle(TiledHeightField &field, int centerX, int centerY, int radius, int brushRadius, double level,
+             double intensity);
+
+} // namespace Brushes
+
+#endif // BRUSHES_H
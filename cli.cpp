@@ -0,0 +1,8 @@
+#include "headless.h"
+
+// heightmap_cli: el modo sin interfaz como ejecutable propio, enlazado
+// sólo con heightmap_core (sin Qt Widgets ni OpenGL)
+int main(int argc, char *argv[])
+{
+    return Headless::run(argc, argv);
+}
@@ -0,0 +1,52 @@
+#include "floodfill.h"
+
+void FillMask::reset(int width, int height)
+{
+    if (width != m_width || height != static_cast<int>(m_rows.size())) {
+        m_width = width;
+        m_rows.assign(height, {});
+        m_rowTouched.assign(height, 0);
+        m_touchedRows.clear();
+        return;
+    }
+
+    for (int y : m_touchedRows) {
+        std::fill(m_rows[y].begin(), m_rows[y].end(), 0);
+        m_rowTouched[y] = 0;
+    }
+    m_touchedRows.clear();
+}
+
+std::uint64_t *FillMask::row(int y)
+{
+    std::vector<std::uint64_t> &bits = m_rows[y];
+    if (bits.empty()) bits.assign((m_width + 63) / 64, 0);
+    return bits.data();
+}
+
+void FillMask::setSpan(int y, int x0, int x1)
+{
+    std::uint64_t *row = this->row(y);
+    if (!m_rowTouched[y]) {
+        m_rowTouched[y] = 1;
+        m_touchedRows.push_back(y);
+    }
+
+    const int firstWord = x0 >> 6;
+    const int lastWord = x1 >> 6;
+    const std::uint64_t firstBits = ~std::uint64_t(0) << (x0 & 63);
+    const std::uint64_t lastBits = ~std::uint64_t(0) >> (63 - (x1 & 63));
+    if (firstWord == lastWord) {
+        row[firstWord] |= firstBits & lastBits;
+        return;
+    }
+    row[firstWord] |= firstBits;
+    for (int word = firstWord + 1; word < lastWord; ++word) row[word] = ~std::uint64_t(0);
+    row[lastWord] |= lastBits;
+}
+
+FillMask &FillMask::forThisThread()
+{
+    thread_local FillMask mask;
+    return mask;
+}
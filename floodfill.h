@@ -0,0 +1,159 @@
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include <QRect>
+#include <QtAlgorithms>
+#include <QtEndian>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// =================================================================
+// === FLOOD FILL
+// =================================================================
+// Relleno por inundación (4-conectividad) por tramos de fila: cada
+// tramo se extiende a izquierda y derecha, se rellena de una vez y
+// sólo se apila una semilla por tramo vecino de la fila de arriba y
+// de abajo. Las muestras ya rellenas se marcan en una máscara de un
+// bit por muestra que se reutiliza entre rellenos, y todo el recorrido
+// trabaja por palabras de 64 muestras.
+
+class FillMask
+{
+public:
+    // Prepara la máscara para un mapa de width x height, toda a cero.
+    // Sólo se borran las filas que marcó el relleno anterior.
+    void reset(int width, int height);
+
+    // Bits de la fila y (un uint64 por cada 64 columnas); la fila se
+    // reserva la primera vez que se pide
+    std::uint64_t *row(int y);
+    // Marca [x0, x1] en la fila y
+    void setSpan(int y, int x0, int x1);
+
+    // Máscara del hilo llamante, reutilizada entre rellenos
+    static FillMask &forThisThread();
+
+private:
+    int m_width = 0;
+    std::vector<std::vector<std::uint64_t>> m_rows;   // Sin reservar hasta que se usan
+    std::vector<unsigned char> m_rowTouched;
+    std::vector<int> m_touchedRows;                   // Filas a borrar en el próximo reset
+};
+
+namespace FloodFill {
+
+// Palabra para insideWord: bit i = inside(i), i en [0, count). Las
+// condiciones se evalúan en un bucle vectorizable y se empaquetan de
+// 8 en 8 con una multiplicación.
+template <typename Inside>
+std::uint64_t packBits(int count, Inside &&inside)
+{
+    unsigned char flags[64] = {};
+    for (int i = 0; i < count; ++i) flags[i] = inside(i) ? 1 : 0;
+
+    std::uint64_t bits = 0;
+    for (int group = 0; group < 8; ++group) {
+        const quint64 bytes = qFromLittleEndian<quint64>(flags + 8 * group);
+        bits |= ((bytes * 0x0102040810204080ull) >> 56) << (8 * group);
+    }
+    return bits;
+}
+
+// Rellena la región de (startX, startY) en un mapa de width x height.
+//
+// insideWord(int y, int x0, int count) devuelve un uint64 con el bit i
+// a 1 si la muestra (x0 + i, y) pertenece a la región (count <= 64; los
+// bits desde count deben ser 0). Se evalúa sobre los valores originales:
+// las muestras ya rellenas se descartan con la máscara.
+// fillSpan(int y, int x0, int x1) rellena [x0, x1] de la fila y.
+//
+// Devuelve el rectángulo rellenado (vacío si la semilla no pertenece).
+template <typename InsideWord, typename FillSpan>
+QRect fill(int width, int height, int startX, int startY, InsideWord &&insideWord, FillSpan &&fillSpan)
+{
+    if (startX < 0 || startX >= width || startY < 0 || startY >= height) return QRect();
+
+    FillMask &mask = FillMask::forThisThread();
+    mask.reset(width, height);
+
+    const int lastWord = (width - 1) >> 6;
+    // Muestras de la palabra w de la fila y que pertenecen y no están
+    // rellenas; las palabras ya rellenas no se vuelven a leer
+    auto openWord = [&](const std::uint64_t *bits, int y, int w) -> std::uint64_t {
+        const std::uint64_t unfilled = ~bits[w];
+        if (!unfilled) return 0;
+        const int x0 = w << 6;
+        return insideWord(y, x0, std::min(64, width - x0)) & unfilled;
+    };
+
+    int minX = startX, maxX = startX, minY = startY, maxY = startY;
+    bool filled = false;
+
+    struct Seed {
+        int x;
+        int y;
+    };
+    std::vector<Seed> stack;
+    stack.push_back({ startX, startY });
+
+    while (!stack.empty()) {
+        const Seed seed = stack.back();
+        stack.pop_back();
+
+        const std::uint64_t *bits = mask.row(seed.y);
+        const int seedWord = seed.x >> 6;
+        const int seedBit = seed.x & 63;
+        const std::uint64_t word = openWord(bits, seed.y, seedWord);
+        if (!((word >> seedBit) & 1u)) continue;
+
+        // Tramo completo de la fila: muestras abiertas seguidas a la
+        // derecha y a la izquierda de la semilla, palabra a palabra
+        int right = seed.x - 1 + static_cast<int>(qCountTrailingZeroBits(~(word >> seedBit)));
+        for (int w = seedWord + 1; w <= lastWord && right == (w << 6) - 1; ++w) {
+            right += static_cast<int>(qCountTrailingZeroBits(~openWord(bits, seed.y, w)));
+        }
+        right = std::min(right, width - 1);
+
+        int left = seed.x + 1 - static_cast<int>(qCountLeadingZeroBits(~(word << (63 - seedBit))));
+        for (int w = seedWord - 1; w >= 0 && left == (w + 1) << 6; --w) {
+            left -= static_cast<int>(qCountLeadingZeroBits(~openWord(bits, seed.y, w)));
+        }
+
+        mask.setSpan(seed.y, left, right);
+        fillSpan(seed.y, left, right);
+        filled = true;
+        minX = std::min(minX, left);
+        maxX = std::max(maxX, right);
+        minY = std::min(minY, seed.y);
+        maxY = std::max(maxY, seed.y);
+
+        // Una semilla por tramo abierto de las filas vecinas dentro de
+        // [left, right]: los bits donde empieza cada tramo
+        for (int y = seed.y - 1; y <= seed.y + 1; y += 2) {
+            if (y < 0 || y >= height) continue;
+            const std::uint64_t *neighbour = mask.row(y);
+            std::uint64_t previousTop = 0;
+            for (int w = left >> 6; w <= right >> 6; ++w) {
+                std::uint64_t range = ~std::uint64_t(0);
+                if (w == left >> 6) range &= ~std::uint64_t(0) << (left & 63);
+                if (w == right >> 6) range &= ~std::uint64_t(0) >> (63 - (right & 63));
+
+                const std::uint64_t open = openWord(neighbour, y, w) & range;
+                std::uint64_t starts = open & ~((open << 1) | previousTop);
+                previousTop = open >> 63;
+                while (starts) {
+                    stack.push_back({ (w << 6) + static_cast<int>(qCountTrailingZeroBits(starts)), y });
+                    starts &= starts - 1;
+                }
+            }
+        }
+    }
+
+    if (!filled) return QRect();
+    return QRect(QPoint(minX, minY), QPoint(maxX, maxY));
+}
+
+} // namespace FloodFill
+
+#endif // FLOODFILL_H
@@ -0,0 +1,230 @@
+#include "headless.h"
+#include "noise.h"
+#include "terrainio.h"
+#include "threadpool.h"
+#include "tiledheightfield.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+
+namespace Headless {
+
+namespace {
+
+// Lado máximo de la textura de los proyectos .hmt (la del texturizado)
+const int MaxTextureSize = 4096;
+
+enum ExitCode {
+    ExitOk = 0,
+    ExitUsage = 1,
+    ExitFailure = 2
+};
+
+// "WxH" o un solo número para mapas cuadrados
+bool parseSize(const QString &text, int &width, int &height)
+{
+    const QStringList parts = text.toLower().split('x');
+    bool okWidth = false;
+    bool okHeight = false;
+    if (parts.size() == 1) {
+        width = height = parts[0].toInt(&okWidth);
+        okHeight = okWidth;
+    } else if (parts.size() == 2) {
+        width = parts[0].toInt(&okWidth);
+        height = parts[1].toInt(&okHeight);
+    }
+    return okWidth && okHeight;
+}
+
+bool parsePrecision(const QString &text, HeightFormat &format)
+{
+    if (text == "8") format = HeightFormat::U8;
+    else if (text == "16") format = HeightFormat::U16;
+    else if (text == "32") format = HeightFormat::F32;
+    else return false;
+    return true;
+}
+
+// Escribe el mapa en el formato que indica la extensión
+bool exportTerrain(const TiledHeightField &field, const QString &fileName, bool stlAscii, QTextStream &err)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+
+    if (suffix == "png") {
+        if (!TerrainIO::fitsInPng(field)) {
+            err << fileName << ": el mapa es demasiado grande para PNG; use .hmt\n";
+            return false;
+        }
+        return TerrainIO::savePng(field, fileName);
+    }
+    if (suffix == "obj") {
+        return TerrainIO::exportObj(field, fileName);
+    }
+    if (suffix == "stl") {
+        return TerrainIO::exportStl(field, fileName, !stlAscii);
+    }
+    if (suffix == "hmt") {
+        // La textura del proyecto es el propio mapa en grises
+        int step = 1;
+        while (std::max(field.width(), field.height()) / step > MaxTextureSize) {
+            step *= 2;
+        }
+        return TerrainIO::saveHmtProject(field, TerrainIO::grayscaleImage(field, step), fileName);
+    }
+
+    err << fileName << ": formato desconocido (use .png, .obj, .stl o .hmt)\n";
+    return false;
+}
+
+} // namespace
+
+bool requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0) return true;
+    }
+    return false;
+}
+
+int run(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("HeightMapGenerator");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Genera un mapa de alturas y lo exporta sin interfaz.");
+    parser.addHelpOption();
+
+    QStringList noiseList;
+    for (const NoiseName &entry : Noise::noiseNames()) {
+        noiseList << entry.name;
+    }
+
+    const QCommandLineOption headlessOption("headless", "Ejecuta sin interfaz gráfica.");
+    const QCommandLineOption noiseOption({ "n", "noise" },
+                                         QString("Tipo de ruido: %1.").arg(noiseList.join(", ")),
+                                         "tipo", "perlin");
+    const QCommandLineOption octavesOption({ "o", "octaves" }, "Octavas (1-10).", "n", "6");
+    const QCommandLineOption persistenceOption({ "p", "persistence" }, "Persistencia (0.1-0.9).", "valor", "0.55");
+    const QCommandLineOption scaleOption({ "s", "scale" }, "Escala de frecuencia (1-50).", "valor", "8");
+    const QCommandLineOption seedOption("seed", "Semilla de la permutación (aleatoria si se omite).", "n");
+    const QCommandLineOption offsetOption("offset", "Desplazamiento del ruido (por defecto, el de la semilla).",
+                                          "valor");
+    const QCommandLineOption sizeOption("size", QString("Tamaño WxH o N (16-%1).").arg(TiledHeightField::MaxSize),
+                                        "tamaño", "512");
+    const QCommandLineOption precisionOption("precision", "Bits por altura: 8, 16 o 32.", "bits", "8");
+    const QCommandLineOption outputOption({ "O", "output" },
+                                          "Archivo de salida (.png, .obj, .stl o .hmt); puede repetirse.",
+                                          "archivo");
+    const QCommandLineOption stlAsciiOption("stl-ascii", "Escribe los STL en texto en lugar de binario.");
+    parser.addOptions({ headlessOption, noiseOption, octavesOption, persistenceOption, scaleOption,
+                        seedOption, offsetOption, sizeOption, precisionOption, outputOption, stlAsciiOption });
+    parser.process(app);
+
+    // === PARÁMETROS ===
+    NoiseType type;
+    if (!Noise::noiseTypeFromName(parser.value(noiseOption).toStdString(), type)) {
+        err << "Tipo de ruido desconocido: " << parser.value(noiseOption) << "\n";
+        return ExitUsage;
+    }
+
+    bool ok = false;
+    NoiseContext ctx;
+    ctx.octaves = parser.value(octavesOption).toInt(&ok);
+    if (!ok || ctx.octaves < 1 || ctx.octaves > 10) {
+        err << "Las octavas deben estar entre 1 y 10.\n";
+        return ExitUsage;
+    }
+    ctx.persistence = parser.value(persistenceOption).toDouble(&ok);
+    if (!ok || ctx.persistence < 0.1 || ctx.persistence > 0.9) {
+        err << "La persistencia debe estar entre 0.1 y 0.9.\n";
+        return ExitUsage;
+    }
+    const double frequencyScale = parser.value(scaleOption).toDouble(&ok);
+    if (!ok || frequencyScale < 1.0 || frequencyScale > 50.0) {
+        err << "La escala debe estar entre 1 y 50.\n";
+        return ExitUsage;
+    }
+
+    unsigned seed = static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count());
+    if (parser.isSet(seedOption)) {
+        seed = parser.value(seedOption).toUInt(&ok);
+        if (!ok) {
+            err << "Semilla no válida.\n";
+            return ExitUsage;
+        }
+    }
+    ctx.reseed(seed);
+    if (parser.isSet(offsetOption)) {
+        ctx.frequencyOffset = parser.value(offsetOption).toDouble(&ok);
+        if (!ok) {
+            err << "Desplazamiento no válido.\n";
+            return ExitUsage;
+        }
+    }
+
+    int width = 0;
+    int height = 0;
+    const int maxSize = TiledHeightField::MaxSize;
+    if (!parseSize(parser.value(sizeOption), width, height)
+        || width < 16 || height < 16 || width > maxSize || height > maxSize) {
+        err << "El tamaño debe estar entre 16 y " << maxSize << ".\n";
+        return ExitUsage;
+    }
+
+    HeightFormat format;
+    if (!parsePrecision(parser.value(precisionOption), format)) {
+        err << "La precisión debe ser 8, 16 o 32.\n";
+        return ExitUsage;
+    }
+
+    const QStringList outputs = parser.values(outputOption);
+    if (outputs.isEmpty()) {
+        err << "Indique al menos un archivo de salida con --output.\n";
+        return ExitUsage;
+    }
+
+    // === GENERACIÓN ===
+    QElapsedTimer timer;
+    timer.start();
+
+    TiledHeightField field;
+    try {
+        field.assign(width, height, format, 0.0f);
+    } catch (const std::exception &e) {
+        err << "No se pudo crear el mapa: " << e.what() << "\n";
+        return ExitFailure;
+    }
+    Noise::generate(field, ctx, type, Noise::terrainBaseFrequency(width, height, frequencyScale));
+
+    out << "Generado " << width << "x" << height << " (" << parser.value(noiseOption)
+        << ", semilla " << seed << ") en " << timer.elapsed() << " ms con "
+        << ThreadPool::instance().threadCount() << " hilos (" << Noise::simdPathName() << ")\n";
+    out.flush();
+
+    // === EXPORTACIÓN ===
+    int result = ExitOk;
+    for (const QString &fileName : outputs) {
+        timer.restart();
+        if (exportTerrain(field, fileName, parser.isSet(stlAsciiOption), err)) {
+            out << fileName << " (" << timer.elapsed() << " ms)\n";
+            out.flush();
+        } else {
+            err << "No se pudo escribir " << fileName << "\n";
+            err.flush();
+            result = ExitFailure;
+        }
+    }
+    return result;
+}
+
+} // namespace Headless
@@ -0,0 +1,23 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// =================================================================
+// === HEADLESS MODE
+// =================================================================
+// HeightMapGenerator --headless [opciones]: genera un terreno con el
+// mismo generador que la interfaz y lo exporta (PNG/OBJ/STL/HMT) sin
+// crear ningún widget ni necesitar servidor gráfico. Pensado para
+// granjas de compilación y lotes de terrenos.
+
+namespace Headless {
+
+// true si la línea de comandos pide el modo sin interfaz; se mira
+// antes de crear QApplication
+bool requested(int argc, char *argv[]);
+
+// Crea su propio QCoreApplication y devuelve el código de salida
+int run(int argc, char *argv[]);
+
+} // namespace Headless
+
+#endif // HEADLESS_H
@@ -0,0 +1,304 @@
+#include "heightfield.h"
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace {
+
+template <typename T>
+inline float sampleToLevel(T value)
+{
+    return static_cast<float>(value / levelScale<T>());
+}
+
+// Nivel (0..255) a muestra, redondeando en los formatos enteros
+template <typename T>
+inline T levelToSample(double level)
+{
+    if constexpr (HeightTraits<T>::format == HeightFormat::F32) {
+        return HeightTraits<T>::fromValue(level * levelScale<T>());
+    } else {
+        return HeightTraits<T>::fromValue(level * levelScale<T>() + 0.5);
+    }
+}
+
+template <typename Src, typename Dst>
+void convertRow(const Src *src, Dst *dst, int count)
+{
+    for (int x = 0; x < count; ++x) {
+        dst[x] = levelToSample<Dst>(sampleToLevel(src[x]));
+    }
+}
+
+} // namespace
+
+int bytesPerSample(HeightFormat format)
+{
+    switch (format) {
+    case HeightFormat::U16:
+        return 2;
+    case HeightFormat::F32:
+        return 4;
+    case HeightFormat::U8:
+    default:
+        return 1;
+    }
+}
+
+void convertSamples(HeightFormat srcFormat, const void *src, HeightFormat dstFormat, void *dst, int count)
+{
+    if (srcFormat == dstFormat) {
+        std::memcpy(dst, src, static_cast<std::size_t>(count) * bytesPerSample(srcFormat));
+        return;
+    }
+
+    dispatchHeightFormat(srcFormat, [&](auto srcTag) {
+        using Src = decltype(srcTag);
+        dispatchHeightFormat(dstFormat, [&](auto dstTag) {
+            using Dst = decltype(dstTag);
+            convertRow(static_cast<const Src *>(src), static_cast<Dst *>(dst), count);
+        });
+    });
+}
+
+void fillSamples(HeightFormat format, void *dst, int count, float level)
+{
+    dispatchHeightFormat(format, [&](auto tag) {
+        using T = decltype(tag);
+        std::fill_n(static_cast<T *>(dst), count, levelToSample<T>(level));
+    });
+}
+
+void samplesToLevels(HeightFormat format, const void *src, float *out, int count)
+{
+    dispatchHeightFormat(format, [&](auto tag) {
+        using T = decltype(tag);
+        const T *samples = static_cast<const T *>(src);
+        for (int x = 0; x < count; ++x) {
+            out[x] = sampleToLevel(samples[x]);
+        }
+    });
+}
+
+HeightField::HeightField(int width, int height, HeightFormat format, float level)
+{
+    assign(width, height, format, level);
+}
+
+HeightField::HeightField(const HeightField &other)
+{
+    *this = other;
+}
+
+HeightField::HeightField(HeightField &&other) noexcept
+{
+    swap(other);
+}
+
+HeightField &HeightField::operator=(const HeightField &other)
+{
+    if (this == &other) return *this;
+
+    reallocate(other.m_width, other.m_height, other.m_format);
+    if (other.m_data) {
+        // Mismo stride para el mismo ancho y formato: una sola copia lineal
+        std::memcpy(m_data, other.m_data, other.sizeInBytes());
+    }
+    return *this;
+}
+
+HeightField &HeightField::operator=(HeightField &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        swap(other);
+    }
+    return *this;
+}
+
+HeightField::~HeightField()
+{
+    release();
+}
+
+void HeightField::assign(int width, int height, float level)
+{
+    assign(width, height, m_format, level);
+}
+
+void HeightField::assign(int width, int height, HeightFormat format, float level)
+{
+    reallocate(width, height, format);
+    fill(level);
+}
+
+void HeightField::fill(float level)
+{
+    fillRegion(0, 0, m_width, m_height, level);
+}
+
+void HeightField::clear()
+{
+    release();
+}
+
+void HeightField::swap(HeightField &other) noexcept
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_format, other.m_format);
+    std::swap(m_width, other.m_width);
+    std::swap(m_height, other.m_height);
+    std::swap(m_stride, other.m_stride);
+    std::swap(m_capacity, other.m_capacity);
+}
+
+void HeightField::convertTo(HeightFormat format)
+{
+    if (format == m_format) return;
+
+    HeightField result = converted(format);
+    swap(result);
+}
+
+HeightField HeightField::converted(HeightFormat format) const
+{
+    HeightField result;
+    result.reallocate(m_width, m_height, format);
+    result.copyRegion(*this, 0, 0, m_width, m_height, 0, 0);
+    return result;
+}
+
+void HeightField::copyRegion(const HeightField &src, int srcX, int srcY,
+                             int regionWidth, int regionHeight, int dstX, int dstY)
+{
+    // Recortar contra el origen
+    if (srcX < 0) { regionWidth += srcX; dstX -= srcX; srcX = 0; }
+    if (srcY < 0) { regionHeight += srcY; dstY -= srcY; srcY = 0; }
+    // Recortar contra el destino
+    if (dstX < 0) { regionWidth += dstX; srcX -= dstX; dstX = 0; }
+    if (dstY < 0) { regionHeight += dstY; srcY -= dstY; dstY = 0; }
+
+    regionWidth = std::min({ regionWidth, src.m_width - srcX, m_width - dstX });
+    regionHeight = std::min({ regionHeight, src.m_height - srcY, m_height - dstY });
+    if (regionWidth <= 0 || regionHeight <= 0) return;
+
+    if (src.m_format == m_format) {
+        const int bpp = bytesPerSample();
+        for (int y = 0; y < regionHeight; ++y) {
+            std::memcpy(rowBytes(dstY + y) + dstX * bpp, src.rowBytes(srcY + y) + srcX * bpp,
+                        static_cast<std::size_t>(regionWidth) * bpp);
+        }
+        return;
+    }
+
+    dispatchHeightFormat(src.m_format, [&](auto srcTag) {
+        using Src = decltype(srcTag);
+        dispatchHeightFormat(m_format, [&](auto dstTag) {
+            using Dst = decltype(dstTag);
+            for (int y = 0; y < regionHeight; ++y) {
+                convertRow(src.row<Src>(srcY + y) + srcX, row<Dst>(dstY + y) + dstX, regionWidth);
+            }
+        });
+    });
+}
+
+void HeightField::fillRegion(int x, int y, int regionWidth, int regionHeight, float level)
+{
+    int x0 = std::max(0, x);
+    int y0 = std::max(0, y);
+    int x1 = std::min(m_width, x + regionWidth);
+    int y1 = std::min(m_height, y + regionHeight);
+    if (x1 <= x0 || y1 <= y0) return;
+
+    dispatchHeightFormat(m_format, [&](auto tag) {
+        using T = decltype(tag);
+        const T value = levelToSample<T>(level);
+        for (int ry = y0; ry < y1; ++ry) {
+            T *dst = row<T>(ry);
+            std::fill(dst + x0, dst + x1, value);
+        }
+    });
+}
+
+float HeightField::level(int x, int y) const
+{
+    switch (m_format) {
+    case HeightFormat::U16:
+        return sampleToLevel(row<std::uint16_t>(y)[x]);
+    case HeightFormat::F32:
+        return sampleToLevel(row<float>(y)[x]);
+    case HeightFormat::U8:
+    default:
+        return row<std::uint8_t>(y)[x];
+    }
+}
+
+void HeightField::setLevel(int x, int y, float level)
+{
+    dispatchHeightFormat(m_format, [&](auto tag) {
+        using T = decltype(tag);
+        row<T>(y)[x] = levelToSample<T>(level);
+    });
+}
+
+void HeightField::rowToU8(int y, unsigned char *out) const
+{
+    convertSamples(m_format, rowBytes(y), HeightFormat::U8, out, m_width);
+}
+
+void HeightField::rowToLevels(int y, float *out) const
+{
+    samplesToLevels(m_format, rowBytes(y), out, m_width);
+}
+
+bool HeightField::operator==(const HeightField &other) const
+{
+    if (m_format != other.m_format || m_width != other.m_width || m_height != other.m_height) return false;
+
+    for (int y = 0; y < m_height; ++y) {
+        if (std::memcmp(rowBytes(y), other.rowBytes(y), rowSizeInBytes()) != 0) return false;
+    }
+    return true;
+}
+
+std::ptrdiff_t HeightField::alignedStride(int width, HeightFormat format)
+{
+    const std::ptrdiff_t a = static_cast<std::ptrdiff_t>(Alignment);
+    const std::ptrdiff_t bytes = static_cast<std::ptrdiff_t>(width) * ::bytesPerSample(format);
+    return (bytes + a - 1) / a * a;
+}
+
+void HeightField::reallocate(int width, int height, HeightFormat format)
+{
+    if (width <= 0 || height <= 0) {
+        release();
+        m_format = format;
+        return;
+    }
+
+    std::ptrdiff_t stride = alignedStride(width, format);
+    std::size_t bytes = static_cast<std::size_t>(stride) * static_cast<std::size_t>(height);
+
+    if (bytes > m_capacity) {
+        release();
+        m_data = static_cast<unsigned char *>(::operator new(bytes, std::align_val_t(Alignment)));
+        m_capacity = bytes;
+    }
+
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    m_stride = stride;
+}
+
+void HeightField::release()
+{
+    if (m_data) {
+        ::operator delete(m_data, std::align_val_t(Alignment));
+    }
+    m_data = nullptr;
+    m_width = 0;
+    m_height = 0;
+    m_stride = 0;
+    m_capacity = 0;
+}
@@ -0,0 +1,203 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// =================================================================
+// === HEIGHT FORMATS
+// =================================================================
+// Precisión de almacenamiento de las alturas. Todos los formatos se
+// exponen además en una escala común de "nivel" 0..255 (la del
+// formato histórico de 8 bits), que es la que usan la interfaz, los
+// pinceles y los exportadores.
+
+enum class HeightFormat {
+    U8,     // 0..255
+    U16,    // 0..65535
+    F32     // 0..1
+};
+
+template <typename T>
+struct HeightTraits;
+
+template <>
+struct HeightTraits<std::uint8_t>
+{
+    static constexpr HeightFormat format = HeightFormat::U8;
+    static constexpr double maxValue = 255.0;
+    using Accumulator = int;
+
+    // Valor de ruido en [-1, 1] (misma cuantización que siempre)
+    static std::uint8_t fromNoise(double v) { return (std::uint8_t)((v + 1.0) * 127.5); }
+    // Trunca y recorta como los pinceles originales
+    static std::uint8_t fromValue(double v)
+    {
+        int i = static_cast<int>(v);
+        return static_cast<std::uint8_t>(i < 0 ? 0 : (i > 255 ? 255 : i));
+    }
+};
+
+template <>
+struct HeightTraits<std::uint16_t>
+{
+    static constexpr HeightFormat format = HeightFormat::U16;
+    static constexpr double maxValue = 65535.0;
+    using Accumulator = int;
+
+    static std::uint16_t fromNoise(double v) { return (std::uint16_t)((v + 1.0) * 32767.5); }
+    static std::uint16_t fromValue(double v)
+    {
+        int i = static_cast<int>(v);
+        return static_cast<std::uint16_t>(i < 0 ? 0 : (i > 65535 ? 65535 : i));
+    }
+};
+
+template <>
+struct HeightTraits<float>
+{
+    static constexpr HeightFormat format = HeightFormat::F32;
+    static constexpr double maxValue = 1.0;
+    using Accumulator = double;
+
+    static float fromNoise(double v) { return static_cast<float>((v + 1.0) * 0.5); }
+    static float fromValue(double v) { return static_cast<float>(v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v)); }
+};
+
+// Factor de nivel (0..255) a unidades del formato T
+template <typename T>
+constexpr double levelScale() { return HeightTraits<T>::maxValue / 255.0; }
+
+// Llama a f con un valor del tipo de almacenamiento del formato, para
+// elegir la instancia tipada una sola vez fuera de los bucles:
+//   dispatchHeightFormat(fmt, [&](auto tag) { using T = decltype(tag); ... });
+template <typename F>
+decltype(auto) dispatchHeightFormat(HeightFormat format, F &&f)
+{
+    switch (format) {
+    case HeightFormat::U16:
+        return f(std::uint16_t());
+    case HeightFormat::F32:
+        return f(float());
+    case HeightFormat::U8:
+    default:
+        return f(std::uint8_t());
+    }
+}
+
+int bytesPerSample(HeightFormat format);
+
+// Conversión de tramos de muestras sin tipo (filas de tiles, E/S).
+// Convierten pasando por la escala de nivel; con el mismo formato es
+// una copia.
+void convertSamples(HeightFormat srcFormat, const void *src, HeightFormat dstFormat, void *dst, int count);
+void fillSamples(HeightFormat format, void *dst, int count, float level);
+void samplesToLevels(HeightFormat format, const void *src, float *out, int count);
+
+// =================================================================
+// === HEIGHTFIELD
+// =================================================================
+// Rejilla de alturas en una única reserva alineada (row-major).
+// Cada fila empieza en un múltiplo de Alignment bytes, de modo que
+// rowBytes(y) + stride() == rowBytes(y + 1) y las copias completas son
+// un solo memcpy de height() * stride() bytes.
+
+class HeightField
+{
+public:
+    static constexpr std::size_t Alignment = 64;
+
+    // Vista ligera sobre una fila (equivalente a std::span en C++20)
+    template <typename T>
+    struct RowSpan {
+        T *ptr = nullptr;
+        int count = 0;
+
+        T *data() const { return ptr; }
+        int size() const { return count; }
+        T *begin() const { return ptr; }
+        T *end() const { return ptr + count; }
+        T &operator[](int x) const { return ptr[x]; }
+    };
+
+    HeightField() = default;
+    HeightField(int width, int height, HeightFormat format = HeightFormat::U8, float level = 0.0f);
+    HeightField(const HeightField &other);
+    HeightField(HeightField &&other) noexcept;
+    HeightField &operator=(const HeightField &other);
+    HeightField &operator=(HeightField &&other) noexcept;
+    ~HeightField();
+
+    // Redimensiona (reutilizando la reserva si cabe) y rellena con el
+    // nivel indicado; sin formato se conserva el actual
+    void assign(int width, int height, float level);
+    void assign(int width, int height, HeightFormat format, float level);
+    void fill(float level);
+    void clear();
+    void swap(HeightField &other) noexcept;
+
+    // Cambia la precisión conservando las alturas (en escala de nivel)
+    void convertTo(HeightFormat format);
+    HeightField converted(HeightFormat format) const;
+
+    // Copia rectangular entre campos (recortada a los límites de ambos).
+    // Si los formatos difieren, convierte muestra a muestra.
+    void copyRegion(const HeightField &src, int srcX, int srcY,
+                    int regionWidth, int regionHeight, int dstX, int dstY);
+    // Rellena un rectángulo (recortado a los límites)
+    void fillRegion(int x, int y, int regionWidth, int regionHeight, float level);
+
+    HeightFormat format() const { return m_format; }
+    int bytesPerSample() const { return ::bytesPerSample(m_format); }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    std::ptrdiff_t stride() const { return m_stride; }
+    bool empty() const { return m_width == 0 || m_height == 0; }
+    bool contains(int x, int y) const { return x >= 0 && x < m_width && y >= 0 && y < m_height; }
+    std::size_t sizeInBytes() const { return static_cast<std::size_t>(m_stride) * m_height; }
+    std::size_t rowSizeInBytes() const { return static_cast<std::size_t>(m_width) * bytesPerSample(); }
+
+    unsigned char *data() { return m_data; }
+    const unsigned char *data() const { return m_data; }
+
+    unsigned char *rowBytes(int y) { return m_data + y * m_stride; }
+    const unsigned char *rowBytes(int y) const { return m_data + y * m_stride; }
+
+    // Acceso tipado: T debe ser el tipo del formato actual
+    template <typename T>
+    T *row(int y) { return reinterpret_cast<T *>(rowBytes(y)); }
+    template <typename T>
+    const T *row(int y) const { return reinterpret_cast<const T *>(rowBytes(y)); }
+
+    template <typename T>
+    RowSpan<T> rowSpan(int y) { return { row<T>(y), m_width }; }
+    template <typename T>
+    RowSpan<const T> rowSpan(int y) const { return { row<T>(y), m_width }; }
+
+    // Acceso en escala de nivel (0..255) independiente del formato.
+    // Para recorridos largos es mejor dispatchHeightFormat + row<T>.
+    float level(int x, int y) const;
+    void setLevel(int x, int y, float level);
+    // Fila completa convertida a 8 bits (pantalla, miniaturas)
+    void rowToU8(int y, unsigned char *out) const;
+    // Fila completa en escala de nivel, sin redondear (mallas, exportación)
+    void rowToLevels(int y, float *out) const;
+
+    bool operator==(const HeightField &other) const;
+    bool operator!=(const HeightField &other) const { return !(*this == other); }
+
+private:
+    static std::ptrdiff_t alignedStride(int width, HeightFormat format);
+    void reallocate(int width, int height, HeightFormat format);
+    void release();
+
+    unsigned char *m_data = nullptr;
+    HeightFormat m_format = HeightFormat::U8;
+    int m_width = 0;
+    int m_height = 0;
+    std::ptrdiff_t m_stride = 0;
+    std::size_t m_capacity = 0;
+};
+
+#endif // HEIGHTFIELD_H
@@ -0,0 +1,494 @@
+#include "heightmapcanvas.h"
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Memoria para tiles convertidos (8 bits por píxel)
+const int TileCacheBytes = 96 * 1024 * 1024;
+
+const double MaxZoom = 32.0;
+const double WheelZoomStep = 1.25;   // Factor por paso de rueda
+const int MinVisibleMap = 32;        // Píxeles del mapa que siempre quedan a la vista
+// Muestras por eje que promedia cada píxel de un nivel sacado del mapa
+// (el bloque entero hasta el nivel 2, un reparto uniforme por encima)
+const int MaxFilterTaps = 4;
+
+} // namespace
+
+HeightmapCanvas::HeightmapCanvas(QWidget *parent)
+    : QWidget(parent)
+{
+    // Cada repintado cubre su zona entera
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    tiles.setMaxCost(TileCacheBytes);
+}
+
+void HeightmapCanvas::setHeightField(const TiledHeightField *field)
+{
+    heightField = field;
+    fieldSize = field ? QSize(field->width(), field->height()) : QSize();
+    tiles.clear();
+    previewImage = QImage();
+    if (glView) glView->setHeightField(field);
+    fitPending = true;
+    fitToView();
+}
+
+void HeightmapCanvas::invalidateAll()
+{
+    tiles.clear();
+    if (glView) glView->invalidateAll();
+    const QSize size = heightField ? QSize(heightField->width(), heightField->height()) : QSize();
+    if (size != fieldSize) {
+        fieldSize = size;
+        fitPending = true;
+        fitToView();
+        return;
+    }
+    refresh();
+}
+
+void HeightmapCanvas::invalidate(const QRect &mapRect)
+{
+    if (!heightField || heightField->empty()) return;
+    const QRect area = mapRect & QRect(0, 0, heightField->width(), heightField->height());
+    if (area.isEmpty()) return;
+    if (glView) {
+        glView->invalidate(area);
+        return;
+    }
+
+    // Se rehace la zona en los tiles ya en caché, de abajo arriba para
+    // que cada nivel vea el anterior ya actualizado; la zona se divide
+    // entre 2 por nivel. Los demás tiles se construirán cuando se pidan.
+    QRect levelRect = area;
+    for (int level = 0; level < levelCount(); ++level) {
+        if (level > 0) {
+            levelRect = QRect(QPoint(levelRect.left() / 2, levelRect.top() / 2),
+                              QPoint(levelRect.right() / 2, levelRect.bottom() / 2));
+        }
+        for (int tileY = levelRect.top() / TileSize; tileY <= levelRect.bottom() / TileSize; ++tileY) {
+            for (int tileX = levelRect.left() / TileSize; tileX <= levelRect.right() / TileSize; ++tileX) {
+                if (QImage *image = tiles.object(tileKey(level, tileX, tileY))) {
+                    updateTile(*image, level, tileX, tileY, levelRect);
+                }
+            }
+        }
+    }
+
+    if (showingPreview()) return;
+
+    // Cada píxel del nivel visible cubre step muestras desde la suya
+    const int step = 1 << levelForZoom();
+    const QRectF covered(area.left() - area.left() % step, area.top() - area.top() % step,
+                         area.width() + 2 * step, area.height() + 2 * step);
+    refresh(mapToWidget(covered).toAlignedRect().adjusted(-1, -1, 1, 1) & rect());
+}
+
+void HeightmapCanvas::setPreview(const QImage &image, int step)
+{
+    previewImage = image;
+    previewStep = std::max(1, step);
+    refresh();
+}
+
+void HeightmapCanvas::clearPreview()
+{
+    if (previewImage.isNull()) return;
+    previewImage = QImage();
+    refresh();
+}
+
+QPointF HeightmapCanvas::widgetToMap(const QPointF &point) const
+{
+    return point / zoomFactor + origin;
+}
+
+QRectF HeightmapCanvas::mapToWidget(const QRectF &rect) const
+{
+    return QRectF((rect.topLeft() - origin) * zoomFactor, rect.size() * zoomFactor);
+}
+
+void HeightmapCanvas::fitToView()
+{
+    if (!heightField || heightField->empty() || width() <= 0 || height() <= 0) {
+        refresh();
+        return;
+    }
+
+    const double mapWidth = heightField->width();
+    const double mapHeight = heightField->height();
+    zoomFactor = std::min(MaxZoom, std::min(width() / mapWidth, height() / mapHeight));
+
+    // Centrado en la ventana
+    origin = QPointF((mapWidth - width() / zoomFactor) / 2.0, (mapHeight - height() / zoomFactor) / 2.0);
+    refresh();
+}
+
+void HeightmapCanvas::setZoom(double zoom, const QPointF &anchor)
+{
+    if (!heightField || heightField->empty()) return;
+
+    // Como mucho se aleja hasta ver el mapa entero a la mitad de la ventana
+    const double fitZoom = std::min(width() / static_cast<double>(heightField->width()),
+                                    height() / static_cast<double>(heightField->height()));
+    zoom = std::clamp(zoom, std::min(fitZoom / 2.0, 1.0), MaxZoom);
+
+    // El punto del mapa bajo el cursor no se mueve
+    const QPointF anchorMap = widgetToMap(anchor);
+    zoomFactor = zoom;
+    origin = anchorMap - anchor / zoomFactor;
+    fitPending = false;
+    refresh();
+}
+
+int HeightmapCanvas::levelCount() const
+{
+    if (!heightField || heightField->empty()) return 0;
+    int levels = 1;
+    while ((std::max(heightField->width(), heightField->height()) >> (levels - 1)) > TileSize) {
+        ++levels;
+    }
+    return levels;
+}
+
+int HeightmapCanvas::levelForZoom() const
+{
+    if (zoomFactor >= 1.0) return 0;
+    // El nivel más grueso que aún tiene al menos un píxel por píxel de pantalla
+    const int level = static_cast<int>(std::floor(std::log2(1.0 / zoomFactor)));
+    return std::clamp(level, 0, std::max(0, levelCount() - 1));
+}
+
+quint64 HeightmapCanvas::tileKey(int level, int tileX, int tileY)
+{
+    return (static_cast<quint64>(level) << 48) | (static_cast<quint64>(tileY) << 24) | static_cast<quint64>(tileX);
+}
+
+const QImage *HeightmapCanvas::tile(int level, int tileX, int tileY)
+{
+    const quint64 key = tileKey(level, tileX, tileY);
+    if (QImage *image = tiles.object(key)) return image;
+
+    const QSize size = levelSize(level);
+    QImage *image = new QImage(std::min(TileSize, size.width() - tileX * TileSize),
+                               std::min(TileSize, size.height() - tileY * TileSize), QImage::Format_Grayscale8);
+    updateTile(*image, level, tileX, tileY, QRect(QPoint(0, 0), size));
+
+    const qsizetype bytes = image->sizeInBytes();
+    tiles.insert(key, image, bytes);
+    return tiles.object(key);
+}
+
+QSize HeightmapCanvas::levelSize(int level) const
+{
+    const int step = 1 << level;
+    return QSize((heightField->width() + step - 1) / step, (heightField->height() + step - 1) / step);
+}
+
+void HeightmapCanvas::updateTile(QImage &image, int level, int tileX, int tileY, const QRect &levelRect)
+{
+    // Zona del tile que cae en levelRect (píxeles del nivel)
+    const int firstX = tileX * TileSize;
+    const int firstY = tileY * TileSize;
+    const int x0 = std::max(firstX, levelRect.left());
+    const int x1 = std::min(firstX + image.width() - 1, levelRect.right());
+    const int y0 = std::max(firstY, levelRect.top());
+    const int y1 = std::min(firstY + image.height() - 1, levelRect.bottom());
+    if (x1 < x0 || y1 < y0) return;
+
+    if (level == 0) {
+        rowBuffer.resize(heightField->width());
+        for (int y = y0; y <= y1; ++y) {
+            heightField->rowToU8(y, rowBuffer.data(), 1, x0, x1 + 1);
+            std::memcpy(image.scanLine(y - firstY) + (x0 - firstX), rowBuffer.data() + x0, x1 - x0 + 1);
+        }
+        return;
+    }
+
+    // Por cada tile del nivel anterior que cubre este (hasta 2x2): si
+    // está en caché, media de 2x2 de sus píxeles; si no, se saca del mapa
+    // sólo la zona pedida. El coste no depende del nivel ni de la caché.
+    const QSize below = levelSize(level - 1);
+    const int half = TileSize / 2;
+    for (int sub = 0; sub < 4; ++sub) {
+        const int childX = 2 * tileX + (sub & 1);
+        const int childY = 2 * tileY + (sub >> 1);
+        const int cx0 = std::max(x0, childX * half);
+        const int cx1 = std::min(x1, childX * half + half - 1);
+        const int cy0 = std::max(y0, childY * half);
+        const int cy1 = std::min(y1, childY * half + half - 1);
+        if (cx1 < cx0 || cy1 < cy0) continue;
+
+        const QImage *child = tiles.object(tileKey(level - 1, childX, childY));
+        if (!child) {
+            filterFromField(image, level, firstX, firstY, QRect(QPoint(cx0, cy0), QPoint(cx1, cy1)));
+            continue;
+        }
+
+        const int childFirstX = childX * TileSize;
+        const int childFirstY = childY * TileSize;
+        for (int y = cy0; y <= cy1; ++y) {
+            // En un borde impar la última fila o columna se repite
+            const uchar *row0 = child->constScanLine(2 * y - childFirstY);
+            const uchar *row1 = child->constScanLine(std::min(2 * y + 1, below.height() - 1) - childFirstY);
+            uchar *out = image.scanLine(y - firstY);
+            for (int x = cx0; x <= cx1; ++x) {
+                const int left = 2 * x - childFirstX;
+                const int right = std::min(2 * x + 1, below.width() - 1) - childFirstX;
+                out[x - firstX] = static_cast<uchar>((row0[left] + row0[right] + row1[left] + row1[right] + 2) / 4);
+            }
+        }
+    }
+}
+
+void HeightmapCanvas::filterFromField(QImage &image, int level, int firstX, int firstY, const QRect &levelRect)
+{
+    // Cada píxel cubre un bloque de block x block muestras; se promedian
+    // taps x taps de ellas, una cada spacing (todo el bloque si cabe)
+    const int block = 1 << level;
+    const int taps = std::min(block, MaxFilterTaps);
+    const int spacing = block / taps;
+    const int mapWidth = heightField->width();
+    const int mapHeight = heightField->height();
+    // Última columna de la rejilla de spacing dentro del mapa: los
+    // bloques del borde que se salen repiten la última
+    const int lastColumn = (mapWidth - 1) / spacing;
+
+    const int x0 = levelRect.left();
+    const int x1 = levelRect.right();
+    rowBuffer.resize(lastColumn + 1);
+    filterSums.resize(x1 - x0 + 1);
+    for (int y = levelRect.top(); y <= levelRect.bottom(); ++y) {
+        std::fill(filterSums.begin(), filterSums.end(), 0);
+        for (int ty = 0; ty < taps; ++ty) {
+            const int sampleY = std::min(y * block + ty * spacing, mapHeight - 1);
+            heightField->rowToU8(sampleY, rowBuffer.data(), spacing, x0 * block,
+                                 std::min(mapWidth, (x1 + 1) * block));
+            for (int x = x0; x <= x1; ++x) {
+                const int column = x * block / spacing;
+                for (int tx = 0; tx < taps; ++tx) {
+                    filterSums[x - x0] += rowBuffer[std::min(column + tx, lastColumn)];
+                }
+            }
+        }
+
+        const int count = taps * taps;
+        uchar *out = image.scanLine(y - firstY);
+        for (int x = x0; x <= x1; ++x) {
+            out[x - firstX] = static_cast<uchar>((filterSums[x - x0] + count / 2) / count);
+        }
+    }
+}
+
+QRect HeightmapCanvas::overlayRect() const
+{
+    if (overlayPath.isEmpty()) return QRect();
+    const int margin = static_cast<int>(std::ceil(overlayPen.widthF() / 2.0)) + 2;   // Grosor y antialiasing
+    return mapToWidget(overlayPath.boundingRect()).toAlignedRect().adjusted(-margin, -margin, margin, margin);
+}
+
+void HeightmapCanvas::setAccelerated(bool enabled)
+{
+    if (enabled == accelerated()) return;
+
+    if (enabled) {
+        glView = new HeightmapGLView(this);
+        glView->setShading(currentShading);
+        glView->setHeightField(heightField);
+        glView->setGeometry(rect());
+        glView->show();
+    } else {
+        delete glView;
+        glView = nullptr;
+        // Los tiles no se actualizaron mientras dibujaba OpenGL
+        tiles.clear();
+        update();
+    }
+}
+
+void HeightmapCanvas::setShading(HeightmapGLView::Shading shading)
+{
+    currentShading = shading;
+    if (glView) glView->setShading(shading);
+}
+
+void HeightmapCanvas::setOverlay(const QPainterPath &path, const QPen &pen)
+{
+    const QRect previous = overlayRect();
+    overlayPath = path;
+    overlayPen = pen;
+    overlayPen.setCosmetic(true);
+    refresh(previous | overlayRect());
+}
+
+void HeightmapCanvas::clearOverlay()
+{
+    if (overlayPath.isEmpty()) return;
+    const QRect previous = overlayRect();
+    overlayPath = QPainterPath();
+    refresh(previous);
+}
+
+void HeightmapCanvas::refresh(const QRect &area)
+{
+    // QOpenGLWidget siempre vuelve a dibujar el frame completo
+    if (glView) {
+        glView->update();
+    } else {
+        update(area);
+    }
+}
+
+void HeightmapCanvas::refresh()
+{
+    refresh(rect());
+}
+
+void HeightmapCanvas::paintPreview(QPainter &painter) const
+{
+    const QRectF fieldRect(0, 0, heightField->width(), heightField->height());
+    const QRectF covered(0, 0, previewImage.width() * previewStep, previewImage.height() * previewStep);
+    painter.save();
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, zoomFactor < 1.0);
+    painter.setClipRect(mapToWidget(fieldRect));
+    painter.drawImage(mapToWidget(covered), previewImage);
+    painter.restore();
+}
+
+void HeightmapCanvas::paintOverlay(QPainter &painter, const QRect &area) const
+{
+    if (overlayPath.isEmpty()) return;
+    painter.save();
+    painter.setClipRect(area);
+    painter.translate(-origin * zoomFactor);
+    painter.scale(zoomFactor, zoomFactor);
+    painter.setPen(overlayPen);
+    painter.setBrush(Qt::NoBrush);
+    painter.drawPath(overlayPath);
+    painter.restore();
+}
+
+void HeightmapCanvas::paintEvent(QPaintEvent *event)
+{
+    // Con aceleración dibuja el hijo, que cubre todo el lienzo
+    if (glView) return;
+
+    QPainter painter(this);
+    const QRect area = event->rect();
+    painter.fillRect(area, palette().dark());
+    if (!heightField || heightField->empty()) return;
+
+    if (showingPreview()) {
+        paintPreview(painter);
+    } else {
+        // Tiles del nivel actual que cortan la zona expuesta
+        const QRectF fieldRect(0, 0, heightField->width(), heightField->height());
+        const int level = levelForZoom();
+        const int step = 1 << level;
+        const int span = TileSize * step;
+        const QRectF visible = QRectF(widgetToMap(area.topLeft()), widgetToMap(area.bottomRight() + QPoint(1, 1)))
+                                   .intersected(fieldRect);
+        // Al alejar se suaviza; al acercar se ven las muestras
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, zoomFactor < 1.0);
+        if (!visible.isEmpty()) {
+            const int tileX0 = static_cast<int>(visible.left()) / span;
+            const int tileY0 = static_cast<int>(visible.top()) / span;
+            const int tileX1 = static_cast<int>(std::ceil(visible.right()) - 1) / span;
+            const int tileY1 = static_cast<int>(std::ceil(visible.bottom()) - 1) / span;
+
+            for (int tileY = tileY0; tileY <= tileY1; ++tileY) {
+                for (int tileX = tileX0; tileX <= tileX1; ++tileX) {
+                    const QImage *image = tile(level, tileX, tileY);
+                    // El último píxel de cada fila puede pasarse del borde del mapa
+                    const QRectF covered = QRectF(tileX * span, tileY * span, image->width() * step,
+                                                  image->height() * step).intersected(fieldRect);
+                    painter.drawImage(mapToWidget(covered), *image,
+                                      QRectF(0, 0, covered.width() / step, covered.height() / step));
+                }
+            }
+        }
+    }
+
+    paintOverlay(painter, area);
+}
+
+void HeightmapCanvas::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    if (glView) glView->setGeometry(rect());
+    if (fitPending) fitToView();
+}
+
+void HeightmapCanvas::wheelEvent(QWheelEvent *event)
+{
+    const double steps = event->angleDelta().y() / 120.0;
+    if (steps == 0.0) {
+        event->ignore();
+        return;
+    }
+    setZoom(zoomFactor * std::pow(WheelZoomStep, steps), event->position());
+    event->accept();
+}
+
+void HeightmapCanvas::mousePressEvent(QMouseEvent *event)
+{
+    // Sólo el botón central es de la vista; el resto va a los pinceles
+    if (event->button() != Qt::MiddleButton) {
+        event->ignore();
+        return;
+    }
+    panning = true;
+    lastPanPosition = event->position().toPoint();
+    setCursor(Qt::ClosedHandCursor);
+    event->accept();
+}
+
+void HeightmapCanvas::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!panning || !heightField || heightField->empty()) {
+        event->ignore();
+        return;
+    }
+
+    const QPoint position = event->position().toPoint();
+    origin -= QPointF(position - lastPanPosition) / zoomFactor;
+    lastPanPosition = position;
+
+    // Siempre queda a la vista un trozo del mapa
+    const double margin = MinVisibleMap / zoomFactor;
+    origin.setX(std::clamp(origin.x(), margin - width() / zoomFactor, heightField->width() - margin));
+    origin.setY(std::clamp(origin.y(), margin - height() / zoomFactor, heightField->height() - margin));
+
+    fitPending = false;
+    refresh();
+    event->accept();
+}
+
+void HeightmapCanvas::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (!panning || event->button() != Qt::MiddleButton) {
+        event->ignore();
+        return;
+    }
+    panning = false;
+    unsetCursor();
+    event->accept();
+}
+
+void HeightmapCanvas::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::MiddleButton) {
+        event->ignore();
+        return;
+    }
+    fitPending = true;
+    fitToView();
+    event->accept();
+}
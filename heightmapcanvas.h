@@ -0,0 +1,136 @@
+#ifndef HEIGHTMAPCANVAS_H
+#define HEIGHTMAPCANVAS_H
+
+#include <QCache>
+#include <QImage>
+#include <QPainterPath>
+#include <QPen>
+#include <QWidget>
+#include <vector>
+#include "tiledheightfield.h"
+#include "heightmapglview.h"
+
+// =================================================================
+// === HEIGHTMAP CANVAS
+// =================================================================
+// Vista 2D del mapa con zoom y desplazamiento. La imagen se compone de
+// tiles de TileSize píxeles en 8 bits por nivel de detalle: el nivel 0
+// es el mapa convertido y cada píxel del nivel L es la media de su
+// bloque de 2^L x 2^L muestras; se elige el nivel más cercano al zoom.
+// Un tile del nivel L sale de 2x2 píxeles del nivel L-1 donde ése está
+// en caché, y si no directamente del mapa con a lo sumo MaxFilterTaps^2
+// muestras por píxel, así que el coste de dibujar depende de la ventana
+// y no del mapa. Los tiles se construyen al pedirlos y se guardan en una
+// caché acotada; tras editar el mapa, invalidate() rehace sólo la zona
+// cambiada de los tiles en caché, nivel a nivel, y repinta esa zona.
+//
+// Rueda: zoom alrededor del cursor. Botón central: arrastrar para
+// desplazar; doble clic para ajustar el mapa a la ventana.
+//
+// Encima se puede mostrar una capa de contorno (la vista previa de las
+// formas) que no toca los tiles: cambiarla sólo repinta la zona que
+// cubrían el contorno anterior y el nuevo.
+//
+// Con setAccelerated(true) el dibujo pasa a un HeightmapGLView hijo que
+// guarda el mapa en una textura; el lienzo sigue llevando la vista, el
+// ratón, la vista previa y el contorno.
+
+class HeightmapCanvas : public QWidget
+{
+public:
+    static constexpr int TileSize = 256;
+
+    explicit HeightmapCanvas(QWidget *parent = nullptr);
+
+    // El mapa no se copia: debe seguir vivo mientras se muestre.
+    // Cambiarlo vacía la caché y ajusta el mapa a la ventana.
+    void setHeightField(const TiledHeightField *field);
+    // Reconvierte la zona del mapa indicada (coordenadas del mapa)
+    void invalidate(const QRect &mapRect);
+    // Vacía la caché; si el mapa cambió de tamaño, lo ajusta a la ventana
+    void invalidateAll();
+
+    // Imagen provisional de todo el mapa, una muestra de cada step, que
+    // se muestra en lugar de los tiles (vistas previas de generación)
+    void setPreview(const QImage &image, int step);
+    void clearPreview();
+    bool showingPreview() const { return !previewImage.isNull(); }
+
+    // Conversión entre píxeles del widget y coordenadas del mapa
+    QPointF widgetToMap(const QPointF &point) const;
+    QRectF mapToWidget(const QRectF &rect) const;
+    double zoom() const { return zoomFactor; }
+    void fitToView();
+
+    // Contorno en coordenadas del mapa; el grosor del lápiz es en píxeles
+    void setOverlay(const QPainterPath &path, const QPen &pen);
+    void clearOverlay();
+    bool hasOverlay() const { return !overlayPath.isEmpty(); }
+
+    // Dibujo con OpenGL en lugar de tiles convertidos en la CPU
+    void setAccelerated(bool enabled);
+    bool accelerated() const { return glView != nullptr; }
+    // Color del mapa; sólo con aceleración (sin ella, siempre gris)
+    void setShading(HeightmapGLView::Shading shading);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    friend class HeightmapGLView;
+
+    // Repinta la zona del widget indicada (todo con aceleración)
+    void refresh(const QRect &area);
+    void refresh();
+    void paintPreview(QPainter &painter) const;
+    void paintOverlay(QPainter &painter, const QRect &area) const;
+
+    // Nivel de detalle para el zoom actual (0 = una muestra por píxel)
+    int levelForZoom() const;
+    int levelCount() const;
+    static quint64 tileKey(int level, int tileX, int tileY);
+    // Tile del nivel indicado, construido si no estaba en caché. El
+    // puntero vale hasta el siguiente tile que se construya.
+    const QImage *tile(int level, int tileX, int tileY);
+    // Píxeles del nivel indicado
+    QSize levelSize(int level) const;
+    // Rehace la parte del tile que cae en levelRect (píxeles del nivel):
+    // el nivel 0 desde el mapa, los demás desde el nivel anterior en
+    // caché o, si no está, desde el mapa
+    void updateTile(QImage &image, int level, int tileX, int tileY, const QRect &levelRect);
+    // Píxeles de levelRect de un tile del nivel (level > 0) promediados
+    // directamente del mapa; firstX, firstY: primer píxel del tile
+    void filterFromField(QImage &image, int level, int firstX, int firstY, const QRect &levelRect);
+    // Zona que ocupa el contorno actual, incluido el grosor del lápiz
+    QRect overlayRect() const;
+    void setZoom(double zoom, const QPointF &anchor);
+
+    const TiledHeightField *heightField = nullptr;
+    QSize fieldSize;                        // Tamaño del mapa al vaciar la caché por última vez
+    QCache<quint64, QImage> tiles;
+    std::vector<unsigned char> rowBuffer;   // Fila de muestras para convertir tiles
+    std::vector<int> filterSums;            // Sumas por píxel en filterFromField
+
+    QImage previewImage;
+    int previewStep = 1;
+
+    double zoomFactor = 1.0;    // Píxeles del widget por muestra del mapa
+    QPointF origin;             // Punto del mapa en la esquina superior izquierda
+    bool fitPending = true;     // Ajustar al próximo cambio de tamaño hasta que el usuario mueva la vista
+    bool panning = false;
+    QPoint lastPanPosition;
+
+    QPainterPath overlayPath;
+    QPen overlayPen;
+
+    HeightmapGLView *glView = nullptr;
+    HeightmapGLView::Shading currentShading = HeightmapGLView::Shading::Grayscale;
+};
+
+#endif // HEIGHTMAPCANVAS_H
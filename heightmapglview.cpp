@@ -0,0 +1,237 @@
+#include "heightmapglview.h"
+#include "heightmapcanvas.h"
+#include <QOpenGLPixelTransferOptions>
+#include <QPainter>
+#include <QVector2D>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// Memoria para convertir filas antes de subirlas, por banda
+const std::size_t UploadBandBytes = 4 * 1024 * 1024;
+
+} // namespace
+
+HeightmapGLView::HeightmapGLView(HeightmapCanvas *canvas)
+    : QOpenGLWidget(canvas),
+      canvas(canvas)
+{
+    // El ratón es del lienzo (zoom, desplazamiento y pinceles)
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+}
+
+HeightmapGLView::~HeightmapGLView()
+{
+    makeCurrent();
+    releaseTexture();
+    delete quadVAO;
+    delete quadVBO;
+    doneCurrent();
+}
+
+void HeightmapGLView::setHeightField(const TiledHeightField *field)
+{
+    heightField = field;
+    textureDirty = true;
+    update();
+}
+
+void HeightmapGLView::invalidate(const QRect &mapRect)
+{
+    pendingRegion |= mapRect;
+    update();
+}
+
+void HeightmapGLView::invalidateAll()
+{
+    // El tamaño o la precisión pueden haber cambiado
+    textureDirty = true;
+    update();
+}
+
+void HeightmapGLView::setShading(Shading shading)
+{
+    currentShading = shading;
+    update();
+}
+
+void HeightmapGLView::setupShader()
+{
+    shader = new QOpenGLShaderProgram(this);
+    if (!shader->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/heightmap2d.vert")
+        || !shader->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/heightmap2d.frag")
+        || !shader->link()) {
+        qDebug() << "ERROR: Failed to build 2D heightmap shader:" << shader->log();
+        delete shader;
+        shader = nullptr;
+    }
+}
+
+void HeightmapGLView::initializeGL()
+{
+    initializeOpenGLFunctions();
+    setupShader();
+
+    GLint driverLimit = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &driverLimit);
+    if (driverLimit > 0) maxTextureSide = std::min(MaxTextureSide, static_cast<int>(driverLimit));
+
+    // Un único rectángulo; el vertex shader lo coloca según la vista
+    const float corners[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+    quadVAO = new QOpenGLVertexArrayObject(this);
+    quadVAO->create();
+    quadVAO->bind();
+    quadVBO = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    quadVBO->create();
+    quadVBO->bind();
+    quadVBO->allocate(corners, sizeof(corners));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+    quadVAO->release();
+    quadVBO->release();
+
+    textureDirty = true;
+}
+
+void HeightmapGLView::resizeGL(int w, int h)
+{
+    Q_UNUSED(w);
+    Q_UNUSED(h);
+}
+
+void HeightmapGLView::releaseTexture()
+{
+    delete heightTexture;
+    heightTexture = nullptr;
+}
+
+void HeightmapGLView::createTexture()
+{
+    textureDirty = false;
+    pendingRegion = QRect();
+    if (!heightField || heightField->empty()) {
+        releaseTexture();
+        return;
+    }
+
+    step = 1;
+    const int side = std::max(heightField->width(), heightField->height());
+    while ((side + step - 1) / step > maxTextureSide) step *= 2;
+    const int textureWidth = (heightField->width() + step - 1) / step;
+    const int textureHeight = (heightField->height() + step - 1) / step;
+
+    // 8 bits bastan para mapas de 8 bits; el resto se sube en 16
+    const bool wide = heightField->format() != HeightFormat::U8;
+    const QOpenGLTexture::TextureFormat textureFormat = wide ? QOpenGLTexture::R16_UNorm : QOpenGLTexture::R8_UNorm;
+
+    // Con el mismo tamaño y formato se reaprovecha la textura
+    if (!heightTexture || heightTexture->format() != textureFormat
+        || heightTexture->width() != textureWidth || heightTexture->height() != textureHeight) {
+        releaseTexture();
+        heightTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+        heightTexture->setFormat(textureFormat);
+        heightTexture->setSize(textureWidth, textureHeight);
+        heightTexture->setMipLevels(1);
+        heightTexture->setWrapMode(QOpenGLTexture::ClampToEdge);
+        heightTexture->setMinificationFilter(QOpenGLTexture::Linear);
+        heightTexture->allocateStorage(QOpenGLTexture::Red, wide ? QOpenGLTexture::UInt16 : QOpenGLTexture::UInt8);
+        if (!heightTexture->isStorageAllocated()) {
+            qDebug() << "ERROR: Failed to allocate 2D heightmap texture";
+            releaseTexture();
+            return;
+        }
+    }
+
+    pendingRegion = QRect(0, 0, heightField->width(), heightField->height());
+}
+
+void HeightmapGLView::uploadPending()
+{
+    if (!heightTexture || pendingRegion.isEmpty()) return;
+    const QRect area = pendingRegion & QRect(0, 0, heightField->width(), heightField->height());
+    pendingRegion = QRect();
+
+    // Texels cuya muestra (texel * step) cae en la zona
+    const int x0 = (area.left() + step - 1) / step;
+    const int x1 = std::min(heightTexture->width() - 1, area.right() / step);
+    const int y0 = (area.top() + step - 1) / step;
+    const int y1 = std::min(heightTexture->height() - 1, area.bottom() / step);
+    if (x1 < x0 || y1 < y0) return;
+
+    const bool wide = heightTexture->format() == QOpenGLTexture::R16_UNorm;
+    const HeightFormat format = wide ? HeightFormat::U16 : HeightFormat::U8;
+    const int bps = bytesPerSample(format);
+    const std::size_t rowBytes = static_cast<std::size_t>(heightTexture->width()) * bps;
+
+    // Las filas se convierten con la disposición completa y se sube
+    // sólo [x0, x1] de cada una
+    QOpenGLPixelTransferOptions options;
+    options.setAlignment(1);
+    options.setRowLength(heightTexture->width());
+
+    const int bandRows = static_cast<int>(std::max<std::size_t>(1, UploadBandBytes / rowBytes));
+    uploadBuffer.resize(rowBytes * std::min(bandRows, y1 - y0 + 1));
+    for (int band = y0; band <= y1; band += bandRows) {
+        const int rows = std::min(bandRows, y1 - band + 1);
+        for (int row = 0; row < rows; ++row) {
+            heightField->rowToFormat((band + row) * step, format, uploadBuffer.data() + row * rowBytes, step,
+                                     x0 * step, x1 * step + 1);
+        }
+        heightTexture->setData(x0, band, 0, x1 - x0 + 1, rows, 1, QOpenGLTexture::Red,
+                               wide ? QOpenGLTexture::UInt16 : QOpenGLTexture::UInt8,
+                               uploadBuffer.data() + static_cast<std::size_t>(x0) * bps, &options);
+    }
+}
+
+void HeightmapGLView::paintGL()
+{
+    const QColor background = canvas->palette().dark().color();
+    glClearColor(background.redF(), background.greenF(), background.blueF(), 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (!heightField || heightField->empty()) return;
+
+    // Las vistas previas de generación son pequeñas y temporales: las
+    // dibuja QPainter igual que el lienzo sin aceleración
+    if (canvas->showingPreview()) {
+        QPainter painter(this);
+        canvas->paintPreview(painter);
+        canvas->paintOverlay(painter, rect());
+        return;
+    }
+
+    if (textureDirty) createTexture();
+    uploadPending();
+
+    if (shader && heightTexture) {
+        const float zoom = static_cast<float>(canvas->zoom());
+        // Al acercar se ven las muestras, como en el lienzo por software
+        heightTexture->setMagnificationFilter(zoom >= 1.0f ? QOpenGLTexture::Nearest : QOpenGLTexture::Linear);
+
+        const float textureWidth = heightTexture->width();
+        const float textureHeight = heightTexture->height();
+        shader->bind();
+        heightTexture->bind(0);
+        shader->setUniformValue("heightSampler", 0);
+        shader->setUniformValue("mapSize", QVector2D(heightField->width(), heightField->height()));
+        shader->setUniformValue("viewSize", QVector2D(width(), height()));
+        shader->setUniformValue("origin", QVector2D(canvas->origin));
+        shader->setUniformValue("zoom", zoom);
+        shader->setUniformValue("texelScale", QVector2D(1.0f / (step * textureWidth), 1.0f / (step * textureHeight)));
+        shader->setUniformValue("texelSize", QVector2D(1.0f / textureWidth, 1.0f / textureHeight));
+        shader->setUniformValue("shading", static_cast<int>(currentShading));
+        // Misma escala vertical que la vista 3D: nivel 255 = altura 100
+        shader->setUniformValue("reliefScale", 100.0f / (2.0f * step));
+
+        quadVAO->bind();
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        quadVAO->release();
+        heightTexture->release();
+        shader->release();
+    }
+
+    if (canvas->hasOverlay()) {
+        QPainter painter(this);
+        canvas->paintOverlay(painter, rect());
+    }
+}
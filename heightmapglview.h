@@ -0,0 +1,79 @@
+#ifndef HEIGHTMAPGLVIEW_H
+#define HEIGHTMAPGLVIEW_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLTexture>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QRect>
+#include <vector>
+#include "tiledheightfield.h"
+
+class HeightmapCanvas;
+
+// =================================================================
+// === HEIGHTMAP GL VIEW
+// =================================================================
+// Dibujo acelerado del lienzo 2D. Cubre todo el HeightmapCanvas, del
+// que toma el zoom, el desplazamiento, la vista previa y el contorno;
+// los eventos de ratón los deja pasar al lienzo.
+//
+// El mapa vive en la GPU como una sola textura R8 (mapas de 8 bits) o
+// R16 (16 bits y float) y tras una edición sólo se sube el rectángulo
+// cambiado. El color (gris, falso color o sombreado) lo pone el
+// fragment shader, así que cambiar de modo no sube nada. Los mapas de
+// lado mayor que MaxTextureSide (o que el límite del driver) se suben
+// con una muestra de cada 2^n.
+
+class HeightmapGLView : public QOpenGLWidget, protected QOpenGLFunctions
+{
+public:
+    enum class Shading { Grayscale = 0, FalseColor = 1, Hillshade = 2 };
+
+    static constexpr int MaxTextureSide = 8192;
+
+    explicit HeightmapGLView(HeightmapCanvas *canvas);
+    ~HeightmapGLView();
+
+    // Vuelve a crear la textura con el mapa completo en el próximo frame
+    void setHeightField(const TiledHeightField *field);
+    // Sube la zona indicada (coordenadas del mapa) en el próximo frame
+    void invalidate(const QRect &mapRect);
+    void invalidateAll();
+
+    void setShading(Shading shading);
+    Shading shading() const { return currentShading; }
+
+protected:
+    void initializeGL() override;
+    void resizeGL(int w, int h) override;
+    void paintGL() override;
+
+private:
+    void setupShader();
+    // Prepara la textura para el mapa actual (reaprovechándola si el
+    // tamaño y el formato no cambian) y la marca entera como pendiente
+    void createTexture();
+    // Sube las filas de texels de pendingRegion, por bandas
+    void uploadPending();
+    void releaseTexture();
+
+    HeightmapCanvas *canvas;
+    const TiledHeightField *heightField = nullptr;
+    Shading currentShading = Shading::Grayscale;
+
+    QOpenGLShaderProgram *shader = nullptr;
+    QOpenGLBuffer *quadVBO = nullptr;
+    QOpenGLVertexArrayObject *quadVAO = nullptr;
+    QOpenGLTexture *heightTexture = nullptr;
+
+    int maxTextureSide = MaxTextureSide;    // Límite efectivo tras consultar el driver
+    int step = 1;                           // Muestras del mapa por texel
+    bool textureDirty = true;               // Recrear la textura (mapa o tamaño nuevo)
+    QRect pendingRegion;                    // Zona del mapa por subir
+    std::vector<unsigned char> uploadBuffer;
+};
+
+#endif // HEIGHTMAPGLVIEW_H
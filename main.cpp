@@ -1,10 +1,16 @@
 #include "mainwindow.h"
+#include "headless.h"
 #include <QApplication>
 #include <QLocale>
 #include <QTranslator>
 
 int main(int argc, char *argv[])
 {
+    // Sin interfaz: no se crea QApplication ni se abre la plataforma gráfica
+    if (Headless::requested(argc, argv)) {
+        return Headless::run(argc, argv);
+    }
+
     QApplication a(argc, argv);
 
     QTranslator translator;
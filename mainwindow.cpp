@@ -1,13 +1,18 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "openglwidget.h"
+#include "brushes.h"
+#include "floodfill.h"
+#include "terrainio.h"
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QDialog>
 #include <QVBoxLayout>
 #include <QPushButton>
 #include <QPainter>
+#include <QPainterPath>
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 #include <QEvent>
 #include <QDebug>
@@ -26,11 +31,19 @@
 #include <sstream>
 #include <QCheckBox>  // AGREGAR ESTA LÍNEA
 #include <QSlider>    // AGREGAR ESTA LÍNEA TAMBIÉN
-#include <queue>
 #include <QListWidget>
 #include <QColorDialog>
 #include <QColorSpace>
 #include <QBuffer>
+#include <QStatusBar>
+#include <QInputDialog>
+#include <QtEndian>
+#include <utility>
+#include <stdexcept>
+
+// Lado máximo de las vistas del mapa completo (3D, texturizado, vistas
+// previas de generación): los mapas mayores se reducen
+static const int MaxOverviewSize = 4096;
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -48,7 +61,7 @@ MainWindow::MainWindow(QWidget *parent)
     mapWidth = 0;
     mapHeight = 0;
     brushHeight = 128;
-    dynamicImageLabel = nullptr;
+    mapCanvas = nullptr;
 
     ui->lineEditWidth->setText("512");
     ui->lineEditHeight->setText("512");
@@ -82,6 +95,23 @@ MainWindow::MainWindow(QWidget *parent)
         ui->lineEditOffset->setText("Aleatorio");
     }
 
+    // Cambiar octavas o persistencia durante una generación la reinicia
+    // con los valores nuevos (misma semilla y desplazamiento)
+    if (ui->spinBoxOctaves) {
+        connect(ui->spinBoxOctaves, &QSpinBox::valueChanged, this, [this](int value) {
+            if (!generationRunning) return;
+            generationParams.ctx.octaves = value;
+            startGeneration();
+        });
+    }
+    if (ui->doubleSpinBoxPersistence) {
+        connect(ui->doubleSpinBoxPersistence, &QDoubleSpinBox::valueChanged, this, [this](double value) {
+            if (!generationRunning) return;
+            generationParams.ctx.persistence = value;
+            startGeneration();
+        });
+    }
+
     // Inicializar slider de color de relleno
     if (ui->sliderFillColor) {
         ui->sliderFillColor->setRange(0, 255);
@@ -126,6 +156,28 @@ MainWindow::MainWindow(QWidget *parent)
 
     menuArchivo->addSeparator();
 
+    // Precisión de almacenamiento de las alturas
+    QMenu *menuPrecision = menuArchivo->addMenu("Precisión de Altura");
+    precisionActions = new QActionGroup(this);
+    const std::pair<const char*, HeightFormat> precisionOptions[] = {
+        { "8 bits", HeightFormat::U8 },
+        { "16 bits", HeightFormat::U16 },
+        { "32 bits (float)", HeightFormat::F32 }
+    };
+    for (const auto &option : precisionOptions) {
+        QAction *actionPrecision = menuPrecision->addAction(option.first);
+        actionPrecision->setCheckable(true);
+        actionPrecision->setChecked(option.second == heightFormat);
+        actionPrecision->setData(static_cast<int>(option.second));
+        precisionActions->addAction(actionPrecision);
+        const HeightFormat format = option.second;
+        connect(actionPrecision, &QAction::triggered, this, [this, format]() {
+            setHeightFormat(format);
+        });
+    }
+
+    menuArchivo->addSeparator();
+
     QAction *actionSalir = menuArchivo->addAction("Salir");
     actionSalir->setShortcut(QKeySequence::Quit); // Ctrl+Q
     connect(actionSalir, &QAction::triggered, this, &QMainWindow::close);
@@ -141,15 +193,124 @@ MainWindow::MainWindow(QWidget *parent)
     actionRehacer->setShortcut(QKeySequence::Redo); // Ctrl+Y
     connect(actionRehacer, &QAction::triggered, this, &MainWindow::redo);
 
+    menuEdicion->addSeparator();
+    QAction *actionUndoMemory = menuEdicion->addAction("Memoria de Deshacer...");
+    connect(actionUndoMemory, &QAction::triggered, this, [this]() {
+        // Lo que no cabe va comprimido al archivo temporal del historial
+        const int usedMegabytes = static_cast<int>(undoHistory.memoryUsed() / (1024 * 1024));
+        const int diskMegabytes = static_cast<int>(undoHistory.diskUsed() / (1024 * 1024));
+        bool ok = false;
+        const int megabytes = QInputDialog::getInt(this, "Memoria de Deshacer",
+                                                   QString("Límite de RAM para el historial (MB, en uso: %1, en disco: %2):")
+                                                       .arg(usedMegabytes).arg(diskMegabytes),
+                                                   static_cast<int>(undoHistory.memoryBudget() / (1024 * 1024)),
+                                                   16, 65536, 64, &ok);
+        if (ok) undoHistory.setMemoryBudget(static_cast<std::size_t>(megabytes) * 1024 * 1024);
+    });
+
     // Menú Herramientas
     QMenu *menuHerramientas = menuBar()->addMenu("Herramientas");
 
     QAction *actionGenerar = menuHerramientas->addAction("Generar Terreno...");
     connect(actionGenerar, &QAction::triggered, this, &MainWindow::on_pushButtonGenerate_clicked);
 
+    actionCancelGeneration = menuHerramientas->addAction("Cancelar Generación");
+    actionCancelGeneration->setShortcut(QKeySequence(Qt::Key_Escape));
+    actionCancelGeneration->setEnabled(false);
+    connect(actionCancelGeneration, &QAction::triggered, this, [this]() {
+        cancelGeneration();
+        updateHeightmapDisplay();
+        statusBar()->showMessage("Generación cancelada", 3000);
+    });
+
+    // Núcleo del pincel de suavizado
+    QMenu *menuSmooth = menuHerramientas->addMenu("Pincel de Suavizado");
+    QActionGroup *smoothKernelActions = new QActionGroup(this);
+    const std::pair<const char*, Brushes::SmoothKernel> kernelOptions[] = {
+        { "Caja", Brushes::SmoothKernel::Box },
+        { "Gaussiano", Brushes::SmoothKernel::Gaussian }
+    };
+    for (const auto &option : kernelOptions) {
+        QAction *actionKernel = menuSmooth->addAction(option.first);
+        actionKernel->setCheckable(true);
+        actionKernel->setChecked(option.second == smoothKernel);
+        smoothKernelActions->addAction(actionKernel);
+        const Brushes::SmoothKernel kernel = option.second;
+        connect(actionKernel, &QAction::triggered, this, [this, kernel]() {
+            smoothKernel = kernel;
+        });
+    }
+    menuSmooth->addSeparator();
+    QAction *actionKernelRadius = menuSmooth->addAction("Radio del Núcleo...");
+    connect(actionKernelRadius, &QAction::triggered, this, [this]() {
+        bool ok = false;
+        const int radius = QInputDialog::getInt(this, "Pincel de Suavizado", "Radio del núcleo (muestras):",
+                                                smoothKernelRadius, 1, Brushes::MaxSmoothKernelRadius, 1, &ok);
+        if (ok) smoothKernelRadius = radius;
+    });
+
+    // Máscara y espaciado comunes a los pinceles circulares
+    QAction *actionHardness = menuHerramientas->addAction("Dureza del Pincel...");
+    connect(actionHardness, &QAction::triggered, this, [this]() {
+        bool ok = false;
+        const int hardness = QInputDialog::getInt(this, "Dureza del Pincel", "Dureza (%):",
+                                                  static_cast<int>(std::lround(brushHardness * 100.0)),
+                                                  0, 100, 5, &ok);
+        if (ok) brushHardness = hardness / 100.0;
+    });
+    QAction *actionTolerance = menuHerramientas->addAction("Tolerancia de Relleno...");
+    connect(actionTolerance, &QAction::triggered, this, [this]() {
+        bool ok = false;
+        const double tolerance = QInputDialog::getDouble(this, "Tolerancia de Relleno",
+                                                         "Diferencia máxima con el valor pulsado (0-255):",
+                                                         fillTolerance, 0.0, 255.0, 2, &ok);
+        if (ok) fillTolerance = tolerance;
+    });
+    QAction *actionSpacing = menuHerramientas->addAction("Espaciado del Trazo...");
+    connect(actionSpacing, &QAction::triggered, this, [this]() {
+        bool ok = false;
+        const int spacing = QInputDialog::getInt(this, "Espaciado del Trazo", "Distancia entre pinceladas (% del radio):",
+                                                 static_cast<int>(std::lround(strokeSpacing * 100.0)),
+                                                 1, 200, 5, &ok);
+        if (ok) strokeSpacing = spacing / 100.0;
+    });
+
     QAction *actionVista3D = menuHerramientas->addAction("Vista 3D");
     connect(actionVista3D, &QAction::triggered, this, &MainWindow::on_pushButtonView3D_clicked);
 
+    // Menú Ver: dibujo de la vista 2D
+    QMenu *menuVer = menuBar()->addMenu("Ver");
+
+    QAction *actionAccelerated = menuVer->addAction("Vista 2D con OpenGL");
+    actionAccelerated->setCheckable(true);
+    actionAccelerated->setChecked(acceleratedCanvas);
+    connect(actionAccelerated, &QAction::toggled, this, [this](bool enabled) {
+        acceleratedCanvas = enabled;
+        menuCanvasShading->setEnabled(enabled);
+        if (mapCanvas) mapCanvas->setAccelerated(enabled);
+    });
+
+    // Colores que calcula el shader de la vista acelerada
+    menuCanvasShading = menuVer->addMenu("Color de la Vista 2D");
+    menuCanvasShading->setEnabled(acceleratedCanvas);
+    QActionGroup *shadingActions = new QActionGroup(this);
+    const std::pair<const char*, HeightmapGLView::Shading> shadingOptions[] = {
+        { "Escala de Grises", HeightmapGLView::Shading::Grayscale },
+        { "Falso Color", HeightmapGLView::Shading::FalseColor },
+        { "Sombreado", HeightmapGLView::Shading::Hillshade }
+    };
+    for (const auto &option : shadingOptions) {
+        QAction *actionShading = menuCanvasShading->addAction(option.first);
+        actionShading->setCheckable(true);
+        actionShading->setChecked(option.second == canvasShading);
+        shadingActions->addAction(actionShading);
+        const HeightmapGLView::Shading shading = option.second;
+        connect(actionShading, &QAction::triggered, this, [this, shading]() {
+            canvasShading = shading;
+            if (mapCanvas) mapCanvas->setShading(shading);
+        });
+    }
+
     // Menú Ayuda (opcional)
     QMenu *menuAyuda = menuBar()->addMenu("Ayuda");
 
@@ -235,8 +396,9 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
-    if (dynamicImageLabel) {
-        delete dynamicImageLabel;
+    cancelGeneration();
+    if (mapCanvas) {
+        delete mapCanvas;
     }
     delete ui;
     // Ajustar tamaño inicial de la ventana
@@ -261,7 +423,7 @@ MainWindow::~MainWindow()
 
 bool MainWindow::eventFilter(QObject *watched, QEvent *event)
 {
-    if (watched == ui->scrollAreaDisplay && dynamicImageLabel)
+    if (watched == ui->scrollAreaDisplay && mapCanvas)
     {
         if (event->type() == QEvent::MouseButtonPress) {
             this->mousePressEvent(static_cast<QMouseEvent*>(event));
@@ -281,31 +443,60 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event)
 
 void MainWindow::on_pushButtonCreate_clicked()
 {
+    cancelGeneration();
+
     int newMapWidth = ui->lineEditWidth->text().toInt();
     int newMapHeight = ui->lineEditHeight->text().toInt();
 
-    if (newMapWidth < 16 || newMapHeight < 16 || newMapWidth > 4096 || newMapHeight > 4096) {
+    const int maxSize = TiledHeightField::MaxSize;
+    if (newMapWidth < 16 || newMapHeight < 16 || newMapWidth > maxSize || newMapHeight > maxSize) {
         newMapWidth = 512;
         newMapHeight = 512;
-        QMessageBox::warning(this, "Advertencia de Tamaño", "El tamaño debe estar entre 16 y 4096. Usando 512x512.");
+        QMessageBox::warning(this, "Advertencia de Tamaño",
+                             QString("El tamaño debe estar entre 16 y %1. Usando 512x512.").arg(maxSize));
         ui->lineEditWidth->setText("512");
         ui->lineEditHeight->setText("512");
     }
 
+    // Se crea aparte para conservar el mapa actual si falla
+    try {
+        HeightMapData_t created(newMapWidth, newMapHeight, heightFormat, 128);
+        heightMapData.swap(created);
+    } catch (const std::exception &e) {
+        QMessageBox::critical(this, "Error", QString("No se pudo crear el mapa: %1").arg(e.what()));
+        return;
+    }
+
     mapWidth = newMapWidth;
     mapHeight = newMapHeight;
 
-    heightMapData.assign(mapHeight, std::vector<unsigned char>(mapWidth, 128));
-    currentImage = QImage(mapWidth, mapHeight, QImage::Format_RGB32);
-
-    if (dynamicImageLabel) {
-        delete dynamicImageLabel;
-        dynamicImageLabel = nullptr;
-    }
+    resetMapView();
+    updateHeightmapDisplay();
+}
 
-    dynamicImageLabel = new QLabel(ui->scrollAreaDisplay);
-    dynamicImageLabel->setFixedSize(mapWidth, mapHeight);
-    ui->scrollAreaDisplay->setWidget(dynamicImageLabel);
+// Prepara la vista 2D y la ventana para un mapa de mapWidth x mapHeight
+// recién creado o cargado, y vacía el historial
+void MainWindow::resetMapView()
+{
+    // Las vistas del mapa completo usan una muestra de cada overviewScale
+    overviewScale = 1;
+    while (std::max(mapWidth, mapHeight) / overviewScale > MaxOverviewSize) {
+        overviewScale *= 2;
+    }
+    const int displayWidth = (mapWidth + overviewScale - 1) / overviewScale;
+    const int displayHeight = (mapHeight + overviewScale - 1) / overviewScale;
+
+    // El lienzo ocupa todo el área y hace él mismo el zoom y el desplazamiento
+    if (!mapCanvas) {
+        mapCanvas = new HeightmapCanvas(ui->scrollAreaDisplay);
+        ui->scrollAreaDisplay->setWidget(mapCanvas);
+        ui->scrollAreaDisplay->setWidgetResizable(true);
+        ui->scrollAreaDisplay->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        ui->scrollAreaDisplay->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        mapCanvas->setShading(canvasShading);
+        mapCanvas->setAccelerated(acceleratedCanvas);
+    }
+    mapCanvas->setHeightField(&heightMapData);
 
     QScreen *screen = QGuiApplication::primaryScreen();
     QRect screenGeometry = screen->availableGeometry();
@@ -317,12 +508,11 @@ void MainWindow::on_pushButtonCreate_clicked()
     int maxScrollWidth = screenGeometry.width() - CONTROL_PANEL_WIDTH - HORIZONTAL_FRAME_MARGIN;
     int maxScrollHeight = screenGeometry.height() - VERTICAL_FRAME_MARGIN;
 
-    int scrollAreaWidth = std::min(mapWidth, maxScrollWidth);
-    int scrollAreaHeight = std::min(mapHeight, maxScrollHeight);
+    int scrollAreaWidth = std::min(displayWidth, maxScrollWidth);
+    int scrollAreaHeight = std::min(displayHeight, maxScrollHeight);
 
     ui->scrollAreaDisplay->setGeometry(180, 20, scrollAreaWidth, scrollAreaHeight);
 
-    // CAMBIO: Usar las variables miembro en lugar de constantes hardcodeadas
     int requiredWidth = 180 + scrollAreaWidth + 20;
     int requiredHeight = 20 + scrollAreaHeight + 50;
 
@@ -330,36 +520,69 @@ void MainWindow::on_pushButtonCreate_clicked()
     requiredWidth = std::max(requiredWidth, originalWindowWidth);
     requiredHeight = std::max(requiredHeight, originalWindowHeight);
 
-    QSize newSize(requiredWidth, requiredHeight);
-    this->setFixedSize(newSize);
+    this->setFixedSize(QSize(requiredWidth, requiredHeight));
 
     // Limpiar historial undo/redo
-    undoStack.clear();
-    redoStack.clear();
-
-    updateHeightmapDisplay();
+    undoHistory.clear();
 }
 
 void MainWindow::updateHeightmapDisplay()
 {
-    if (mapWidth == 0 || mapHeight == 0 || !dynamicImageLabel) return;
+    if (mapWidth == 0 || mapHeight == 0 || !mapCanvas) return;
 
-    for (int y = 0; y < mapHeight; ++y) {
-        QRgb *pixel = reinterpret_cast<QRgb*>(currentImage.scanLine(y));
+    mapCanvas->clearPreview();
+    mapCanvas->invalidateAll();
 
-        for (int x = 0; x < mapWidth; ++x) {
-            unsigned char value = heightMapData[y][x];
-            *pixel = qRgb(value, value, value);
-            pixel++;
-        }
+    if (glWidget3D) {
+        glWidget3D->setHeightMapData(heightMapData.downsampled(overviewScale));
+    }
+}
+
+void MainWindow::updateHeightmapDisplay(const QRect &dirty)
+{
+    if (mapWidth == 0 || mapHeight == 0 || !mapCanvas) return;
+
+    // Si se está viendo una vista previa de generación, se vuelve al mapa completo
+    if (mapCanvas->showingPreview()) {
+        updateHeightmapDisplay();
+        return;
     }
 
-    dynamicImageLabel->setPixmap(QPixmap::fromImage(currentImage));
+    // El lienzo reconvierte sólo los tiles que cortan dirty
+    mapCanvas->invalidate(dirty);
+    updateView3D(dirty);
+}
+
+void MainWindow::updateView3D(const QRect &dirty)
+{
+    if (!glWidget3D) return;
+
+    const QRect area = dirty & QRect(0, 0, mapWidth, mapHeight);
+    if (area.isEmpty()) return;
+
+    // La vista 3D tiene una muestra de cada overviewScale: se copian las
+    // muestras de esa rejilla que caen dentro de area
+    const int s = overviewScale;
+    const int gx0 = (area.left() + s - 1) / s;
+    const int gx1 = area.right() / s;
+    const int gy0 = (area.top() + s - 1) / s;
+    const int gy1 = area.bottom() / s;
+    if (gx0 > gx1 || gy0 > gy1) return;
+
+    const HeightFormat format = heightMapData.format();
+    const int bps = bytesPerSample(format);
+    HeightField patch(gx1 - gx0 + 1, gy1 - gy0 + 1, format);
+    std::vector<unsigned char> row(static_cast<size_t>((mapWidth + s - 1) / s) * bps);
+    for (int gy = gy0; gy <= gy1; ++gy) {
+        heightMapData.rowToFormat(gy * s, format, row.data(), s, gx0 * s, gx1 * s + 1);
+        std::memcpy(patch.rowBytes(gy - gy0), row.data() + static_cast<size_t>(gx0) * bps, patch.rowSizeInBytes());
+    }
+    glWidget3D->updateHeightRegion(patch, gx0, gy0);
 }
 
 void MainWindow::on_pushButtonSave_clicked()
 {
-    if (mapWidth == 0 || mapHeight == 0 || !dynamicImageLabel) {
+    if (mapWidth == 0 || mapHeight == 0 || !mapCanvas) {
         QMessageBox::warning(this, "Error", "Cree un mapa primero.");
         return;
     }
@@ -367,7 +590,14 @@ void MainWindow::on_pushButtonSave_clicked()
     QString fileName = QFileDialog::getSaveFileName(this, "Guardar Heightmap", "", "PNG Files (*.png)");
     if (fileName.isEmpty()) return;
 
-    if (currentImage.save(fileName, "PNG")) {
+    // QImage necesita el mapa entero en memoria
+    if (!TerrainIO::fitsInPng(heightMapData)) {
+        QMessageBox::warning(this, "Error", "El mapa es demasiado grande para PNG. Guárdelo como HMT.");
+        return;
+    }
+
+    // Con más de 8 bits se guarda un PNG de 16 bits en escala de grises
+    if (TerrainIO::savePng(heightMapData, fileName)) {
         QMessageBox::information(this, "Éxito", "Heightmap guardado.");
     } else {
         QMessageBox::critical(this, "Error", "No se pudo guardar el archivo.");
@@ -387,70 +617,47 @@ void MainWindow::on_pushButtonLoad_clicked()
         return;
     }
 
+    // Los PNG de 16 bits (grises o RGB) conservan su precisión
+    const bool is16Bit = loadedImage.format() == QImage::Format_Grayscale16 || loadedImage.depth() == 64;
+
     // Convertir a escala de grises si no lo está
-    loadedImage = loadedImage.convertToFormat(QImage::Format_Grayscale8);
+    loadedImage = loadedImage.convertToFormat(is16Bit ? QImage::Format_Grayscale16 : QImage::Format_Grayscale8);
 
-    mapWidth = loadedImage.width();
-    mapHeight = loadedImage.height();
+    cancelGeneration();
+    const int loadedWidth = loadedImage.width();
+    const int loadedHeight = loadedImage.height();
 
     // Validar dimensiones
-    if (mapWidth < 16 || mapHeight < 16 || mapWidth > 4096 || mapHeight > 4096) {
-        QMessageBox::warning(this, "Error", "Las dimensiones deben estar entre 16 y 4096.");
+    const int maxSize = TiledHeightField::MaxSize;
+    if (loadedWidth < 16 || loadedHeight < 16 || loadedWidth > maxSize || loadedHeight > maxSize) {
+        QMessageBox::warning(this, "Error", QString("Las dimensiones deben estar entre 16 y %1.").arg(maxSize));
         return;
     }
 
-    // Copiar datos de la imagen a heightMapData
-    heightMapData.assign(mapHeight, std::vector<unsigned char>(mapWidth, 0));
-    for (int y = 0; y < mapHeight; ++y) {
-        const uchar *line = loadedImage.scanLine(y);
-        for (int x = 0; x < mapWidth; ++x) {
-            heightMapData[y][x] = line[x];
+    // Copiar datos de la imagen a heightMapData por bandas de tiles
+    const HeightFormat fileFormat = is16Bit ? HeightFormat::U16 : HeightFormat::U8;
+    try {
+        HeightMapData_t loaded(loadedWidth, loadedHeight, fileFormat, 0);
+        HeightField band;
+        for (int bandY = 0; bandY < loadedHeight; bandY += TiledHeightField::TileSize) {
+            band.assign(loadedWidth, std::min(TiledHeightField::TileSize, loadedHeight - bandY), fileFormat, 0);
+            for (int y = 0; y < band.height(); ++y) {
+                std::memcpy(band.rowBytes(y), loadedImage.constScanLine(bandY + y), band.rowSizeInBytes());
+            }
+            loaded.writeRegion(band, 0, bandY);
         }
+        heightMapData.swap(loaded);
+    } catch (const std::exception &e) {
+        QMessageBox::critical(this, "Error", QString("No se pudo cargar el mapa: %1").arg(e.what()));
+        return;
     }
+    loadedImage = QImage();
 
-    currentImage = loadedImage.convertToFormat(QImage::Format_RGB32);
-
-    // Actualizar UI
-    if (dynamicImageLabel) {
-        delete dynamicImageLabel;
-        dynamicImageLabel = nullptr;
-    }
-
-    dynamicImageLabel = new QLabel(ui->scrollAreaDisplay);
-    dynamicImageLabel->setFixedSize(mapWidth, mapHeight);
-    ui->scrollAreaDisplay->setWidget(dynamicImageLabel);
-
-    // Ajustar la ventana
-    QScreen *screen = QGuiApplication::primaryScreen();
-    QRect screenGeometry = screen->availableGeometry();
-
-    const int CONTROL_PANEL_WIDTH = 173;
-    const int HORIZONTAL_FRAME_MARGIN = 50;
-    const int VERTICAL_FRAME_MARGIN = 150;
-
-    int maxScrollWidth = screenGeometry.width() - CONTROL_PANEL_WIDTH - HORIZONTAL_FRAME_MARGIN;
-    int maxScrollHeight = screenGeometry.height() - VERTICAL_FRAME_MARGIN;
-
-    int scrollAreaWidth = std::min(mapWidth, maxScrollWidth);
-    int scrollAreaHeight = std::min(mapHeight, maxScrollHeight);
-
-    ui->scrollAreaDisplay->setGeometry(180, 20, scrollAreaWidth, scrollAreaHeight);
-
-    // CAMBIO: Usar las variables miembro en lugar de constantes hardcodeadas
-    int requiredWidth = 180 + scrollAreaWidth + 20;
-    int requiredHeight = 20 + scrollAreaHeight + 50;
-
-    // Usar el máximo entre el tamaño calculado y el tamaño original
-    requiredWidth = std::max(requiredWidth, originalWindowWidth);
-    requiredHeight = std::max(requiredHeight, originalWindowHeight);
-
-    QSize newSize(requiredWidth, requiredHeight);
-    this->setFixedSize(newSize);
-
-    // Limpiar historial
-    undoStack.clear();
-    redoStack.clear();
+    mapWidth = loadedWidth;
+    mapHeight = loadedHeight;
+    adoptLoadedPrecision();
 
+    resetMapView();
     updateHeightmapDisplay();
     QMessageBox::information(this, "Éxito", "Heightmap cargado correctamente.");
 }
@@ -473,204 +680,37 @@ void MainWindow::on_pushButtonExport3D_clicked()
     bool isOBJ = fileName.endsWith(".obj", Qt::CaseInsensitive);
     bool isSTL = fileName.endsWith(".stl", Qt::CaseInsensitive);
     bool isSTLBinary = isSTL && selectedFilter.contains("Binary", Qt::CaseInsensitive);
-    bool isSTLASCII = isSTL && !isSTLBinary;
-
-    // NUEVO: Umbral de altura mínima para exportar (ajustable)
-    const unsigned char HEIGHT_THRESHOLD = 5; // Píxeles con altura < 5 se ignoran
 
+    // Alturas por debajo de TerrainIO::ExportHeightThreshold se ignoran
     if (isOBJ) {
-        // === EXPORTAR OBJ CON FILTRADO ===
-        QFile file(fileName);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qint64 vertexCount = 0;
+        if (!TerrainIO::exportObj(heightMapData, fileName, &vertexCount)) {
             QMessageBox::critical(this, "Error", "No se pudo crear el archivo.");
             return;
         }
-
-        QTextStream out(&file);
-
-        // Crear mapeo de coordenadas a índices de vértices
-        std::vector<std::vector<int>> vertexIndexMap(mapHeight, std::vector<int>(mapWidth, -1));
-        int vertexIndex = 1; // OBJ usa índices 1-based
-
-        // Escribir solo vértices con altura > umbral
-        for (int y = 0; y < mapHeight; ++y) {
-            for (int x = 0; x < mapWidth; ++x) {
-                if (heightMapData[y][x] > HEIGHT_THRESHOLD) {
-                    float height = heightMapData[y][x] / 255.0f * 100.0f;
-                    out << "v " << x << " " << height << " " << y << "\n";
-                    vertexIndexMap[y][x] = vertexIndex++;
-                }
-            }
-        }
-
-        // Escribir coordenadas de textura solo para vértices exportados
-        for (int y = 0; y < mapHeight; ++y) {
-            for (int x = 0; x < mapWidth; ++x) {
-                if (vertexIndexMap[y][x] != -1) {
-                    out << "vt " << (float)x/mapWidth << " " << (float)y/mapHeight << "\n";
-                }
-            }
-        }
-
-        // Escribir caras solo si todos los vértices existen
-        for (int y = 0; y < mapHeight - 1; ++y) {
-            for (int x = 0; x < mapWidth - 1; ++x) {
-                int topLeft = vertexIndexMap[y][x];
-                int topRight = vertexIndexMap[y][x+1];
-                int bottomLeft = vertexIndexMap[y+1][x];
-                int bottomRight = vertexIndexMap[y+1][x+1];
-
-                // Solo crear triángulos si todos los vértices existen
-                if (topLeft != -1 && topRight != -1 && bottomLeft != -1 && bottomRight != -1) {
-                    out << "f " << topLeft << "/" << topLeft << " "
-                        << bottomLeft << "/" << bottomLeft << " "
-                        << topRight << "/" << topRight << "\n";
-
-                    out << "f " << topRight << "/" << topRight << " "
-                        << bottomLeft << "/" << bottomLeft << " "
-                        << bottomRight << "/" << bottomRight << "\n";
-                }
-            }
-        }
-
-        file.close();
         QMessageBox::information(this, "Éxito",
                                  QString("Modelo OBJ exportado correctamente.\nVértices exportados: %1")
-                                     .arg(vertexIndex - 1));
-
-    } else if (isSTLASCII) {
-        // === EXPORTAR STL ASCII CON FILTRADO ===
-        QFile file(fileName);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            QMessageBox::critical(this, "Error", "No se pudo crear el archivo.");
-            return;
-        }
+                                     .arg(vertexCount));
 
-        QTextStream out(&file);
-        out << "solid heightmap\n";
-
-        int triangleCount = 0;
-
-        for (int y = 0; y < mapHeight - 1; ++y) {
-            for (int x = 0; x < mapWidth - 1; ++x) {
-                // Solo exportar triángulos si al menos un vértice tiene altura > umbral
-                bool hasSignificantHeight =
-                    heightMapData[y][x] > HEIGHT_THRESHOLD ||
-                    heightMapData[y][x+1] > HEIGHT_THRESHOLD ||
-                    heightMapData[y+1][x] > HEIGHT_THRESHOLD ||
-                    heightMapData[y+1][x+1] > HEIGHT_THRESHOLD;
-
-                if (!hasSignificantHeight) continue;
-
-                float h1 = heightMapData[y][x] / 255.0f * 100.0f;
-                float h2 = heightMapData[y][x+1] / 255.0f * 100.0f;
-                float h3 = heightMapData[y+1][x] / 255.0f * 100.0f;
-                float h4 = heightMapData[y+1][x+1] / 255.0f * 100.0f;
-
-                // Primer triángulo
-                out << "  facet normal 0 1 0\n";
-                out << "    outer loop\n";
-                out << "      vertex " << x << " " << h1 << " " << y << "\n";
-                out << "      vertex " << x << " " << h3 << " " << (y+1) << "\n";
-                out << "      vertex " << (x+1) << " " << h2 << " " << y << "\n";
-                out << "    endloop\n";
-                out << "  endfacet\n";
-                triangleCount++;
-
-                // Segundo triángulo
-                out << "  facet normal 0 1 0\n";
-                out << "    outer loop\n";
-                out << "      vertex " << (x+1) << " " << h2 << " " << y << "\n";
-                out << "      vertex " << x << " " << h3 << " " << (y+1) << "\n";
-                out << "      vertex " << (x+1) << " " << h4 << " " << (y+1) << "\n";
-                out << "    endloop\n";
-                out << "  endfacet\n";
-                triangleCount++;
-            }
-        }
-
-        out << "endsolid heightmap\n";
-        file.close();
-        QMessageBox::information(this, "Éxito",
-                                 QString("Modelo STL ASCII exportado correctamente.\nTriángulos: %1")
-                                     .arg(triangleCount));
-
-    } else if (isSTLBinary) {
-        // === EXPORTAR STL BINARIO CON FILTRADO ===
-        QFile file(fileName);
-        if (!file.open(QIODevice::WriteOnly)) {
+    } else if (isSTL) {
+        qint64 triangleCount = 0;
+        if (!TerrainIO::exportStl(heightMapData, fileName, isSTLBinary, &triangleCount)) {
             QMessageBox::critical(this, "Error", "No se pudo crear el archivo.");
             return;
         }
 
-        // Primero contar triángulos válidos
-        uint32_t numTriangles = 0;
-        for (int y = 0; y < mapHeight - 1; ++y) {
-            for (int x = 0; x < mapWidth - 1; ++x) {
-                bool hasSignificantHeight =
-                    heightMapData[y][x] > HEIGHT_THRESHOLD ||
-                    heightMapData[y][x+1] > HEIGHT_THRESHOLD ||
-                    heightMapData[y+1][x] > HEIGHT_THRESHOLD ||
-                    heightMapData[y+1][x+1] > HEIGHT_THRESHOLD;
-
-                if (hasSignificantHeight) {
-                    numTriangles += 2;
-                }
-            }
-        }
-
-        QDataStream out(&file);
-        out.setByteOrder(QDataStream::LittleEndian);
-        out.setFloatingPointPrecision(QDataStream::SinglePrecision);
-
-        // Header (80 bytes)
-        QByteArray header(80, 0);
-        QString headerText = "HeightMapGen Binary STL Export (Filtered)";
-        header.replace(0, headerText.length(), headerText.toUtf8());
-        file.write(header);
-
-        // Número de triángulos
-        out << numTriangles;
-
-        // Escribir triángulos filtrados
-        for (int y = 0; y < mapHeight - 1; ++y) {
-            for (int x = 0; x < mapWidth - 1; ++x) {
-                bool hasSignificantHeight =
-                    heightMapData[y][x] > HEIGHT_THRESHOLD ||
-                    heightMapData[y][x+1] > HEIGHT_THRESHOLD ||
-                    heightMapData[y+1][x] > HEIGHT_THRESHOLD ||
-                    heightMapData[y+1][x+1] > HEIGHT_THRESHOLD;
-
-                if (!hasSignificantHeight) continue;
-
-                float h1 = heightMapData[y][x] / 255.0f * 100.0f;
-                float h2 = heightMapData[y][x+1] / 255.0f * 100.0f;
-                float h3 = heightMapData[y+1][x] / 255.0f * 100.0f;
-                float h4 = heightMapData[y+1][x+1] / 255.0f * 100.0f;
-
-                // Primer triángulo
-                out << 0.0f << 1.0f << 0.0f;
-                out << (float)x << h1 << (float)y;
-                out << (float)x << h3 << (float)(y+1);
-                out << (float)(x+1) << h2 << (float)y;
-                out << (uint16_t)0;
-
-                // Segundo triángulo
-                out << 0.0f << 1.0f << 0.0f;
-                out << (float)(x+1) << h2 << (float)y;
-                out << (float)x << h3 << (float)(y+1);
-                out << (float)(x+1) << h4 << (float)(y+1);
-                out << (uint16_t)0;
-            }
+        if (isSTLBinary) {
+            QMessageBox::information(this, "Éxito",
+                                     QString("Modelo STL Binario exportado correctamente.\n"
+                                             "Triángulos: %1\n"
+                                             "Tamaño: %2 KB")
+                                         .arg(triangleCount)
+                                         .arg(QFileInfo(fileName).size() / 1024));
+        } else {
+            QMessageBox::information(this, "Éxito",
+                                     QString("Modelo STL ASCII exportado correctamente.\nTriángulos: %1")
+                                         .arg(triangleCount));
         }
-
-        file.close();
-        QMessageBox::information(this, "Éxito",
-                                 QString("Modelo STL Binario exportado correctamente.\n"
-                                         "Triángulos: %1\n"
-                                         "Tamaño: %2 KB")
-                                     .arg(numTriangles)
-                                     .arg(file.size() / 1024));
     }
 }
 
@@ -691,140 +731,30 @@ void MainWindow::on_pushButtonImport3D_clicked()
         return;
     }
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::critical(this, "Error", "No se pudo abrir el archivo.");
+    cancelGeneration();
+    TerrainIO::ImportResult result;
+    try {
+        result = TerrainIO::importMesh(fileName, heightFormat, heightMapData);
+    } catch (const std::exception &e) {
+        QMessageBox::critical(this, "Error", QString("No se pudo crear el mapa: %1").arg(e.what()));
         return;
     }
 
-    // Estructuras para almacenar vértices
-    std::vector<float> vertices_x, vertices_y, vertices_z;
-
-    QTextStream in(&file);
-
-    if (isOBJ) {
-        // === PARSEAR OBJ ===
-        while (!in.atEnd()) {
-            QString line = in.readLine().trimmed();
-            if (line.startsWith("v ")) {
-                QStringList parts = line.split(' ', Qt::SkipEmptyParts);
-                if (parts.size() >= 4) {
-                    vertices_x.push_back(parts[1].toFloat());
-                    vertices_y.push_back(parts[2].toFloat());
-                    vertices_z.push_back(parts[3].toFloat());
-                }
-            }
-        }
-    } else if (isSTL) {
-        // === PARSEAR STL ===
-        while (!in.atEnd()) {
-            QString line = in.readLine().trimmed();
-            if (line.startsWith("vertex")) {
-                QStringList parts = line.split(' ', Qt::SkipEmptyParts);
-                if (parts.size() >= 4) {
-                    vertices_x.push_back(parts[1].toFloat());
-                    vertices_y.push_back(parts[2].toFloat());
-                    vertices_z.push_back(parts[3].toFloat());
-                }
-            }
-        }
+    if (result == TerrainIO::ImportResult::OpenFailed) {
+        QMessageBox::critical(this, "Error", "No se pudo abrir el archivo.");
+        return;
     }
-
-    file.close();
-
-    if (vertices_x.empty()) {
+    if (result == TerrainIO::ImportResult::NoVertices) {
         QMessageBox::warning(this, "Error", "No se encontraron vértices en el archivo.");
         return;
     }
 
-    // === CONVERTIR A HEIGHTMAP ===
-
-    // Encontrar límites
-    float minX = *std::min_element(vertices_x.begin(), vertices_x.end());
-    float maxX = *std::max_element(vertices_x.begin(), vertices_x.end());
-    float minZ = *std::min_element(vertices_z.begin(), vertices_z.end());
-    float maxZ = *std::max_element(vertices_z.begin(), vertices_z.end());
-    float minY = *std::min_element(vertices_y.begin(), vertices_y.end());
-    float maxY = *std::max_element(vertices_y.begin(), vertices_y.end());
-
-    float rangeX = maxX - minX;
-    float rangeZ = maxZ - minZ;
-
-    // Calcular dimensiones basadas en el rango real
-    int targetWidth = static_cast<int>(std::ceil(rangeX));
-    int targetHeight = static_cast<int>(std::ceil(rangeZ));
-
-    // Validar dimensiones (mantener entre 16 y 4096)
-    if (targetWidth < 16) targetWidth = 16;
-    if (targetHeight < 16) targetHeight = 16;
-    if (targetWidth > 4096) targetWidth = 4096;
-    if (targetHeight > 4096) targetHeight = 4096;
-
-    mapWidth = targetWidth;
-    mapHeight = targetHeight;
-
-    // Inicializar heightmap con valores mínimos
-    heightMapData.assign(mapHeight, std::vector<unsigned char>(mapWidth, 0));
-
-    // Proyectar vértices al heightmap
-    for (size_t i = 0; i < vertices_x.size(); ++i) {
-        // Normalizar coordenadas X,Z al rango del heightmap
-        int x = static_cast<int>((vertices_x[i] - minX) / rangeX * (mapWidth - 1));
-        int z = static_cast<int>((vertices_z[i] - minZ) / rangeZ * (mapHeight - 1));
-
-        // Normalizar altura Y al rango 0-255
-        float normalizedY = (vertices_y[i] - minY) / (maxY - minY);
-        unsigned char heightValue = static_cast<unsigned char>(normalizedY * 255.0f);
-
-        // Tomar el valor máximo si hay múltiples vértices en la misma posición
-        if (x >= 0 && x < mapWidth && z >= 0 && z < mapHeight) {
-            heightMapData[z][x] = std::max(heightMapData[z][x], heightValue);
-        }
-    }
+    mapWidth = heightMapData.width();
+    mapHeight = heightMapData.height();
 
     // === ACTUALIZAR UI ===
 
-    if (dynamicImageLabel) {
-        delete dynamicImageLabel;
-        dynamicImageLabel = nullptr;
-    }
-
-    dynamicImageLabel = new QLabel(ui->scrollAreaDisplay);
-    dynamicImageLabel->setFixedSize(mapWidth, mapHeight);
-    ui->scrollAreaDisplay->setWidget(dynamicImageLabel);
-
-    currentImage = QImage(mapWidth, mapHeight, QImage::Format_RGB32);
-
-    // Ajustar ventana
-    QScreen *screen = QGuiApplication::primaryScreen();
-    QRect screenGeometry = screen->availableGeometry();
-
-    const int CONTROL_PANEL_WIDTH = 173;
-    const int HORIZONTAL_FRAME_MARGIN = 50;
-    const int VERTICAL_FRAME_MARGIN = 150;
-
-    int maxScrollWidth = screenGeometry.width() - CONTROL_PANEL_WIDTH - HORIZONTAL_FRAME_MARGIN;
-    int maxScrollHeight = screenGeometry.height() - VERTICAL_FRAME_MARGIN;
-
-    int scrollAreaWidth = std::min(mapWidth, maxScrollWidth);
-    int scrollAreaHeight = std::min(mapHeight, maxScrollHeight);
-
-    ui->scrollAreaDisplay->setGeometry(180, 20, scrollAreaWidth, scrollAreaHeight);
-
-    // CAMBIO: Usar las variables miembro en lugar de constantes hardcodeadas
-    int requiredWidth = 180 + scrollAreaWidth + 20;
-    int requiredHeight = 20 + scrollAreaHeight + 50;
-
-    // Usar el máximo entre el tamaño calculado y el tamaño original
-    requiredWidth = std::max(requiredWidth, originalWindowWidth);
-    requiredHeight = std::max(requiredHeight, originalWindowHeight);
-
-    this->setFixedSize(QSize(requiredWidth, requiredHeight));
-
-    // Limpiar historial
-    undoStack.clear();
-    redoStack.clear();
-
+    resetMapView();
     updateHeightmapDisplay();
 
     QString format = isOBJ ? "OBJ" : "STL";
@@ -835,8 +765,10 @@ void MainWindow::on_pushButtonImport3D_clicked()
 
 QPoint MainWindow::mapToDataCoordinates(int screenX, int screenY)
 {
-    int dataX = screenX;
-    int dataY = screenY;
+    // El lienzo sabe el zoom y el desplazamiento actuales
+    const QPointF mapPos = mapCanvas->widgetToMap(QPointF(screenX, screenY));
+    int dataX = static_cast<int>(std::floor(mapPos.x()));
+    int dataY = static_cast<int>(std::floor(mapPos.y()));
 
     return QPoint(
         std::min(std::max(dataX, 0), mapWidth - 1),
@@ -844,471 +776,81 @@ QPoint MainWindow::mapToDataCoordinates(int screenX, int screenY)
         );
 }
 
-void MainWindow::applyBrush(int mapX, int mapY)
+QRect MainWindow::applyBrush(int mapX, int mapY)
 {
-    if (!ui->sliderBrushSize) return;
-
-    int brushRadius = ui->sliderBrushSize->value();
-    if (brushRadius < 1) brushRadius = 1;
-    double brushRadiusSq = static_cast<double>(brushRadius) * brushRadius;
-
-    if (mapX < 0 || mapX >= mapWidth || mapY < 0 || mapY >= mapHeight) return;
-
-    int minX = std::max(0, mapX - brushRadius);
-    int maxX = std::min(mapWidth - 1, mapX + brushRadius);
-    int minY = std::max(0, mapY - brushRadius);
-    int maxY = std::min(mapHeight - 1, mapY + brushRadius);
+    if (!ui->sliderBrushSize) return QRect();
 
     double intensityFactor = 0.3;
     if (ui->sliderBrushIntensity) {
         intensityFactor = ui->sliderBrushIntensity->value() / 100.0;
     }
 
-    for (int y = minY; y <= maxY; ++y) {
-        for (int x = minX; x <= maxX; ++x) {
-            double distSq = std::pow(static_cast<double>(x - mapX), 2) +
-                            std::pow(static_cast<double>(y - mapY), 2);
-
-            if (distSq <= brushRadiusSq) {
-                double intensity = 1.0 - (distSq / brushRadiusSq);
-
-                int currentValue = heightMapData[y][x];
-                int targetValue = static_cast<int>(currentValue + (brushHeight - currentValue) * intensity * intensityFactor);
-
-                heightMapData[y][x] = static_cast<unsigned char>(std::min(std::max(targetValue, 0), 255));
-            }
-        }
-    }
-
-    updateHeightmapDisplay();
-}
-
-// =================================================================
-// === PERLIN NOISE FUNCTIONS
-// =================================================================
-
-void MainWindow::initializePerlin()
-{
-    p.resize(256);
-    std::iota(p.begin(), p.end(), 0);
-
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::shuffle(p.begin(), p.end(), std::default_random_engine(seed));
-
-    p.insert(p.end(), p.begin(), p.end());
-
-    std::mt19937 gen(std::chrono::system_clock::now().time_since_epoch().count());
-    std::uniform_real_distribution<> distrib(100.0, 5000.0);
-    frequencyOffset = distrib(gen);
-}
-
-double MainWindow::fade(double t)
-{
-    return t * t * t * (t * (t * 6 - 15) + 10);
-}
-
-double MainWindow::lerp(double t, double a, double b)
-{
-    return a + t * (b - a);
-}
-
-double MainWindow::grad(int hash, double x, double y, double z)
-{
-    int h = hash & 15;
-    double u = (h < 8) ? x : y;
-    double v = (h < 4) ? y : ((h == 12 || h == 14) ? x : z);
-    return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
-}
-
-double MainWindow::perlin(double x, double y)
-{
-    if (p.empty()) initializePerlin();
-
-    int X = (int)std::floor(x);
-    int Y = (int)std::floor(y);
-
-    x -= std::floor(x);
-    y -= std::floor(y);
-    double z = 0.0;
-
-    double u = fade(x);
-    double v = fade(y);
-
-    int A = p[(X & 255)] + (Y & 255);
-    int B = p[(X + 1) & 255] + (Y & 255);
-
-    int AA = p[A & 511] + 0;
-    int AB = p[B & 511] + 0;
-    int BA = p[A & 511] + 1;
-    int BB = p[B & 511] + 1;
-
-    return lerp(v, lerp(u, grad(p[AA], x, y, z),
-                        grad(p[BA], x - 1, y, z)),
-                lerp(u, grad(p[AB], x, y - 1, z),
-                     grad(p[BB], x - 1, y - 1, z)));
-}
-
-double MainWindow::fbm(double x, double y)
-{
-    double total = 0.0;
-    double amplitude = 1.0;
-    double freq = 1.0;
-    double maxVal = 0.0;
-
-    for (int i = 0; i < octaves; ++i) {
-        total += perlin(x * freq, y * freq) * amplitude;
-        maxVal += amplitude;
-
-        amplitude *= persistence;
-        freq *= 2.0;
-    }
-
-    return total / maxVal;
-}
-
-// =================================================================
-// === SIMPLEX NOISE IMPLEMENTATION
-// =================================================================
-
-double MainWindow::simplexNoise(double xin, double yin)
-{
-    if (p.empty()) initializePerlin();
-
-    const double F2 = 0.5 * (std::sqrt(3.0) - 1.0);
-    const double G2 = (3.0 - std::sqrt(3.0)) / 6.0;
-
-    double s = (xin + yin) * F2;
-    int i = std::floor(xin + s);
-    int j = std::floor(yin + s);
-
-    double t = (i + j) * G2;
-    double X0 = i - t;
-    double Y0 = j - t;
-    double x0 = xin - X0;
-    double y0 = yin - Y0;
-
-    int i1, j1;
-    if (x0 > y0) { i1 = 1; j1 = 0; }
-    else { i1 = 0; j1 = 1; }
-
-    double x1 = x0 - i1 + G2;
-    double y1 = y0 - j1 + G2;
-    double x2 = x0 - 1.0 + 2.0 * G2;
-    double y2 = y0 - 1.0 + 2.0 * G2;
-
-    int ii = i & 255;
-    int jj = j & 255;
-    int gi0 = p[ii + p[jj]] % 12;
-    int gi1 = p[ii + i1 + p[jj + j1]] % 12;
-    int gi2 = p[ii + 1 + p[jj + 1]] % 12;
-
-    double n0 = 0.0, n1 = 0.0, n2 = 0.0;
-
-    double t0 = 0.5 - x0*x0 - y0*y0;
-    if (t0 > 0) {
-        t0 *= t0;
-        n0 = t0 * t0 * (grad3[gi0][0]*x0 + grad3[gi0][1]*y0);
-    }
-
-    double t1 = 0.5 - x1*x1 - y1*y1;
-    if (t1 > 0) {
-        t1 *= t1;
-        n1 = t1 * t1 * (grad3[gi1][0]*x1 + grad3[gi1][1]*y1);
-    }
-
-    double t2 = 0.5 - x2*x2 - y2*y2;
-    if (t2 > 0) {
-        t2 *= t2;
-        n2 = t2 * t2 * (grad3[gi2][0]*x2 + grad3[gi2][1]*y2);
-    }
-
-    return 70.0 * (n0 + n1 + n2);
-}
-
-// =================================================================
-// === VORONOI NOISE IMPLEMENTATION
-// =================================================================
-
-double MainWindow::voronoiNoise(double x, double y, int numPoints)
-{
-    // Determinar la celda actual en una cuadrícula
-    int cellX = static_cast<int>(std::floor(x));
-    int cellY = static_cast<int>(std::floor(y));
-
-    double minDist = std::numeric_limits<double>::max();
-
-    // Buscar en la celda actual y las 8 celdas vecinas
-    for (int offsetY = -1; offsetY <= 1; ++offsetY) {
-        for (int offsetX = -1; offsetX <= 1; ++offsetX) {
-            int neighborX = cellX + offsetX;
-            int neighborY = cellY + offsetY;
-
-            // Generar punto aleatorio para esta celda usando hash
-            unsigned int seed = static_cast<unsigned int>(neighborX * 374761393 + neighborY * 668265263);
-            seed = (seed ^ (seed >> 13)) * 1274126177;
-
-            double pointX = neighborX + (seed & 0xFFFF) / 65535.0;
-            seed = (seed ^ (seed >> 16)) * 85734257;
-            double pointY = neighborY + (seed & 0xFFFF) / 65535.0;
-
-            // Calcular distancia
-            double dx = x - pointX;
-            double dy = y - pointY;
-            double dist = std::sqrt(dx * dx + dy * dy);
-
-            if (dist < minDist) {
-                minDist = dist;
-            }
-        }
-    }
-
-    // Normalizar: la distancia máxima típica en una celda es ~1.414 (diagonal)
-    // Mapear [0, 1.5] a [-1, 1]
-    return (std::min(minDist / 1.5, 1.0) * 2.0) - 1.0;
-}
-
-double MainWindow::voronoiFbm(double x, double y)
-{
-    double total = 0.0;
-    double amplitude = 1.0;
-    double freq = 1.0;
-    double maxVal = 0.0;
-
-    for (int i = 0; i < octaves; ++i) {
-        total += voronoiNoise(x * freq, y * freq, voronoiNumPoints) * amplitude;
-        maxVal += amplitude;
-
-        amplitude *= persistence;
-        freq *= 2.0;
-    }
-
-    return total / maxVal;
-}
-
-// =================================================================
-// === RIDGED MULTIFRACTAL IMPLEMENTATION
-// =================================================================
-
-double MainWindow::ridgedMultifractal(double x, double y)
-{
-    double total = 0.0;
-    double amplitude = 1.0;
-    double freq = 1.0;
-    double maxVal = 0.0;
-
-    for (int i = 0; i < octaves; ++i) {
-        // Obtener ruido base (usando Perlin)
-        double noiseValue = perlin(x * freq, y * freq);
-
-        // Aplicar transformación ridged: invertir y tomar valor absoluto
-        noiseValue = 1.0 - std::abs(noiseValue);
-
-        // Elevar al cuadrado para acentuar las crestas
-        noiseValue = noiseValue * noiseValue;
-
-        total += noiseValue * amplitude;
-        maxVal += amplitude;
-
-        amplitude *= persistence;
-        freq *= 2.0;
-    }
-
-    return (total / maxVal) * 2.0 - 1.0;
-}
-
-// =================================================================
-// === BILLOWY NOISE IMPLEMENTATION
-// =================================================================
-
-double MainWindow::billowyNoise(double x, double y)
-{
-    // Billowy usa valor absoluto del ruido para crear formas redondeadas
-    double noiseValue = perlin(x, y);
-    return std::abs(noiseValue) * 2.0 - 1.0;
-}
-
-double MainWindow::billowyFbm(double x, double y)
-{
-    double total = 0.0;
-    double amplitude = 1.0;
-    double freq = 1.0;
-    double maxVal = 0.0;
-
-    for (int i = 0; i < octaves; ++i) {
-        double noiseValue = perlin(x * freq, y * freq);
-        noiseValue = std::abs(noiseValue);
-
-        total += noiseValue * amplitude;
-        maxVal += amplitude;
-
-        amplitude *= persistence;
-        freq *= 2.0;
-    }
-
-    return (total / maxVal) * 2.0 - 1.0;
+    return Brushes::raiseLower(heightMapData, mapX, mapY, ui->sliderBrushSize->value(),
+                               brushHeight, intensityFactor, brushHardness);
 }
 
-// =================================================================
-// === DOMAIN WARPING IMPLEMENTATION
-// =================================================================
-
-double MainWindow::domainWarp(double x, double y, double warpStrength)
-{
-    // Usar dos capas de ruido para distorsionar las coordenadas
-    double warpX = perlin(x * 0.5, y * 0.5) * warpStrength;
-    double warpY = perlin(x * 0.5 + 100.0, y * 0.5 + 100.0) * warpStrength;
-
-    // Aplicar la distorsión y obtener el ruido final
-    double warpedX = x + warpX;
-    double warpedY = y + warpY;
-
-    return fbm(warpedX, warpedY);
-}
-
-
-double MainWindow::simplexFbm(double x, double y)
-{
-    double total = 0.0;
-    double amplitude = 1.0;
-    double freq = 1.0;
-    double maxVal = 0.0;
-
-    for (int i = 0; i < octaves; ++i) {
-        total += simplexNoise(x * freq, y * freq) * amplitude;
-        maxVal += amplitude;
-
-        amplitude *= persistence;
-        freq *= 2.0;
-    }
-
-    return total / maxVal;
-}
-
-// =================================================================
-// === ADDITIONAL BRUSH MODES
-// =================================================================
-
-void MainWindow::applySmoothBrush(int mapX, int mapY)
-{
-    if (!ui->sliderBrushSize) return;
-
-    int brushRadius = ui->sliderBrushSize->value();
-    if (brushRadius < 1) brushRadius = 1;
-    double brushRadiusSq = static_cast<double>(brushRadius) * brushRadius;
-
-    if (mapX < 0 || mapX >= mapWidth || mapY < 0 || mapY >= mapHeight) return;
-
-    int minX = std::max(0, mapX - brushRadius);
-    int maxX = std::min(mapWidth - 1, mapX + brushRadius);
-    int minY = std::max(0, mapY - brushRadius);
-    int maxY = std::min(mapHeight - 1, mapY + brushRadius);
-
-    // Crear copia temporal para evitar modificar mientras calculamos promedios
-    std::vector<std::vector<unsigned char>> tempData = heightMapData;
-
-    for (int y = minY; y <= maxY; ++y) {
-        for (int x = minX; x <= maxX; ++x) {
-            double distSq = std::pow(static_cast<double>(x - mapX), 2) +
-                            std::pow(static_cast<double>(y - mapY), 2);
-
-            if (distSq <= brushRadiusSq) {
-                int sum = 0;
-                int count = 0;
-                for (int dy = -1; dy <= 1; ++dy) {
-                    for (int dx = -1; dx <= 1; ++dx) {
-                        int nx = x + dx;
-                        int ny = y + dy;
-                        if (nx >= 0 && nx < mapWidth && ny >= 0 && ny < mapHeight) {
-                            sum += tempData[ny][nx];
-                            count++;
-                        }
-                    }
-                }
-                int average = sum / count;
-
-                double intensity = 1.0 - (distSq / brushRadiusSq);
-                int currentValue = tempData[y][x];
-                int newValue = static_cast<int>(currentValue + (average - currentValue) * intensity * 0.3);
-
-                heightMapData[y][x] = static_cast<unsigned char>(std::min(std::max(newValue, 0), 255));
-            }
-        }
-    }
-
-    updateHeightmapDisplay();
-}
-
-void MainWindow::applyFlattenBrush(int mapX, int mapY)
+QRect MainWindow::applyDab(int mapX, int mapY)
 {
-    if (!ui->sliderBrushSize) return;
-
-    int brushRadius = ui->sliderBrushSize->value();
-    if (brushRadius < 1) brushRadius = 1;
-    double brushRadiusSq = static_cast<double>(brushRadius) * brushRadius;
-
-    if (mapX < 0 || mapX >= mapWidth || mapY < 0 || mapY >= mapHeight) return;
-
-    int minX = std::max(0, mapX - brushRadius);
-    int maxX = std::min(mapWidth - 1, mapX + brushRadius);
-    int minY = std::max(0, mapY - brushRadius);
-    int maxY = std::min(mapHeight - 1, mapY + brushRadius);
-
-    for (int y = minY; y <= maxY; ++y) {
-        for (int x = minX; x <= maxX; ++x) {
-            double distSq = std::pow(static_cast<double>(x - mapX), 2) +
-                            std::pow(static_cast<double>(y - mapY), 2);
-
-            if (distSq <= brushRadiusSq) {
-                double intensity = 1.0 - (distSq / brushRadiusSq);
-                int currentValue = heightMapData[y][x];
-
-                int targetValue = static_cast<int>(currentValue + (flattenHeight - currentValue) * intensity * 0.1);
-                heightMapData[y][x] = static_cast<unsigned char>(std::min(std::max(targetValue, 0), 255));
-            }
-        }
+    switch (currentBrushMode) {
+    case RAISE_LOWER:
+        return applyBrush(mapX, mapY);
+    case SMOOTH:
+        return applySmoothBrush(mapX, mapY);
+    case FLATTEN:
+        return applyFlattenBrush(mapX, mapY);
+    case NOISE:
+        return applyNoiseBrush(mapX, mapY);
+    default:
+        // El relleno y las formas no se aplican por pinceladas
+        return QRect();
     }
-
-    updateHeightmapDisplay();
 }
 
-void MainWindow::applyNoiseBrush(int mapX, int mapY)
+// Separación entre pinceladas del trazo, proporcional al radio
+double MainWindow::strokeSpacingPixels() const
 {
-    if (!ui->sliderBrushSize) return;
+    const int radius = ui->sliderBrushSize ? ui->sliderBrushSize->value() : 1;
+    return std::max(1.0, strokeSpacing * radius);
+}
 
-    int brushRadius = ui->sliderBrushSize->value();
-    if (brushRadius < 1) brushRadius = 1;
-    double brushRadiusSq = static_cast<double>(brushRadius) * brushRadius;
+// =================================================================
+// === PERLIN NOISE FUNCTIONS
+// =================================================================
 
-    if (mapX < 0 || mapX >= mapWidth || mapY < 0 || mapY >= mapHeight) return;
+void MainWindow::initializePerlin()
+{
+    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+    noiseContext.reseed(seed);
+}
 
-    int minX = std::max(0, mapX - brushRadius);
-    int maxX = std::min(mapWidth - 1, mapX + brushRadius);
-    int minY = std::max(0, mapY - brushRadius);
-    int maxY = std::min(mapHeight - 1, mapY + brushRadius);
+// =================================================================
+// === ADDITIONAL BRUSH MODES
+// =================================================================
 
-    if (p.empty()) initializePerlin();
+QRect MainWindow::applySmoothBrush(int mapX, int mapY)
+{
+    if (!ui->sliderBrushSize) return QRect();
 
-    for (int y = minY; y <= maxY; ++y) {
-        for (int x = minX; x <= maxX; ++x) {
-            double distSq = std::pow(static_cast<double>(x - mapX), 2) +
-                            std::pow(static_cast<double>(y - mapY), 2);
+    return Brushes::smooth(heightMapData, mapX, mapY, ui->sliderBrushSize->value(), 0.3,
+                           smoothKernel, smoothKernelRadius, brushHardness);
+}
 
-            if (distSq <= brushRadiusSq) {
-                double intensity = 1.0 - (distSq / brushRadiusSq);
+QRect MainWindow::applyFlattenBrush(int mapX, int mapY)
+{
+    if (!ui->sliderBrushSize) return QRect();
 
-                // Generar ruido en esta posición
-                double noiseValue = perlin(x * 0.1, y * 0.1);
-                int noiseHeight = static_cast<int>((noiseValue + 1.0) * 127.5);
+    return Brushes::flatten(heightMapData, mapX, mapY, ui->sliderBrushSize->value(), flattenHeight, 0.1,
+                            brushHardness);
+}
 
-                int currentValue = heightMapData[y][x];
-                int targetValue = static_cast<int>(currentValue + (noiseHeight - currentValue) * intensity * 0.15);
+QRect MainWindow::applyNoiseBrush(int mapX, int mapY)
+{
+    if (!ui->sliderBrushSize) return QRect();
 
-                heightMapData[y][x] = static_cast<unsigned char>(std::min(std::max(targetValue, 0), 255));
-            }
-        }
-    }
+    if (!noiseContext.isSeeded()) initializePerlin();
 
-    updateHeightmapDisplay();
+    return Brushes::noise(heightMapData, noiseContext, mapX, mapY, ui->sliderBrushSize->value(), 0.15,
+                          brushHardness);
 }
 
 // =================================================================
@@ -1317,52 +859,51 @@ void MainWindow::applyNoiseBrush(int mapX, int mapY)
 
 void MainWindow::saveStateToUndo()
 {
-    undoStack.push_back(heightMapData);
-
-    if (undoStack.size() > maxUndoSteps) {
-        undoStack.erase(undoStack.begin());
+    try {
+        undoHistory.save(heightMapData);
+    } catch (const std::exception &e) {
+        statusBar()->showMessage(QString("No se pudo guardar el paso de deshacer: %1").arg(e.what()), 5000);
     }
-
-    clearRedoStack();
 }
 
 void MainWindow::undo()
 {
-    if (undoStack.empty()) {
+    QRect dirty;
+    if (!undoHistory.undo(heightMapData, &dirty)) {
         QMessageBox::information(this, "Deshacer", "No hay acciones para deshacer.");
         return;
     }
 
-    redoStack.push_back(heightMapData);
-    heightMapData = undoStack.back();
-    undoStack.pop_back();
-
-    updateHeightmapDisplay();
+    updateHeightmapDisplay(dirty);
 }
 
 void MainWindow::redo()
 {
-    if (redoStack.empty()) {
+    QRect dirty;
+    if (!undoHistory.redo(heightMapData, &dirty)) {
         QMessageBox::information(this, "Rehacer", "No hay acciones para rehacer.");
         return;
     }
 
-    undoStack.push_back(heightMapData);
-    heightMapData = redoStack.back();
-    redoStack.pop_back();
-
-    updateHeightmapDisplay();
-}
-
-void MainWindow::clearRedoStack()
-{
-    redoStack.clear();
+    updateHeightmapDisplay(dirty);
 }
 
 // =================================================================
 // === TERRAIN GENERATION
 // =================================================================
 
+NoiseType MainWindow::noiseTypeFromName(const QString &name)
+{
+    if (name == "Simplex Noise") return NoiseType::Simplex;
+    if (name == "Voronoi Noise") return NoiseType::Voronoi;
+    if (name == "Ridged Multifractal") return NoiseType::RidgedMultifractal;
+    if (name == "Billowy Noise") return NoiseType::Billowy;
+    if (name == "Domain Warping") return NoiseType::DomainWarp;
+
+    // Por defecto: Perlin Noise
+    return NoiseType::Perlin;
+}
+
 void MainWindow::on_pushButtonGenerate_clicked()
 {
     if (mapWidth == 0 || mapHeight == 0) {
@@ -1371,8 +912,8 @@ void MainWindow::on_pushButtonGenerate_clicked()
     }
 
     // 1. OBTENER PARÁMETROS DE LA GUI
-    octaves = ui->spinBoxOctaves->value();
-    persistence = ui->doubleSpinBoxPersistence->value();
+    noiseContext.octaves = ui->spinBoxOctaves->value();
+    noiseContext.persistence = ui->doubleSpinBoxPersistence->value();
     frequencyScale = ui->doubleSpinBoxFrequencyScale->value();
 
     QString offsetText = ui->lineEditOffset->text();
@@ -1382,69 +923,228 @@ void MainWindow::on_pushButtonGenerate_clicked()
         bool ok;
         double customOffset = offsetText.toDouble(&ok);
         if (ok) {
-            frequencyOffset = customOffset;
+            noiseContext.frequencyOffset = customOffset;
         } else {
             initializePerlin();
             QMessageBox::warning(this, "Advertencia", "Desplazamiento no válido. Usando valor aleatorio.");
-            ui->lineEditOffset->setText(QString::number(frequencyOffset));
+            ui->lineEditOffset->setText(QString::number(noiseContext.frequencyOffset));
         }
-        if (p.empty()) initializePerlin();
+        if (!noiseContext.isSeeded()) initializePerlin();
     }
 
-    double scale = std::min(mapWidth, mapHeight);
-    const double baseFrequency = 1.0 / (scale * frequencyScale);
+    const double baseFrequency = Noise::terrainBaseFrequency(mapWidth, mapHeight, frequencyScale);
 
     // NUEVO: Determinar qué algoritmo usar
-    QString noiseType = ui->comboBoxNoiseType->currentText();
+    QString noiseName = ui->comboBoxNoiseType->currentText();
+
+    // 2. GENERAR EN SEGUNDO PLANO (el contexto se copia para el hilo)
+    generationParams.ctx = noiseContext;
+    generationParams.type = noiseTypeFromName(noiseName);
+    generationParams.noiseName = noiseName;
+    generationParams.baseFrequency = baseFrequency;
+    generationParams.width = mapWidth;
+    generationParams.height = mapHeight;
+    generationParams.format = heightFormat;
+    startGeneration();
+}
 
-    for (int y = 0; y < mapHeight; ++y) {
-        for (int x = 0; x < mapWidth; ++x) {
-            double sampleX = (double)x * baseFrequency + frequencyOffset;
-            double sampleY = (double)y * baseFrequency + frequencyOffset;
-
-            double noiseValue;
-
-            if (noiseType == "Simplex Noise") {
-                noiseValue = simplexFbm(sampleX, sampleY);
-            } else if (noiseType == "Voronoi Noise") {
-                noiseValue = voronoiFbm(sampleX, sampleY);
-            } else if (noiseType == "Ridged Multifractal") {
-                noiseValue = ridgedMultifractal(sampleX, sampleY);
-            } else if (noiseType == "Billowy Noise") {
-                noiseValue = billowyFbm(sampleX, sampleY);
-            } else if (noiseType == "Domain Warping") {
-                noiseValue = domainWarp(sampleX, sampleY, 50.0);
-            } else {
-                // Por defecto: Perlin Noise
-                noiseValue = fbm(sampleX, sampleY);
+void MainWindow::startGeneration()
+{
+    cancelGeneration();
+
+    const int id = generationId;
+    const GenerationParams params = generationParams;
+    const int previewMinStep = overviewScale;
+    generationRunning = true;
+    actionCancelGeneration->setEnabled(true);
+    statusBar()->showMessage(QString("Generando %1...").arg(params.noiseName));
+
+    // Pasadas de grueso a fino: cada una llega a la GUI como evento
+    generationThread = std::thread([this, id, params, previewMinStep]() {
+        // Vistas previas más finas que la vista 2D no aportan nada
+        for (int step : {8, 4, 2}) {
+            if (step < previewMinStep) break;
+
+            HeightField pass((params.width + step - 1) / step, (params.height + step - 1) / step, params.format);
+            if (!Noise::generate(pass, params.ctx, params.type, params.baseFrequency, step, &generationCancelled)) {
+                return;
             }
 
-            unsigned char height = (unsigned char)((noiseValue + 1.0) * 127.5);
-            heightMapData[y][x] = height;
+            QMetaObject::invokeMethod(this, [this, id, step, pass = std::move(pass)]() mutable {
+                onGenerationPreview(id, step, std::move(pass));
+            }, Qt::QueuedConnection);
+        }
+
+        // Pasada final directamente sobre el mapa por tiles
+        TiledHeightField result;
+        try {
+            result.assign(params.width, params.height, params.format, 0.0f);
+        } catch (const std::exception &) {
+            // La GUI se entera por un resultado vacío
+        }
+        if (!result.empty()
+            && !Noise::generate(result, params.ctx, params.type, params.baseFrequency, &generationCancelled)) {
+            return;
         }
+
+        QMetaObject::invokeMethod(this, [this, id, result = std::move(result)]() mutable {
+            onGenerationFinished(id, std::move(result));
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::cancelGeneration()
+{
+    if (generationThread.joinable()) {
+        generationCancelled = true;
+        generationThread.join();
+        generationCancelled = false;
+    }
+
+    // Las pasadas ya encoladas del trabajo anterior se ignoran
+    ++generationId;
+    generationRunning = false;
+    if (actionCancelGeneration) actionCancelGeneration->setEnabled(false);
+}
+
+void MainWindow::onGenerationPreview(int id, int step, HeightField pass)
+{
+    if (id != generationId) return;
+
+    // El mapa cambió de tamaño mientras tanto
+    if (generationParams.width != mapWidth || generationParams.height != mapHeight) {
+        cancelGeneration();
+        return;
+    }
+
+    showGenerationPreview(pass, step);
+    statusBar()->showMessage(QString("Generando %1... (vista previa 1/%2)")
+                                 .arg(generationParams.noiseName).arg(step));
+}
+
+void MainWindow::onGenerationFinished(int id, TiledHeightField result)
+{
+    if (id != generationId) return;
+
+    if (generationParams.width != mapWidth || generationParams.height != mapHeight) {
+        cancelGeneration();
+        return;
     }
 
+    // Pasada final: el hilo ya terminó su trabajo
+    generationThread.join();
+    generationRunning = false;
+    actionCancelGeneration->setEnabled(false);
+
+    if (result.empty()) {
+        statusBar()->showMessage("No se pudo reservar el mapa generado.", 5000);
+        updateHeightmapDisplay();
+        return;
+    }
+
+    // Se puede deshacer como cualquier otro cambio del mapa entero
+    saveStateToUndo();
+    heightMapData = std::move(result);
     updateHeightmapDisplay();
-    QMessageBox::information(this, "Éxito",
-                             QString("Terreno generado con %1.\nOctavas: %2, Persistencia: %3, Escala: %4")
-                                 .arg(noiseType)
-                                 .arg(octaves)
-                                 .arg(persistence)
-                                 .arg(frequencyScale));
+    statusBar()->showMessage(QString("Terreno generado con %1. Octavas: %2, Persistencia: %3, Escala: %4")
+                                 .arg(generationParams.noiseName)
+                                 .arg(generationParams.ctx.octaves)
+                                 .arg(generationParams.ctx.persistence)
+                                 .arg(frequencyScale), 5000);
+}
+
+void MainWindow::showGenerationPreview(const HeightField &pass, int step)
+{
+    if (!mapCanvas) return;
+
+    QImage preview(pass.width(), pass.height(), QImage::Format_Grayscale8);
+    for (int y = 0; y < pass.height(); ++y) {
+        pass.rowToU8(y, preview.scanLine(y));
+    }
+
+    // Cada muestra cubre un bloque de step x step muestras del mapa
+    mapCanvas->setPreview(preview, step);
+}
+// =================================================================
+// === HEIGHT PRECISION
+// =================================================================
+// heightFormat decide el formato de los mapas nuevos, generados y
+// cargados; el mapa actual se convierte (con deshacer) al cambiarlo.
+// El resto del código trabaja con heightMapData.format(), que tras un
+// deshacer puede ser otro.
+
+void MainWindow::setHeightFormat(HeightFormat format)
+{
+    heightFormat = format;
+
+    if (precisionActions) {
+        for (QAction *action : precisionActions->actions()) {
+            if (action->data().toInt() == static_cast<int>(format)) {
+                action->setChecked(true);
+            }
+        }
+    }
+
+    // Una generación en curso se reinicia con la nueva precisión
+    const bool restartGeneration = generationRunning;
+    cancelGeneration();
+
+    if (!heightMapData.empty() && heightMapData.format() != format) {
+        saveStateToUndo();
+        try {
+            heightMapData.convertTo(format);
+        } catch (const std::exception &e) {
+            // El mapa sigue en su formato; el resto del código lo admite
+            statusBar()->showMessage(QString("No se pudo convertir el mapa: %1").arg(e.what()), 5000);
+        }
+        updateHeightmapDisplay();
+    }
+
+    if (restartGeneration) {
+        generationParams.format = format;
+        startGeneration();
+    }
+}
+
+// Tras cargar un archivo: si trae más precisión que la seleccionada, la
+// selección sube a la del archivo; si trae menos, el mapa se amplía
+void MainWindow::adoptLoadedPrecision()
+{
+    if (bytesPerSample(heightMapData.format()) > bytesPerSample(heightFormat)) {
+        setHeightFormat(heightMapData.format());
+    } else {
+        try {
+            heightMapData.convertTo(heightFormat);
+        } catch (const std::exception &e) {
+            statusBar()->showMessage(QString("No se pudo convertir el mapa: %1").arg(e.what()), 5000);
+        }
+    }
 }
+
 // =================================================================
 // === MOUSE EVENTS
 // =================================================================
 void MainWindow::mousePressEvent(QMouseEvent *event)
 {
-    if (mapWidth == 0 || mapHeight == 0 || !dynamicImageLabel) return;
+    if (mapWidth == 0 || mapHeight == 0 || !mapCanvas) return;
 
     QPoint globalPos = event->globalPosition().toPoint();
-    QPoint localPos = dynamicImageLabel->mapFromGlobal(globalPos);
+    QPoint localPos = mapCanvas->mapFromGlobal(globalPos);
 
-    if (!dynamicImageLabel->rect().contains(localPos)) return;
+    if (!mapCanvas->rect().contains(localPos)) return;
+    // Fuera del mapa (el lienzo puede mostrar el fondo alrededor)
+    const QPointF mapPos = mapCanvas->widgetToMap(localPos);
+    if (mapPos.x() < 0 || mapPos.y() < 0 || mapPos.x() >= mapWidth || mapPos.y() >= mapHeight) return;
 
-    saveStateToUndo();
+    // Pintar sobre una vista previa a medias no tiene sentido: se
+    // descarta la generación y se vuelve a mostrar el mapa actual
+    if (generationRunning) {
+        cancelGeneration();
+        updateHeightmapDisplay();
+    }
+
+    // Paso de deshacer por tiles: se guardan sólo los que toque el trazo
+    undoHistory.begin(heightMapData);
     isPainting = true;
 
     QString brushModeText = ui->comboBoxBrushMode->currentText();
@@ -1455,28 +1155,25 @@ void MainWindow::mousePressEvent(QMouseEvent *event)
         QPoint dataPos = mapToDataCoordinates(localPos.x(), localPos.y());
         shapeStartPoint = dataPos;
         isDrawingShape = true;
-        previewImage = currentImage.copy();
         return;  // CRÍTICO: salir aquí
     } else if (brushModeText == "Rectángulo") {
         currentBrushMode = RECTANGLE;
         QPoint dataPos = mapToDataCoordinates(localPos.x(), localPos.y());
         shapeStartPoint = dataPos;
         isDrawingShape = true;
-        previewImage = currentImage.copy();
         return;  // CRÍTICO: salir aquí
     } else if (brushModeText == "Círculo") {
         currentBrushMode = CIRCLE;
         QPoint dataPos = mapToDataCoordinates(localPos.x(), localPos.y());
         shapeStartPoint = dataPos;
         isDrawingShape = true;
-        previewImage = currentImage.copy();
         return;  // CRÍTICO: salir aquí
     } else if (brushModeText == "Suavizar") {
         currentBrushMode = SMOOTH;
     } else if (brushModeText == "Aplanar") {
         currentBrushMode = FLATTEN;
         QPoint dataPos = mapToDataCoordinates(localPos.x(), localPos.y());
-        flattenHeight = heightMapData[dataPos.y()][dataPos.x()];
+        flattenHeight = heightMapData.level(dataPos.x(), dataPos.y());
     } else if (brushModeText == "Ruido") {
         currentBrushMode = NOISE;
     } else if (brushModeText == "Rellenar") {
@@ -1488,101 +1185,67 @@ void MainWindow::mousePressEvent(QMouseEvent *event)
 
     QPoint dataPos = mapToDataCoordinates(localPos.x(), localPos.y());
 
-    switch (currentBrushMode) {
-    case RAISE_LOWER:
-        applyBrush(dataPos.x(), dataPos.y());
-        break;
-    case SMOOTH:
-        applySmoothBrush(dataPos.x(), dataPos.y());
-        break;
-    case FLATTEN:
-        applyFlattenBrush(dataPos.x(), dataPos.y());
-        break;
-    case NOISE:
-        applyNoiseBrush(dataPos.x(), dataPos.y());
-        break;
-    case FILL:
+    if (currentBrushMode == FILL) {
         applyFillBrush(dataPos.x(), dataPos.y());
-        break;
-    default:
-        break;
+        return;
     }
+
+    // Primera pincelada del trazo; las siguientes las reparte mouseMoveEvent
+    QRect dirty;
+    stroke.begin(dataPos.x(), dataPos.y(), strokeSpacingPixels(), [&](int x, int y) {
+        dirty |= applyDab(x, y);
+    });
+    updateHeightmapDisplay(dirty);
 }
 
 void MainWindow::mouseMoveEvent(QMouseEvent *event)
 {
-    if (!dynamicImageLabel) return;
+    if (!mapCanvas) return;
 
     QPoint globalPos = event->globalPosition().toPoint();
-    QPoint localPos = dynamicImageLabel->mapFromGlobal(globalPos);
+    QPoint localPos = mapCanvas->mapFromGlobal(globalPos);
 
-    if (!dynamicImageLabel->rect().contains(localPos)) return;
+    if (!mapCanvas->rect().contains(localPos)) return;
 
     // Manejo especial para formas con preview
     if (isDrawingShape && (currentBrushMode == LINE || currentBrushMode == RECTANGLE || currentBrushMode == CIRCLE)) {
         QPoint dataPos = mapToDataCoordinates(localPos.x(), localPos.y());
 
-        // Restaurar imagen original
-        currentImage = previewImage.copy();
-
-        // Dibujar preview de la forma
-        QPainter painter(&currentImage);
-        QPen pen(QColor(brushColor, brushColor, brushColor));
-        pen.setWidth(2);
-        painter.setPen(pen);
+        // Vista previa de la forma como capa sobre el lienzo: la imagen
+        // del mapa no se toca y sólo se repinta la zona del contorno.
+        // El contorno va en coordenadas del mapa (centro de cada muestra)
+        const QPointF start = QPointF(shapeStartPoint) + QPointF(0.5, 0.5);
+        const QPointF end = QPointF(dataPos) + QPointF(0.5, 0.5);
+        QPainterPath path;
 
         if (currentBrushMode == LINE) {
-            painter.drawLine(shapeStartPoint.x(), shapeStartPoint.y(),
-                             dataPos.x(), dataPos.y());
+            path.moveTo(start);
+            path.lineTo(end);
         } else if (currentBrushMode == RECTANGLE) {
-            int x = std::min(shapeStartPoint.x(), dataPos.x());
-            int y = std::min(shapeStartPoint.y(), dataPos.y());
-            int w = std::abs(dataPos.x() - shapeStartPoint.x());
-            int h = std::abs(dataPos.y() - shapeStartPoint.y());
-            painter.drawRect(x, y, w, h);
+            path.addRect(QRectF(start, end).normalized());
         } else if (currentBrushMode == CIRCLE) {
             int dx = dataPos.x() - shapeStartPoint.x();
             int dy = dataPos.y() - shapeStartPoint.y();
             int radius = static_cast<int>(std::sqrt(dx * dx + dy * dy));
-            painter.drawEllipse(shapeStartPoint, radius, radius);
+            path.addEllipse(start, radius, radius);
         }
 
-        // Actualizar display
-        if (dynamicImageLabel) {
-            dynamicImageLabel->setPixmap(QPixmap::fromImage(currentImage));
-        }
+        QPen pen(QColor(brushColor, brushColor, brushColor));
+        pen.setWidth(2);
+        mapCanvas->setOverlay(path, pen);
         return;
     }
 
-    // Comportamiento normal para otros pinceles
-    if (isPainting) {
+    // Comportamiento normal para otros pinceles: pinceladas espaciadas a
+    // lo largo del tramo desde el evento anterior, y un solo refresco
+    if (isPainting && currentBrushMode != FILL) {
         QPoint dataPos = mapToDataCoordinates(localPos.x(), localPos.y());
 
-        switch (currentBrushMode) {
-        case RAISE_LOWER:
-            applyBrush(dataPos.x(), dataPos.y());
-            break;
-        case SMOOTH:
-            applySmoothBrush(dataPos.x(), dataPos.y());
-            break;
-        case FLATTEN:
-            applyFlattenBrush(dataPos.x(), dataPos.y());
-            break;
-        case NOISE:
-            applyNoiseBrush(dataPos.x(), dataPos.y());
-            break;
-        case FILL:
-            // No hacer nada - el relleno solo se ejecuta en mousePressEvent
-            break;
-        case LINE:
-            break;
-        case RECTANGLE:
-            break;
-        case CIRCLE:
-            break;
-        default:
-            break;
-        }
+        QRect dirty;
+        stroke.moveTo(dataPos.x(), dataPos.y(), [&](int x, int y) {
+            dirty |= applyDab(x, y);
+        });
+        if (!dirty.isEmpty()) updateHeightmapDisplay(dirty);
     }
 }
 
@@ -1590,26 +1253,35 @@ void MainWindow::mouseReleaseEvent(QMouseEvent *event)
 {
     if (isDrawingShape && (currentBrushMode == LINE || currentBrushMode == RECTANGLE || currentBrushMode == CIRCLE)) {
         QPoint globalPos = event->globalPosition().toPoint();
-        QPoint localPos = dynamicImageLabel->mapFromGlobal(globalPos);
+        QPoint localPos = mapCanvas->mapFromGlobal(globalPos);
         QPoint dataPos = mapToDataCoordinates(localPos.x(), localPos.y());
 
         // Aplicar la forma final al heightMapData
+        QRect dirty;
         if (currentBrushMode == LINE) {
-            drawLine(shapeStartPoint.x(), shapeStartPoint.y(), dataPos.x(), dataPos.y());
+            dirty = drawLine(shapeStartPoint.x(), shapeStartPoint.y(), dataPos.x(), dataPos.y());
         } else if (currentBrushMode == RECTANGLE) {
-            drawRectangle(shapeStartPoint.x(), shapeStartPoint.y(), dataPos.x(), dataPos.y());
+            dirty = drawRectangle(shapeStartPoint.x(), shapeStartPoint.y(), dataPos.x(), dataPos.y());
         } else if (currentBrushMode == CIRCLE) {
             int dx = dataPos.x() - shapeStartPoint.x();
             int dy = dataPos.y() - shapeStartPoint.y();
             int radius = static_cast<int>(std::sqrt(dx * dx + dy * dy));
-            drawCircle(shapeStartPoint.x(), shapeStartPoint.y(), radius);
+            dirty = drawCircle(shapeStartPoint.x(), shapeStartPoint.y(), radius);
         }
 
+        // Se quita la vista previa y sólo se reconvierte la zona de la forma
         isDrawingShape = false;
-        updateHeightmapDisplay();
+        mapCanvas->clearOverlay();
+        updateHeightmapDisplay(dirty);
     }
 
     isPainting = false;
+    undoHistory.commit();
+
+    // El agua depende del terreno: se rehace una vez al soltar
+    if (glWidget3D) {
+        glWidget3D->updateWater();
+    }
 }
 
 // =================================================================
@@ -1623,6 +1295,7 @@ void MainWindow::on_pushButtonView3D_clicked()
     }
 
     QDialog *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
     dialog->setWindowTitle("Vista 3D - HeightMap");
     dialog->resize(800, 600);
 
@@ -1643,6 +1316,11 @@ void MainWindow::on_pushButtonView3D_clicked()
     waterControls->addWidget(sliderWaterLevel);
     waterControls->addStretch();
 
+    // Relieve desde una textura de alturas; sin marcar, malla horneada
+    QCheckBox *checkDisplacement = new QCheckBox("Relieve en GPU", dialog);
+    checkDisplacement->setChecked(true);
+    waterControls->addWidget(checkDisplacement);
+
     QPushButton *btnTexture = new QPushButton("Cargar Textura Terreno", dialog);
     waterControls->addWidget(btnTexture);
 
@@ -1651,9 +1329,28 @@ void MainWindow::on_pushButtonView3D_clicked()
 
     mainLayout->addLayout(waterControls);
 
+    // Detalle del relieve en GPU: error en pantalla admitido
+    QHBoxLayout *lodControls = new QHBoxLayout();
+    QLabel *labelLodError = new QLabel("Error de detalle (px):", dialog);
+    QSlider *sliderLodError = new QSlider(Qt::Horizontal, dialog);
+    sliderLodError->setRange(1, 16);
+    sliderLodError->setValue(2);
+    sliderLodError->setMinimumWidth(150);
+    QLabel *labelChunks = new QLabel(dialog);
+    QLabel *labelTriangles = new QLabel(dialog);
+    lodControls->addWidget(labelLodError);
+    lodControls->addWidget(sliderLodError);
+    lodControls->addWidget(labelChunks);
+    lodControls->addWidget(labelTriangles);
+    lodControls->addStretch();
+    mainLayout->addLayout(lodControls);
+
     // CAMBIAR AQUÍ: Usar un nombre de variable local diferente
     OpenGLWidget *glWidget = new OpenGLWidget(dialog);
-    glWidget->setHeightMapData(heightMapData);
+    glWidget->setHeightDisplacement(true);
+    glWidget->setLodPixelError(sliderLodError->value());
+    // Misma resolución que la vista 2D: los mapas grandes van reducidos
+    glWidget->setHeightMapData(heightMapData.downsampled(overviewScale));
     mainLayout->addWidget(glWidget);
 
     // Ahora las lambdas funcionarán correctamente
@@ -1692,6 +1389,27 @@ void MainWindow::on_pushButtonView3D_clicked()
         glWidget->update();
     });
 
+    connect(checkDisplacement, &QCheckBox::toggled, [glWidget, sliderLodError](bool checked) {
+        glWidget->setHeightDisplacement(checked);
+        // La malla se dibuja siempre con todo el detalle
+        sliderLodError->setEnabled(checked);
+    });
+
+    connect(glWidget, &OpenGLWidget::chunkVisibilityChanged, labelChunks, [labelChunks](int visible, int culled) {
+        labelChunks->setText(QString("Trozos: %1 visibles, %2 descartados").arg(visible).arg(culled));
+    });
+
+    connect(glWidget, &OpenGLWidget::triangleCountChanged, labelTriangles, [labelTriangles](int triangles) {
+        labelTriangles->setText(QString("Triángulos: %1").arg(triangles));
+    });
+
+    connect(sliderLodError, &QSlider::valueChanged, [glWidget](int value) {
+        glWidget->setLodPixelError(static_cast<float>(value));
+    });
+
+    // Las ediciones del 2D se reflejan en esta vista mientras esté abierta
+    glWidget3D = glWidget;
+
     dialog->setLayout(mainLayout);
     dialog->show();
 }
@@ -1700,187 +1418,33 @@ void MainWindow::on_pushButtonView3D_clicked()
 // === SHAPE DRAWING FUNCTIONS
 // =================================================================
 
-void MainWindow::drawLine(int x1, int y1, int x2, int y2)
+QRect MainWindow::drawLine(int x1, int y1, int x2, int y2)
 {
-    if (!ui->sliderBrushSize || !ui->sliderBrushIntensity) return;
-
-    int brushRadius = ui->sliderBrushSize->value();
-    if (brushRadius < 1) brushRadius = 1;
-
-    double intensityFactor = ui->sliderBrushIntensity->value() / 100.0;
-
-    // Algoritmo de Bresenham para la línea central
-    int dx = std::abs(x2 - x1);
-    int dy = std::abs(y2 - y1);
-    int sx = (x1 < x2) ? 1 : -1;
-    int sy = (y1 < y2) ? 1 : -1;
-    int err = dx - dy;
-
-    int lineX = x1;
-    int lineY = y1;
-
-    while (true) {
-        // Para cada punto de la línea, dibujar un círculo con el radio del pincel
-        for (int dy = -brushRadius; dy <= brushRadius; ++dy) {
-            for (int dx = -brushRadius; dx <= brushRadius; ++dx) {
-                int px = lineX + dx;
-                int py = lineY + dy;
-
-                // Verificar que está dentro del radio circular
-                double distSq = dx * dx + dy * dy;
-                double brushRadiusSq = brushRadius * brushRadius;
-
-                if (distSq <= brushRadiusSq && px >= 0 && px < mapWidth && py >= 0 && py < mapHeight) {
-                    // Calcular intensidad con falloff radial
-                    double intensity = 1.0 - (distSq / brushRadiusSq);
-                    intensity *= intensityFactor;
-
-                    // Mezclar con el valor existente
-                    int currentValue = heightMapData[py][px];
-                    int targetValue = static_cast<int>(currentValue + (brushColor - currentValue) * intensity);
-                    heightMapData[py][px] = static_cast<unsigned char>(std::min(std::max(targetValue, 0), 255));
-                }
-            }
-        }
+    if (!ui->sliderBrushSize || !ui->sliderBrushIntensity) return QRect();
 
-        if (lineX == x2 && lineY == y2) break;
-
-        int e2 = 2 * err;
-        if (e2 > -dy) {
-            err -= dy;
-            lineX += sx;
-        }
-        if (e2 < dx) {
-            err += dx;
-            lineY += sy;
-        }
-    }
+    return Brushes::line(heightMapData, x1, y1, x2, y2, ui->sliderBrushSize->value(), brushColor,
+                         ui->sliderBrushIntensity->value() / 100.0);
 }
 
-void MainWindow::drawRectangle(int x1, int y1, int x2, int y2)
+QRect MainWindow::drawRectangle(int x1, int y1, int x2, int y2)
 {
-    // Asegurar que x1,y1 sea la esquina superior izquierda
-    int minX = std::min(x1, x2);
-    int maxX = std::max(x1, x2);
-    int minY = std::min(y1, y2);
-    int maxY = std::max(y1, y2);
-
-    // Dibujar los cuatro lados del rectángulo
-    drawLine(minX, minY, maxX, minY);  // Lado superior
-    drawLine(maxX, minY, maxX, maxY);  // Lado derecho
-    drawLine(maxX, maxY, minX, maxY);  // Lado inferior
-    drawLine(minX, maxY, minX, minY);  // Lado izquierdo
+    if (!ui->sliderBrushSize || !ui->sliderBrushIntensity) return QRect();
+
+    return Brushes::rectangle(heightMapData, x1, y1, x2, y2, ui->sliderBrushSize->value(), brushColor,
+                              ui->sliderBrushIntensity->value() / 100.0);
 }
 
-void MainWindow::drawCircle(int centerX, int centerY, int radius)
+QRect MainWindow::drawCircle(int centerX, int centerY, int radius)
 {
-    if (!ui->sliderBrushSize || !ui->sliderBrushIntensity) return;
-
-    int brushRadius = ui->sliderBrushSize->value();
-    if (brushRadius < 1) brushRadius = 1;
+    if (!ui->sliderBrushSize || !ui->sliderBrushIntensity) return QRect();
 
-    double intensityFactor = ui->sliderBrushIntensity->value() / 100.0;
-
-    // Algoritmo del punto medio para el círculo
-    int x = 0;
-    int y = radius;
-    int d = 1 - radius;
-
-    auto drawCirclePointsWithBrush = [&](int cx, int cy, int x, int y) {
-        // Para cada punto del círculo, dibujar con el tamaño del pincel
-        auto drawPointWithBrush = [&](int px, int py) {
-            // Dibujar un círculo pequeño alrededor de este punto
-            for (int dy = -brushRadius; dy <= brushRadius; ++dy) {
-                for (int dx = -brushRadius; dx <= brushRadius; ++dx) {
-                    int finalX = px + dx;
-                    int finalY = py + dy;
-
-                    double distSq = dx * dx + dy * dy;
-                    double brushRadiusSq = brushRadius * brushRadius;
-
-                    if (distSq <= brushRadiusSq && finalX >= 0 && finalX < mapWidth && finalY >= 0 && finalY < mapHeight) {
-                        double intensity = 1.0 - (distSq / brushRadiusSq);
-                        intensity *= intensityFactor;
-
-                        int currentValue = heightMapData[finalY][finalX];
-                        int targetValue = static_cast<int>(currentValue + (brushColor - currentValue) * intensity);
-                        heightMapData[finalY][finalX] = static_cast<unsigned char>(std::min(std::max(targetValue, 0), 255));
-                    }
-                }
-            }
-        };
-
-        // Dibujar los 8 puntos simétricos
-        drawPointWithBrush(cx + x, cy + y);
-        drawPointWithBrush(cx - x, cy + y);
-        drawPointWithBrush(cx + x, cy - y);
-        drawPointWithBrush(cx - x, cy - y);
-        drawPointWithBrush(cx + y, cy + x);
-        drawPointWithBrush(cx - y, cy + x);
-        drawPointWithBrush(cx + y, cy - x);
-        drawPointWithBrush(cx - y, cy - x);
-    };
-
-    drawCirclePointsWithBrush(centerX, centerY, x, y);
-
-    while (x < y) {
-        if (d < 0) {
-            d += 2 * x + 3;
-        } else {
-            d += 2 * (x - y) + 5;
-            y--;
-        }
-        x++;
-        drawCirclePointsWithBrush(centerX, centerY, x, y);
-    }
+    return Brushes::circle(heightMapData, centerX, centerY, radius, ui->sliderBrushSize->value(), brushColor,
+                           ui->sliderBrushIntensity->value() / 100.0);
 }
 
 void MainWindow::applyFillBrush(int mapX, int mapY)
 {
-    if (mapX < 0 || mapX >= mapWidth || mapY < 0 || mapY >= mapHeight) return;
-
-    // Color original del píxel donde se hizo clic
-    unsigned char targetColor = heightMapData[mapY][mapX];
-
-    // Si el color de relleno es igual al color objetivo, no hacer nada
-    if (targetColor == brushColor) return;
-
-    // Usar una cola para flood fill iterativo (evita stack overflow)
-    std::queue<QPoint> queue;
-    queue.push(QPoint(mapX, mapY));
-
-    // Marcar píxeles visitados para evitar procesarlos múltiples veces
-    std::vector<std::vector<bool>> visited(mapHeight, std::vector<bool>(mapWidth, false));
-
-    while (!queue.empty()) {
-        QPoint current = queue.front();
-        queue.pop();
-
-        int x = current.x();
-        int y = current.y();
-
-        // Verificar límites
-        if (x < 0 || x >= mapWidth || y < 0 || y >= mapHeight) continue;
-
-        // Si ya visitamos este píxel, saltar
-        if (visited[y][x]) continue;
-
-        // Si el color no coincide con el color objetivo, saltar
-        if (heightMapData[y][x] != targetColor) continue;
-
-        // Marcar como visitado y rellenar
-        visited[y][x] = true;
-        heightMapData[y][x] = static_cast<unsigned char>(brushColor);
-
-        // Añadir píxeles vecinos a la cola (4-conectividad: arriba, abajo, izquierda, derecha)
-        queue.push(QPoint(x, y - 1)); // Arriba
-        queue.push(QPoint(x, y + 1)); // Abajo
-        queue.push(QPoint(x - 1, y)); // Izquierda
-        queue.push(QPoint(x + 1, y)); // Derecha
-    }
-
-    updateHeightmapDisplay();
-
+    updateHeightmapDisplay(Brushes::fill(heightMapData, mapX, mapY, brushColor, fillTolerance));
 }
 
 // ===========================================
@@ -1934,6 +1498,13 @@ void MainWindow::on_pushButtonTexturize_clicked()
         return;
     }
 
+    // El texturizado pinta sobre una imagen y una malla del mapa completo
+    if (overviewScale > 1) {
+        QMessageBox::warning(this, "Error",
+                             QString("El texturizado admite mapas de hasta %1x%1.").arg(MaxOverviewSize));
+        return;
+    }
+
     QDialog *dialog = new QDialog(this);
     dialog->setWindowTitle("Texturizar Mapa 3D");
     dialog->resize(1200, 800);
@@ -2047,10 +1618,12 @@ void MainWindow::on_pushButtonTexturize_clicked()
     QImage *paintImage = new QImage(mapWidth, mapHeight, QImage::Format_RGB32);
     paintImage->setColorSpace(QColorSpace::SRgb);
 
+    std::vector<unsigned char> src(mapWidth);
     for (int y = 0; y < mapHeight; ++y) {
+        QRgb *pixel = reinterpret_cast<QRgb*>(paintImage->scanLine(y));
+        heightMapData.rowToU8(y, src.data());
         for (int x = 0; x < mapWidth; ++x) {
-            unsigned char height = heightMapData[y][x];
-            paintImage->setPixel(x, y, qRgb(height, height, height));
+            pixel[x] = qRgb(src[x], src[x], src[x]);
         }
     }
     label2D->setPixmap(QPixmap::fromImage(*paintImage));
@@ -2060,7 +1633,7 @@ void MainWindow::on_pushButtonTexturize_clicked()
     rightPanel->addWidget(label3DTitle);
 
     OpenGLWidget *glWidget = new OpenGLWidget(dialog);
-    glWidget->setHeightMapData(heightMapData);
+    glWidget->setHeightMapData(heightMapData.region(0, 0, mapWidth, mapHeight));
     glWidget->setTexturePaintMode(true);
     glWidget->setMinimumSize(500, 400);
     rightPanel->addWidget(glWidget);
@@ -2146,16 +1719,20 @@ void MainWindow::on_pushButtonTexturize_clicked()
         objStream << "mtllib " << mtlFileName << "\n\n";
 
         const float HEIGHT_THRESHOLD = 1.0f;
-        std::vector<std::vector<int>> vertexIndexMap(mapHeight, std::vector<int>(mapWidth, -1));
+        std::vector<int> vertexIndexMap(static_cast<size_t>(mapWidth) * mapHeight, -1);
+        std::vector<float> levels(mapWidth);
         int vertexIndex = 1;
 
         // Escribir vértices
         for (int y = 0; y < mapHeight; ++y) {
+            heightMapData.rowToLevels(y, levels.data());
+            const float *src = levels.data();
+            int *indexRow = vertexIndexMap.data() + static_cast<size_t>(y) * mapWidth;
             for (int x = 0; x < mapWidth; ++x) {
-                if (heightMapData[y][x] > HEIGHT_THRESHOLD) {
-                    float height = heightMapData[y][x] / 255.0f * 100.0f;
+                if (src[x] > HEIGHT_THRESHOLD) {
+                    float height = src[x] / 255.0f * 100.0f;
                     objStream << "v " << x << " " << height << " " << y << "\n";
-                    vertexIndexMap[y][x] = vertexIndex++;
+                    indexRow[x] = vertexIndex++;
                 }
             }
         }
@@ -2164,8 +1741,10 @@ void MainWindow::on_pushButtonTexturize_clicked()
 
         // Escribir coordenadas UV
         for (int y = 0; y < mapHeight; ++y) {
+            heightMapData.rowToLevels(y, levels.data());
+            const float *src = levels.data();
             for (int x = 0; x < mapWidth; ++x) {
-                if (heightMapData[y][x] > HEIGHT_THRESHOLD) {
+                if (src[x] > HEIGHT_THRESHOLD) {
                     float u = (float)x / (float)mapWidth;
                     float v = 1.0f - ((float)y / (float)mapHeight);
                     objStream << "vt " << u << " " << v << "\n";
@@ -2178,11 +1757,13 @@ void MainWindow::on_pushButtonTexturize_clicked()
 
         // Escribir caras
         for (int y = 0; y < mapHeight - 1; ++y) {
+            const int *indexRow0 = vertexIndexMap.data() + static_cast<size_t>(y) * mapWidth;
+            const int *indexRow1 = indexRow0 + mapWidth;
             for (int x = 0; x < mapWidth - 1; ++x) {
-                int topLeft = vertexIndexMap[y][x];
-                int topRight = vertexIndexMap[y][x + 1];
-                int bottomLeft = vertexIndexMap[y + 1][x];
-                int bottomRight = vertexIndexMap[y + 1][x + 1];
+                int topLeft = indexRow0[x];
+                int topRight = indexRow0[x + 1];
+                int bottomLeft = indexRow1[x];
+                int bottomRight = indexRow1[x + 1];
 
                 if (topLeft != -1 && bottomLeft != -1 && topRight != -1) {
                     objStream << "f " << topLeft << "/" << topLeft << " "
@@ -2241,7 +1822,7 @@ void MainWindow::on_pushButtonTexturize_clicked()
             }
         }
 
-        glWidget->generateMesh();
+        glWidget->updateMesh();
         glWidget->update();
 
         qDebug() << "Undo executed. Stack size:" << undoStackTexture->size();
@@ -2268,57 +1849,52 @@ void MainWindow::on_pushButtonTexturize_clicked()
             }
         }
 
-        glWidget->generateMesh();
+        glWidget->updateMesh();
         glWidget->update();
 
         qDebug() << "Redo executed. Stack size:" << redoStackTexture->size();
         };
-    // Lambda de relleno con texturas (flood fill)
+    // Lambda de relleno con texturas (flood fill por tramos, con la
+    // misma tolerancia que el relleno del mapa, por canal)
     auto fillTexture = [=](int startX, int startY, bool isTexture, int textureIndex) {
         if (startX < 0 || startX >= mapWidth || startY < 0 || startY >= mapHeight) return;
 
-        QColor targetColor = paintImage->pixelColor(startX, startY);
-
-        std::queue<QPoint> queue;
-        queue.push(QPoint(startX, startY));
-
-        std::vector<std::vector<bool>> visited(mapHeight, std::vector<bool>(mapWidth, false));
-
-        while (!queue.empty()) {
-            QPoint current = queue.front();
-            queue.pop();
-
-            int x = current.x();
-            int y = current.y();
-
-            if (x < 0 || x >= mapWidth || y < 0 || y >= mapHeight) continue;
-            if (visited[y][x]) continue;
-            if (paintImage->pixelColor(x, y) != targetColor) continue;
-
-            visited[y][x] = true;
-
-            // Calcular color para este píxel específico
-            QColor fillColor;
-            if (isTexture) {
-                const QImage &texture = loadedTextures->at(textureIndex);
-                int texX = x % texture.width();
-                int texY = y % texture.height();
-                fillColor = texture.pixelColor(texX, texY);
-            } else {
-                fillColor = *currentColor;
-            }
-
-            paintImage->setPixel(x, y, fillColor.rgb());
-            glWidget->setColorAtPosition(x, y, fillColor);
-
-            queue.push(QPoint(x, y - 1));
-            queue.push(QPoint(x, y + 1));
-            queue.push(QPoint(x - 1, y));
-            queue.push(QPoint(x + 1, y));
-        }
+        if (paintImage->format() != QImage::Format_RGB32) {
+            *paintImage = paintImage->convertToFormat(QImage::Format_RGB32);
+        }
+        QImage texture;
+        if (isTexture) {
+            texture = loadedTextures->at(textureIndex).convertToFormat(QImage::Format_RGB32);
+        }
+
+        const QRgb targetColor = paintImage->pixel(startX, startY);
+        const int margin = static_cast<int>(std::lround(fillTolerance));
+
+        const QRect filled = FloodFill::fill(mapWidth, mapHeight, startX, startY,
+            [&](int y, int x0, int count) {
+                const QRgb *colors = reinterpret_cast<const QRgb*>(paintImage->constScanLine(y)) + x0;
+                return FloodFill::packBits(count, [&](int i) {
+                    return std::abs(qRed(colors[i]) - qRed(targetColor)) <= margin
+                        && std::abs(qGreen(colors[i]) - qGreen(targetColor)) <= margin
+                        && std::abs(qBlue(colors[i]) - qBlue(targetColor)) <= margin;
+                });
+            },
+            [&](int y, int x0, int x1) {
+                QRgb *row = reinterpret_cast<QRgb*>(paintImage->scanLine(y));
+                const QRgb *texRow = isTexture
+                    ? reinterpret_cast<const QRgb*>(texture.constScanLine(y % texture.height())) : nullptr;
+                const QRgb solid = currentColor->rgb();
+
+                for (int x = x0; x <= x1; ++x) {
+                    // Color para este píxel específico
+                    row[x] = texRow ? texRow[x % texture.width()] : solid;
+                    glWidget->setColorAtPosition(x, y, QColor(row[x]));
+                }
+            });
+        if (filled.isEmpty()) return;
 
         label2D->setPixmap(QPixmap::fromImage(*paintImage));
-        glWidget->generateMesh();
+        glWidget->updateMesh();
         glWidget->update();
     };
 
@@ -2372,7 +1948,7 @@ void MainWindow::on_pushButtonTexturize_clicked()
         }
 
         label2D->setPixmap(QPixmap::fromImage(*paintImage));
-        glWidget->generateMesh();
+        glWidget->updateMesh();
         glWidget->update();
     };
 
@@ -2416,7 +1992,7 @@ void MainWindow::on_pushButtonTexturize_clicked()
         }
 
         label2D->setPixmap(QPixmap::fromImage(*paintImage));
-        glWidget->generateMesh();
+        glWidget->updateMesh();
         glWidget->update();
     };
 
@@ -2432,7 +2008,7 @@ void MainWindow::on_pushButtonTexturize_clicked()
                 if (x >= 0 && x < mapWidth && y >= 0 && y < mapHeight) {
                     float dist = std::sqrt(dx * dx + dy * dy);
                     if (dist <= radius) {
-                        unsigned char height = heightMapData[y][x];
+                        int height = qRound(heightMapData.level(x, y));
                         QColor originalColor(height, height, height);
 
                         if (*brushOpacity < 100) {
@@ -2454,7 +2030,7 @@ void MainWindow::on_pushButtonTexturize_clicked()
         }
 
         label2D->setPixmap(QPixmap::fromImage(*paintImage));
-        glWidget->generateMesh();
+        glWidget->updateMesh();
         glWidget->update();
     };
     // ===== LAMBDA PRINCIPAL DE PINTADO =====
@@ -2572,7 +2148,7 @@ void MainWindow::on_pushButtonTexturize_clicked()
         }
 
         label2D->setPixmap(QPixmap::fromImage(*paintImage));
-        glWidget->generateMesh();
+        glWidget->updateMesh();
         glWidget->update();
     };
 
@@ -2615,36 +2191,10 @@ void MainWindow::on_pushButtonTexturize_clicked()
             fileName += ".hmt";
         }
 
-        QFile file(fileName);
-        if (!file.open(QIODevice::WriteOnly)) {
+        if (!TerrainIO::saveHmtProject(heightMapData, *paintImage, fileName)) {
             QMessageBox::critical(dialog, "Error", "No se pudo crear el archivo.");
             return;
         }
-
-        QDataStream out(&file);
-        out.setByteOrder(QDataStream::LittleEndian);
-
-        // Header
-        out.writeRawData("HMT\0", 4);
-        out << static_cast<quint32>(1);
-        out << static_cast<quint32>(mapWidth);
-        out << static_cast<quint32>(mapHeight);
-
-        // Heightmap
-        for (int y = 0; y < mapHeight; ++y) {
-            for (int x = 0; x < mapWidth; ++x) {
-                out << heightMapData[y][x];
-            }
-        }
-
-        // Textura
-        QByteArray textureData;
-        QBuffer buffer(&textureData);
-        buffer.open(QIODevice::WriteOnly);
-        paintImage->save(&buffer, "PNG");
-        out << textureData;
-
-        file.close();
         QMessageBox::information(dialog, "Éxito", "Proyecto guardado correctamente.");
     });
 
@@ -2676,7 +2226,18 @@ void MainWindow::on_pushButtonTexturize_clicked()
         quint32 version, width, height;
         in >> version >> width >> height;
 
-        if (width < 16 || height < 16 || width > 4096 || height > 4096) {
+        HeightFormat fileFormat = HeightFormat::U8;
+        if (version >= 2) {
+            quint32 formatCode;
+            in >> formatCode;
+            if (!TerrainIO::hmtFormatFromCode(formatCode, fileFormat)) {
+                QMessageBox::critical(dialog, "Error", "Precisión de altura desconocida.");
+                return;
+            }
+        }
+
+        // El texturizado sólo trabaja con mapas que caben en la vista 2D
+        if (width < 16 || height < 16 || width > MaxOverviewSize || height > MaxOverviewSize) {
             QMessageBox::warning(dialog, "Error", "Dimensiones inválidas.");
             return;
         }
@@ -2684,13 +2245,13 @@ void MainWindow::on_pushButtonTexturize_clicked()
         // Leer heightmap
         mapWidth = width;
         mapHeight = height;
-        heightMapData.assign(mapHeight, std::vector<unsigned char>(mapWidth, 0));
+        heightMapData.assign(mapWidth, mapHeight, fileFormat, 0);
+        TerrainIO::readHmtHeights(in, heightMapData);
+        adoptLoadedPrecision();
 
-        for (int y = 0; y < mapHeight; ++y) {
-            for (int x = 0; x < mapWidth; ++x) {
-                in >> heightMapData[y][x];
-            }
-        }
+        // Mapa nuevo: vista e historial como al cargar desde el menú
+        resetMapView();
+        updateHeightmapDisplay();
 
         // Leer textura
         QByteArray textureData;
@@ -2705,13 +2266,13 @@ void MainWindow::on_pushButtonTexturize_clicked()
             label2D->setFixedSize(mapWidth, mapHeight);
 
             // Actualizar OpenGL
-            glWidget->setHeightMapData(heightMapData);
+            glWidget->setHeightMapData(heightMapData.region(0, 0, mapWidth, mapHeight));
             for (int y = 0; y < mapHeight; ++y) {
                 for (int x = 0; x < mapWidth; ++x) {
                     glWidget->setColorAtPosition(x, y, paintImage->pixelColor(x, y));
                 }
             }
-            glWidget->generateMesh();
+            glWidget->updateMesh();
             glWidget->update();
 
             undoStackTexture->clear();
@@ -2871,7 +2432,7 @@ QImage MainWindow::generateColorMapImage(const std::vector<std::vector<QColor>>&
                 image.setPixel(x, y, color.rgb());
             } else {
                 // Color por defecto si es transparente
-                unsigned char h = heightMapData[y][x];
+                int h = qRound(heightMapData.level(x, y));
                 image.setPixel(x, y, qRgb(h, h, h));
             }
         }
@@ -2896,7 +2457,7 @@ void MainWindow::saveHeightMapTextured(const QString &fileName)
     out.writeRawData("HMT\0", 4);
 
     // Version (4 bytes)
-    out << static_cast<quint32>(1);
+    out << TerrainIO::hmtVersionFor(heightMapData.format());
 
     // Dimensiones (8 bytes)
     out << static_cast<quint32>(mapWidth);
@@ -2915,22 +2476,19 @@ void MainWindow::saveHeightMapTextured(const QString &fileName)
     QByteArray desc = "HMT File";
     out.writeRawData(desc.leftJustified(8, '\0', true).constData(), 8);
 
-    // Reserved (4 bytes) - para futuras extensiones
-    out.writeRawData("\0\0\0\0", 4);
+    // Reserved (4 bytes): el primer byte guarda la precisión (versión 2)
+    const char reserved[4] = { static_cast<char>(heightMapData.format()), 0, 0, 0 };
+    out.writeRawData(reserved, 4);
 
     // === ESCRIBIR HEIGHTMAP DATA ===
-    for (int y = 0; y < mapHeight; ++y) {
-        for (int x = 0; x < mapWidth; ++x) {
-            out << heightMapData[y][x];
-        }
-    }
+    TerrainIO::writeHmtHeights(out, heightMapData);
 
     // === ESCRIBIR TEXTURE DATA ===
     // Serializar la textura como PNG en memoria
     QByteArray textureData;
     QBuffer buffer(&textureData);
     buffer.open(QIODevice::WriteOnly);
-    currentImage.save(&buffer, "PNG");
+    TerrainIO::grayscaleImage(heightMapData, overviewScale).save(&buffer, "PNG");
 
     // Escribir el PNG comprimido al archivo
     out << textureData;
@@ -2978,8 +2536,16 @@ void MainWindow::loadHeightMapTextured(const QString &fileName)
     in.readRawData(description, 8);
     in.readRawData(reserved, 4);
 
+    HeightFormat fileFormat = HeightFormat::U8;
+    if (version >= 2 && !TerrainIO::hmtFormatFromCode(static_cast<unsigned char>(reserved[0]), fileFormat)) {
+        QMessageBox::critical(this, "Error", "Precisión de altura desconocida.");
+        file.close();
+        return;
+    }
+
     // Validar dimensiones
-    if (width < 16 || height < 16 || width > 4096 || height > 4096) {
+    const quint32 maxSize = TiledHeightField::MaxSize;
+    if (width < 16 || height < 16 || width > maxSize || height > maxSize) {
         QMessageBox::warning(this, "Error", "Dimensiones inválidas en el archivo.");
         file.close();
         return;
@@ -2993,75 +2559,37 @@ void MainWindow::loadHeightMapTextured(const QString &fileName)
     qDebug() << "  Fecha:" << QDateTime::fromSecsSinceEpoch(timestamp).toString();
 
     // === PASO 3: LEER HEIGHTMAP DATA ===
+    cancelGeneration();
+    try {
+        HeightMapData_t loaded(width, height, fileFormat, 0);
+        TerrainIO::readHmtHeights(in, loaded);
+        heightMapData.swap(loaded);
+    } catch (const std::exception &e) {
+        QMessageBox::critical(this, "Error", QString("No se pudo cargar el mapa: %1").arg(e.what()));
+        file.close();
+        return;
+    }
     mapWidth = width;
     mapHeight = height;
-    heightMapData.assign(mapHeight, std::vector<unsigned char>(mapWidth, 0));
-
-    for (int y = 0; y < mapHeight; ++y) {
-        for (int x = 0; x < mapWidth; ++x) {
-            in >> heightMapData[y][x];
-        }
-    }
+    adoptLoadedPrecision();
 
     // === PASO 4: LEER TEXTURE DATA ===
+    // La vista 2D se regenera desde las alturas; la textura sólo se valida
     QByteArray textureData;
     in >> textureData;
 
-    currentImage.loadFromData(textureData, "PNG");
-    if (currentImage.isNull()) {
+    QImage texture;
+    if (!texture.loadFromData(textureData, "PNG")) {
         QMessageBox::warning(this, "Advertencia",
                              "Heightmap cargado pero la textura está corrupta. Se usará escala de grises.");
-        // Generar imagen en escala de grises como fallback
-        currentImage = QImage(mapWidth, mapHeight, QImage::Format_RGB32);
-        for (int y = 0; y < mapHeight; ++y) {
-            for (int x = 0; x < mapWidth; ++x) {
-                unsigned char height = heightMapData[y][x];
-                currentImage.setPixel(x, y, qRgb(height, height, height));
-            }
-        }
     }
 
     file.close();
 
-    // === PASO 5: ACTUALIZAR UI ===
-    if (dynamicImageLabel) {
-        delete dynamicImageLabel;
-        dynamicImageLabel = nullptr;
-    }
-
-    dynamicImageLabel = new QLabel(ui->scrollAreaDisplay);
-    dynamicImageLabel->setFixedSize(mapWidth, mapHeight);
-    ui->scrollAreaDisplay->setWidget(dynamicImageLabel);
-
-    // Ajustar ventana
-    QScreen *screen = QGuiApplication::primaryScreen();
-    QRect screenGeometry = screen->availableGeometry();
-
-    const int CONTROL_PANEL_WIDTH = 173;
-    const int HORIZONTAL_FRAME_MARGIN = 50;
-    const int VERTICAL_FRAME_MARGIN = 150;
-
-    int maxScrollWidth = screenGeometry.width() - CONTROL_PANEL_WIDTH - HORIZONTAL_FRAME_MARGIN;
-    int maxScrollHeight = screenGeometry.height() - VERTICAL_FRAME_MARGIN;
-
-    int scrollAreaWidth = std::min(mapWidth, maxScrollWidth);
-    int scrollAreaHeight = std::min(mapHeight, maxScrollHeight);
-
-    ui->scrollAreaDisplay->setGeometry(180, 20, scrollAreaWidth, scrollAreaHeight);
-
-    int requiredWidth = 180 + scrollAreaWidth + 20;
-    int requiredHeight = 20 + scrollAreaHeight + 50;
-
-    requiredWidth = std::max(requiredWidth, originalWindowWidth);
-    requiredHeight = std::max(requiredHeight, originalWindowHeight);
-
-    this->setFixedSize(QSize(requiredWidth, requiredHeight));
-
-    // === PASO 6: LIMPIAR HISTORIAL ===
-    undoStack.clear();
-    redoStack.clear();
+    // === PASO 5: ACTUALIZAR UI Y LIMPIAR HISTORIAL ===
+    resetMapView();
 
-    // === PASO 7: ACTUALIZAR DISPLAY ===
+    // === PASO 6: ACTUALIZAR DISPLAY ===
     updateHeightmapDisplay();
 
     QString authorStr = QString::fromUtf8(author, 32).trimmed();
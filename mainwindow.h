@@ -7,16 +7,29 @@
 #include <QEvent>
 #include <QLabel>
 #include <QMouseEvent>
+#include <QAction>
+#include <QActionGroup>
+#include <QMenu>
+#include <QPointer>
 #include <random>
 #include <numeric>
 #include <chrono>
+#include <atomic>
+#include <thread>
 #include "openglwidget.h"
+#include "heightmapcanvas.h"
+#include "heightfield.h"
+#include "tiledheightfield.h"
+#include "noise.h"
+#include "brushes.h"
+#include "stamp.h"
+#include "undohistory.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
-using HeightMapData_t = std::vector<std::vector<unsigned char>>;
+using HeightMapData_t = TiledHeightField;
 
 class MainWindow : public QMainWindow
 {
@@ -46,14 +59,14 @@ private slots:
 
 private:
     Ui::MainWindow *ui;
-    QLabel *dynamicImageLabel;
+    HeightmapCanvas *mapCanvas;
     // Agregar estas líneas:
     int originalWindowWidth;
     int originalWindowHeight;
     HeightMapData_t heightMapData;
-    QImage currentImage;
     int mapWidth = 0;
     int mapHeight = 0;
+    int overviewScale = 1;        // Potencia de 2; > 1 sólo en mapas de más de MaxOverviewSize
     bool isPainting = false;
     int brushColor = 128;  // Color de relleno (0-255
     int brushHeight = 128;
@@ -83,80 +96,93 @@ private:
     // Añadir variables para formas de dos puntos
     QPoint shapeStartPoint;
     bool isDrawingShape = false;
-    QImage previewImage;  // Para mostrar preview durante el dibujo
     BrushMode currentBrushMode = RAISE_LOWER;
-    int flattenHeight = 128;
-
-    // === PERLIN NOISE VARIABLES ===
-    std::vector<int> p;
-    int octaves = 6;
-    double persistence = 0.55;
-    double frequencyOffset = 0.0;
+    float flattenHeight = 128.0f;  // En escala de nivel (0-255), con decimales si la precisión es mayor
+    Brushes::SmoothKernel smoothKernel = Brushes::SmoothKernel::Box;
+    int smoothKernelRadius = 1;
+    double brushHardness = 0.0;   // 0 = caída suave, 1 = borde duro
+    double fillTolerance = 0.0;   // Relleno: diferencia admitida, en escala de nivel
+    double strokeSpacing = 0.25;  // Distancia entre pinceladas, en fracción del radio
+    StrokeInterpolator stroke;    // Reparto de pinceladas del trazo en curso
+
+    // === NOISE VARIABLES ===
+    NoiseContext noiseContext;   // Permutación, octavas, persistencia y desplazamiento
     double frequencyScale = 8.0;
 
-    // === SIMPLEX NOISE FUNCTIONS ===
-    static constexpr int grad3[12][3] = {
-        {1,1,0}, {-1,1,0}, {1,-1,0}, {-1,-1,0},
-        {1,0,1}, {-1,0,1}, {1,0,-1}, {-1,0,-1},
-        {0,1,1}, {0,-1,1}, {0,1,-1}, {0,-1,-1}
+    // === BACKGROUND GENERATION ===
+    // Parámetros del trabajo en curso (copia: el hilo no toca la GUI)
+    struct GenerationParams {
+        NoiseContext ctx;
+        NoiseType type = NoiseType::Perlin;
+        QString noiseName;
+        double baseFrequency = 0.0;
+        int width = 0;
+        int height = 0;
+        HeightFormat format = HeightFormat::U8;
     };
+    GenerationParams generationParams;
+    std::thread generationThread;
+    std::atomic<bool> generationCancelled{false};
+    int generationId = 0;              // Descarta pasadas de trabajos cancelados
+    bool generationRunning = false;
+    QAction *actionCancelGeneration = nullptr;
+
+    // === HEIGHT PRECISION ===
+    // Formato de almacenamiento para mapas nuevos y generados
+    HeightFormat heightFormat = HeightFormat::U8;
+    QActionGroup *precisionActions = nullptr;
+
+    // === 2D VIEW ===
+    // Se aplican al lienzo al crearlo y al cambiarlas en el menú Ver
+    bool acceleratedCanvas = false;
+    HeightmapGLView::Shading canvasShading = HeightmapGLView::Shading::Grayscale;
+    QMenu *menuCanvasShading = nullptr;
 
     // === UNDO/REDO SYSTEM ===
-    std::vector<HeightMapData_t> undoStack;
-    std::vector<HeightMapData_t> redoStack;
-    int maxUndoSteps = 50;
+    UndoHistory undoHistory;
 
     // === 3D VIEW ===
-    OpenGLWidget *glWidget3D = nullptr;
+    // Vista 3D abierta (nula al cerrar el diálogo); sigue las ediciones
+    QPointer<OpenGLWidget> glWidget3D;
+    void updateView3D(const QRect &dirty);
 
     // === UTILITY FUNCTIONS ===
+    void resetMapView();
     void updateHeightmapDisplay();
+    void updateHeightmapDisplay(const QRect &dirty);
     QPoint mapToDataCoordinates(int screenX, int screenY);
-    void applyBrush(int mapX, int mapY);
-    void applySmoothBrush(int mapX, int mapY);
-    void applyFlattenBrush(int mapX, int mapY);
-    void applyNoiseBrush(int mapX, int mapY);
-
-    // === PERLIN NOISE FUNCTIONS ===
+    // Una pincelada del modo actual; devuelven la zona modificada
+    QRect applyDab(int mapX, int mapY);
+    QRect applyBrush(int mapX, int mapY);
+    QRect applySmoothBrush(int mapX, int mapY);
+    QRect applyFlattenBrush(int mapX, int mapY);
+    QRect applyNoiseBrush(int mapX, int mapY);
+    double strokeSpacingPixels() const;
+
+    // === NOISE FUNCTIONS ===
     void initializePerlin();
-    double fade(double t);
-    double lerp(double t, double a, double b);
-    double grad(int hash, double x, double y, double z);
-    double perlin(double x, double y);
-    double fbm(double x, double y);
-
-    // === SIMPLEX NOISE FUNCTIONS ===
-    double simplexNoise(double x, double y);
-    double simplexFbm(double x, double y);
-
-    // === VORONOI NOISE FUNCTIONS ===
-    double voronoiNoise(double x, double y, int numPoints = 20);
-    double voronoiFbm(double x, double y);
-
-    // === RIDGED MULTIFRACTAL ===
-    double ridgedMultifractal(double x, double y);
-
-    // === BILLOWY NOISE ===
-    double billowyNoise(double x, double y);
-    double billowyFbm(double x, double y);
+    static NoiseType noiseTypeFromName(const QString &name);
 
-    // === DOMAIN WARPING ===
-    double domainWarp(double x, double y, double warpStrength = 0.5);
+    // === BACKGROUND GENERATION FUNCTIONS ===
+    void startGeneration();
+    void cancelGeneration();
+    void onGenerationPreview(int id, int step, HeightField pass);
+    void onGenerationFinished(int id, TiledHeightField result);
+    void showGenerationPreview(const HeightField &pass, int step);
 
-    // === VORONOI VARIABLES ===
-    std::vector<std::pair<double, double>> voronoiPoints;
-    int voronoiNumPoints = 20;
+    // === HEIGHT PRECISION FUNCTIONS ===
+    void setHeightFormat(HeightFormat format);
+    void adoptLoadedPrecision();
 
     // === UNDO/REDO FUNCTIONS ===
     void saveStateToUndo();
     void undo();
     void redo();
-    void clearRedoStack();
 
     // DIBUJO DE FORMAS
-    void drawLine(int x1, int y1, int x2, int y2);
-    void drawRectangle(int x1, int y1, int x2, int y2);
-    void drawCircle(int centerX, int centerY, int radius);
+    QRect drawLine(int x1, int y1, int x2, int y2);
+    QRect drawRectangle(int x1, int y1, int x2, int y2);
+    QRect drawCircle(int centerX, int centerY, int radius);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,724 @@
+#include "noise.h"
+#include "noisesimd.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <utility>
+
+namespace {
+
+const int grad3[12][3] = {
+    {1,1,0}, {-1,1,0}, {1,-1,0}, {-1,-1,0},
+    {1,0,1}, {-1,0,1}, {1,0,-1}, {-1,0,-1},
+    {0,1,1}, {0,-1,1}, {0,1,-1}, {0,-1,-1}
+};
+
+inline double fade(double t)
+{
+    return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+inline double lerp(double t, double a, double b)
+{
+    return a + t * (b - a);
+}
+
+inline double grad(int hash, double x, double y, double z)
+{
+    int h = hash & 15;
+    double u = (h < 8) ? x : y;
+    double v = (h < 4) ? y : ((h == 12 || h == 14) ? x : z);
+    return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+}
+
+} // namespace
+
+// =================================================================
+// === NOISE CONTEXT
+// =================================================================
+
+void NoiseContext::reseed(unsigned seed)
+{
+    p.resize(256);
+    std::iota(p.begin(), p.end(), 0);
+    std::shuffle(p.begin(), p.end(), std::default_random_engine(seed));
+    p.insert(p.end(), p.begin(), p.end());
+
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<> distrib(100.0, 5000.0);
+    frequencyOffset = distrib(gen);
+}
+
+namespace Noise {
+
+// =================================================================
+// === NOMBRES
+// =================================================================
+
+const std::vector<NoiseName> &noiseNames()
+{
+    static const std::vector<NoiseName> names = {
+        { "perlin", NoiseType::Perlin },
+        { "simplex", NoiseType::Simplex },
+        { "voronoi", NoiseType::Voronoi },
+        { "ridged", NoiseType::RidgedMultifractal },
+        { "billowy", NoiseType::Billowy },
+        { "warp", NoiseType::DomainWarp }
+    };
+    return names;
+}
+
+bool noiseTypeFromName(const std::string &name, NoiseType &type)
+{
+    auto lower = [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); };
+    for (const NoiseName &entry : noiseNames()) {
+        const std::string candidate = entry.name;
+        if (name.size() == candidate.size()
+            && std::equal(name.begin(), name.end(), candidate.begin(),
+                          [&](char a, char b) { return lower(a) == b; })) {
+            type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+// =================================================================
+// === PERLIN NOISE
+// =================================================================
+
+double perlin(const NoiseContext &ctx, double x, double y)
+{
+    const int *p = ctx.p.data();
+
+    int X = (int)std::floor(x);
+    int Y = (int)std::floor(y);
+
+    x -= std::floor(x);
+    y -= std::floor(y);
+    double z = 0.0;
+
+    double u = fade(x);
+    double v = fade(y);
+
+    int A = p[(X & 255)] + (Y & 255);
+    int B = p[(X + 1) & 255] + (Y & 255);
+
+    int AA = p[A & 511] + 0;
+    int AB = p[B & 511] + 0;
+    int BA = p[A & 511] + 1;
+    int BB = p[B & 511] + 1;
+
+    return lerp(v, lerp(u, grad(p[AA], x, y, z),
+                        grad(p[BA], x - 1, y, z)),
+                lerp(u, grad(p[AB], x, y - 1, z),
+                     grad(p[BB], x - 1, y - 1, z)));
+}
+
+double fbm(const NoiseContext &ctx, double x, double y)
+{
+    double total = 0.0;
+    double amplitude = 1.0;
+    double freq = 1.0;
+    double maxVal = 0.0;
+
+    for (int i = 0; i < ctx.octaves; ++i) {
+        total += perlin(ctx, x * freq, y * freq) * amplitude;
+        maxVal += amplitude;
+
+        amplitude *= ctx.persistence;
+        freq *= 2.0;
+    }
+
+    return total / maxVal;
+}
+
+// =================================================================
+// === SIMPLEX NOISE
+// =================================================================
+
+double simplex(const NoiseContext &ctx, double xin, double yin)
+{
+    const int *p = ctx.p.data();
+
+    const double F2 = 0.5 * (std::sqrt(3.0) - 1.0);
+    const double G2 = (3.0 - std::sqrt(3.0)) / 6.0;
+
+    double s = (xin + yin) * F2;
+    int i = std::floor(xin + s);
+    int j = std::floor(yin + s);
+
+    double t = (i + j) * G2;
+    double X0 = i - t;
+    double Y0 = j - t;
+    double x0 = xin - X0;
+    double y0 = yin - Y0;
+
+    int i1, j1;
+    if (x0 > y0) { i1 = 1; j1 = 0; }
+    else { i1 = 0; j1 = 1; }
+
+    double x1 = x0 - i1 + G2;
+    double y1 = y0 - j1 + G2;
+    double x2 = x0 - 1.0 + 2.0 * G2;
+    double y2 = y0 - 1.0 + 2.0 * G2;
+
+    int ii = i & 255;
+    int jj = j & 255;
+    int gi0 = p[ii + p[jj]] % 12;
+    int gi1 = p[ii + i1 + p[jj + j1]] % 12;
+    int gi2 = p[ii + 1 + p[jj + 1]] % 12;
+
+    double n0 = 0.0, n1 = 0.0, n2 = 0.0;
+
+    double t0 = 0.5 - x0*x0 - y0*y0;
+    if (t0 > 0) {
+        t0 *= t0;
+        n0 = t0 * t0 * (grad3[gi0][0]*x0 + grad3[gi0][1]*y0);
+    }
+
+    double t1 = 0.5 - x1*x1 - y1*y1;
+    if (t1 > 0) {
+        t1 *= t1;
+        n1 = t1 * t1 * (grad3[gi1][0]*x1 + grad3[gi1][1]*y1);
+    }
+
+    double t2 = 0.5 - x2*x2 - y2*y2;
+    if (t2 > 0) {
+        t2 *= t2;
+        n2 = t2 * t2 * (grad3[gi2][0]*x2 + grad3[gi2][1]*y2);
+    }
+
+    return 70.0 * (n0 + n1 + n2);
+}
+
+double simplexFbm(const NoiseContext &ctx, double x, double y)
+{
+    double total = 0.0;
+    double amplitude = 1.0;
+    double freq = 1.0;
+    double maxVal = 0.0;
+
+    for (int i = 0; i < ctx.octaves; ++i) {
+        total += simplex(ctx, x * freq, y * freq) * amplitude;
+        maxVal += amplitude;
+
+        amplitude *= ctx.persistence;
+        freq *= 2.0;
+    }
+
+    return total / maxVal;
+}
+
+// =================================================================
+// === VORONOI NOISE
+// =================================================================
+
+double voronoi(double x, double y)
+{
+    // Determinar la celda actual en una cuadrícula
+    int cellX = static_cast<int>(std::floor(x));
+    int cellY = static_cast<int>(std::floor(y));
+
+    double minDist = std::numeric_limits<double>::max();
+
+    // Buscar en la celda actual y las 8 celdas vecinas
+    for (int offsetY = -1; offsetY <= 1; ++offsetY) {
+        for (int offsetX = -1; offsetX <= 1; ++offsetX) {
+            int neighborX = cellX + offsetX;
+            int neighborY = cellY + offsetY;
+
+            // Generar punto aleatorio para esta celda usando hash
+            unsigned int seed = static_cast<unsigned int>(neighborX * 374761393 + neighborY * 668265263);
+            seed = (seed ^ (seed >> 13)) * 1274126177;
+
+            double pointX = neighborX + (seed & 0xFFFF) / 65535.0;
+            seed = (seed ^ (seed >> 16)) * 85734257;
+            double pointY = neighborY + (seed & 0xFFFF) / 65535.0;
+
+            // Calcular distancia
+            double dx = x - pointX;
+            double dy = y - pointY;
+            double dist = std::sqrt(dx * dx + dy * dy);
+
+            if (dist < minDist) {
+                minDist = dist;
+            }
+        }
+    }
+
+    // Normalizar: la distancia máxima típica en una celda es ~1.414 (diagonal)
+    // Mapear [0, 1.5] a [-1, 1]
+    return (std::min(minDist / 1.5, 1.0) * 2.0) - 1.0;
+}
+
+double voronoiFbm(const NoiseContext &ctx, double x, double y)
+{
+    double total = 0.0;
+    double amplitude = 1.0;
+    double freq = 1.0;
+    double maxVal = 0.0;
+
+    for (int i = 0; i < ctx.octaves; ++i) {
+        total += voronoi(x * freq, y * freq) * amplitude;
+        maxVal += amplitude;
+
+        amplitude *= ctx.persistence;
+        freq *= 2.0;
+    }
+
+    return total / maxVal;
+}
+
+// =================================================================
+// === RIDGED MULTIFRACTAL
+// =================================================================
+
+double ridgedMultifractal(const NoiseContext &ctx, double x, double y)
+{
+    double total = 0.0;
+    double amplitude = 1.0;
+    double freq = 1.0;
+    double maxVal = 0.0;
+
+    for (int i = 0; i < ctx.octaves; ++i) {
+        // Obtener ruido base (usando Perlin)
+        double noiseValue = perlin(ctx, x * freq, y * freq);
+
+        // Aplicar transformación ridged: invertir y tomar valor absoluto
+        noiseValue = 1.0 - std::abs(noiseValue);
+
+        // Elevar al cuadrado para acentuar las crestas
+        noiseValue = noiseValue * noiseValue;
+
+        total += noiseValue * amplitude;
+        maxVal += amplitude;
+
+        amplitude *= ctx.persistence;
+        freq *= 2.0;
+    }
+
+    return (total / maxVal) * 2.0 - 1.0;
+}
+
+// =================================================================
+// === BILLOWY NOISE
+// =================================================================
+
+double billowy(const NoiseContext &ctx, double x, double y)
+{
+    // Billowy usa valor absoluto del ruido para crear formas redondeadas
+    double noiseValue = perlin(ctx, x, y);
+    return std::abs(noiseValue) * 2.0 - 1.0;
+}
+
+double billowyFbm(const NoiseContext &ctx, double x, double y)
+{
+    double total = 0.0;
+    double amplitude = 1.0;
+    double freq = 1.0;
+    double maxVal = 0.0;
+
+    for (int i = 0; i < ctx.octaves; ++i) {
+        double noiseValue = perlin(ctx, x * freq, y * freq);
+        noiseValue = std::abs(noiseValue);
+
+        total += noiseValue * amplitude;
+        maxVal += amplitude;
+
+        amplitude *= ctx.persistence;
+        freq *= 2.0;
+    }
+
+    return (total / maxVal) * 2.0 - 1.0;
+}
+
+// =================================================================
+// === DOMAIN WARPING
+// =================================================================
+
+double domainWarp(const NoiseContext &ctx, double x, double y, double warpStrength)
+{
+    // Usar dos capas de ruido para distorsionar las coordenadas
+    double warpX = perlin(ctx, x * 0.5, y * 0.5) * warpStrength;
+    double warpY = perlin(ctx, x * 0.5 + 100.0, y * 0.5 + 100.0) * warpStrength;
+
+    // Aplicar la distorsión y obtener el ruido final
+    double warpedX = x + warpX;
+    double warpedY = y + warpY;
+
+    return fbm(ctx, warpedX, warpedY);
+}
+
+// =================================================================
+// === TERRAIN GENERATION
+// =================================================================
+
+double sample(const NoiseContext &ctx, NoiseType type, double x, double y)
+{
+    switch (type) {
+    case NoiseType::Simplex:
+        return simplexFbm(ctx, x, y);
+    case NoiseType::Voronoi:
+        return voronoiFbm(ctx, x, y);
+    case NoiseType::RidgedMultifractal:
+        return ridgedMultifractal(ctx, x, y);
+    case NoiseType::Billowy:
+        return billowyFbm(ctx, x, y);
+    case NoiseType::DomainWarp:
+        return domainWarp(ctx, x, y, TerrainWarpStrength);
+    case NoiseType::Perlin:
+    default:
+        return fbm(ctx, x, y);
+    }
+}
+
+// =================================================================
+// === TEMPLATED GENERATOR
+// =================================================================
+// Cada combinación de ruido base, combinador y número de octavas es
+// una instancia distinta: el bucle de octavas se desenrolla en tiempo
+// de compilación y no queda ninguna decisión dentro del lote. La
+// elección se hace una sola vez en batchSampler().
+
+namespace {
+
+// Muestras por lote: cabe en la pila y reparte el coste de la llamada
+// indirecta al kernel
+constexpr int BatchSize = 256;
+
+// Octavas que se instancian desenrolladas; el resto usa el bucle normal
+constexpr int MaxUnrolledOctaves = 10;
+
+// === RUIDO BASE ===
+
+struct PerlinBase
+{
+    static void eval(const NoiseContext &ctx, const NoiseSimd::Kernels *kernels,
+                     const double *xs, const double *ys, double *out, int count)
+    {
+        if (kernels) {
+            kernels->perlin(ctx.p.data(), xs, ys, out, count);
+            return;
+        }
+        for (int i = 0; i < count; ++i) out[i] = perlin(ctx, xs[i], ys[i]);
+    }
+};
+
+struct SimplexBase
+{
+    static void eval(const NoiseContext &ctx, const NoiseSimd::Kernels *kernels,
+                     const double *xs, const double *ys, double *out, int count)
+    {
+        if (kernels) {
+            kernels->simplex(ctx.p.data(), xs, ys, out, count);
+            return;
+        }
+        for (int i = 0; i < count; ++i) out[i] = simplex(ctx, xs[i], ys[i]);
+    }
+};
+
+struct VoronoiBase
+{
+    static void eval(const NoiseContext &, const NoiseSimd::Kernels *kernels,
+                     const double *xs, const double *ys, double *out, int count)
+    {
+        if (kernels) {
+            kernels->voronoi(xs, ys, out, count);
+            return;
+        }
+        for (int i = 0; i < count; ++i) out[i] = voronoi(xs[i], ys[i]);
+    }
+};
+
+// === COMBINADORES ===
+// shape() transforma el valor de cada octava y finish() el promedio,
+// con las mismas operaciones que fbm(), ridgedMultifractal() y
+// billowyFbm().
+
+struct FbmShape
+{
+    static double shape(double v) { return v; }
+    static double finish(double v) { return v; }
+};
+
+struct RidgedShape
+{
+    static double shape(double v)
+    {
+        v = 1.0 - std::abs(v);
+        return v * v;
+    }
+    static double finish(double v) { return v * 2.0 - 1.0; }
+};
+
+struct BillowyShape
+{
+    static double shape(double v) { return std::abs(v); }
+    static double finish(double v) { return v * 2.0 - 1.0; }
+};
+
+struct OctaveState
+{
+    double total[BatchSize];
+    double sx[BatchSize];
+    double sy[BatchSize];
+    double noise[BatchSize];
+    double amplitude = 1.0;
+    double freq = 1.0;
+    double maxVal = 0.0;
+};
+
+template <class Base, class Shape>
+inline void accumulateOctave(OctaveState &s, const NoiseContext &ctx, const NoiseSimd::Kernels *kernels,
+                             const double *xs, const double *ys, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        s.sx[i] = xs[i] * s.freq;
+        s.sy[i] = ys[i] * s.freq;
+    }
+    Base::eval(ctx, kernels, s.sx, s.sy, s.noise, count);
+
+    for (int i = 0; i < count; ++i) {
+        s.total[i] += Shape::shape(s.noise[i]) * s.amplitude;
+    }
+    s.maxVal += s.amplitude;
+
+    s.amplitude *= ctx.persistence;
+    s.freq *= 2.0;
+}
+
+template <class Base, class Shape, int Remaining>
+inline void unrolledOctaves(OctaveState &s, const NoiseContext &ctx, const NoiseSimd::Kernels *kernels,
+                            const double *xs, const double *ys, int count)
+{
+    if constexpr (Remaining > 0) {
+        accumulateOctave<Base, Shape>(s, ctx, kernels, xs, ys, count);
+        unrolledOctaves<Base, Shape, Remaining - 1>(s, ctx, kernels, xs, ys, count);
+    }
+}
+
+// Octaves == 0: número de octavas en tiempo de ejecución (ctx.octaves)
+template <class Base, class Shape, int Octaves>
+struct Fractal
+{
+    static void run(const NoiseContext &ctx, const NoiseSimd::Kernels *kernels,
+                    const double *xs, const double *ys, double *out, int count)
+    {
+        OctaveState s;
+        std::fill(s.total, s.total + count, 0.0);
+
+        if constexpr (Octaves > 0) {
+            unrolledOctaves<Base, Shape, Octaves>(s, ctx, kernels, xs, ys, count);
+        } else {
+            for (int octave = 0; octave < ctx.octaves; ++octave) {
+                accumulateOctave<Base, Shape>(s, ctx, kernels, xs, ys, count);
+            }
+        }
+
+        for (int i = 0; i < count; ++i) {
+            out[i] = Shape::finish(s.total[i] / s.maxVal);
+        }
+    }
+};
+
+// Domain warping: desplaza las coordenadas con dos capas de Perlin y
+// aplica fbm sobre el resultado, como domainWarp()
+template <int Octaves>
+struct Warp
+{
+    static void run(const NoiseContext &ctx, const NoiseSimd::Kernels *kernels,
+                    const double *xs, const double *ys, double *out, int count)
+    {
+        double wx[BatchSize], wy[BatchSize], warpX[BatchSize], warpY[BatchSize];
+
+        for (int i = 0; i < count; ++i) {
+            wx[i] = xs[i] * 0.5;
+            wy[i] = ys[i] * 0.5;
+        }
+        PerlinBase::eval(ctx, kernels, wx, wy, warpX, count);
+
+        for (int i = 0; i < count; ++i) {
+            wx[i] = xs[i] * 0.5 + 100.0;
+            wy[i] = ys[i] * 0.5 + 100.0;
+        }
+        PerlinBase::eval(ctx, kernels, wx, wy, warpY, count);
+
+        for (int i = 0; i < count; ++i) {
+            wx[i] = xs[i] + warpX[i] * TerrainWarpStrength;
+            wy[i] = ys[i] + warpY[i] * TerrainWarpStrength;
+        }
+        Fractal<PerlinBase, FbmShape, Octaves>::run(ctx, kernels, wx, wy, out, count);
+    }
+};
+
+// Recorre count muestras en lotes de BatchSize con el generador G
+template <class G>
+void sampleWith(const NoiseContext &ctx, const double *xs, const double *ys, double *out, int count)
+{
+    const NoiseSimd::Kernels *kernels = NoiseSimd::active();
+    for (int begin = 0; begin < count; begin += BatchSize) {
+        const int n = std::min(BatchSize, count - begin);
+        G::run(ctx, kernels, xs + begin, ys + begin, out + begin, n);
+    }
+}
+
+template <template <int> class G, int... Octaves>
+BatchSampler pickOctaves(int octaves, std::integer_sequence<int, Octaves...>)
+{
+    BatchSampler sampler = &sampleWith<G<0>>;
+    ((octaves == Octaves ? (void)(sampler = &sampleWith<G<Octaves>>) : (void)0), ...);
+    return sampler;
+}
+
+template <template <int> class G>
+BatchSampler pickOctaves(int octaves)
+{
+    if (octaves < 1 || octaves > MaxUnrolledOctaves) return &sampleWith<G<0>>;
+    return pickOctaves<G>(octaves, std::make_integer_sequence<int, MaxUnrolledOctaves + 1>());
+}
+
+template <int Octaves> using PerlinFbm = Fractal<PerlinBase, FbmShape, Octaves>;
+template <int Octaves> using SimplexFbm = Fractal<SimplexBase, FbmShape, Octaves>;
+template <int Octaves> using VoronoiFbm = Fractal<VoronoiBase, FbmShape, Octaves>;
+template <int Octaves> using PerlinRidged = Fractal<PerlinBase, RidgedShape, Octaves>;
+template <int Octaves> using PerlinBillowy = Fractal<PerlinBase, BillowyShape, Octaves>;
+
+} // namespace
+
+BatchSampler batchSampler(NoiseType type, int octaves)
+{
+    switch (type) {
+    case NoiseType::Simplex:
+        return pickOctaves<SimplexFbm>(octaves);
+    case NoiseType::Voronoi:
+        return pickOctaves<VoronoiFbm>(octaves);
+    case NoiseType::RidgedMultifractal:
+        return pickOctaves<PerlinRidged>(octaves);
+    case NoiseType::Billowy:
+        return pickOctaves<PerlinBillowy>(octaves);
+    case NoiseType::DomainWarp:
+        return pickOctaves<Warp>(octaves);
+    case NoiseType::Perlin:
+    default:
+        return pickOctaves<PerlinFbm>(octaves);
+    }
+}
+
+// =================================================================
+// === BATCH SAMPLING
+// =================================================================
+
+void perlinBatch(const NoiseContext &ctx, const double *xs, const double *ys, double *out, int count)
+{
+    if (const NoiseSimd::Kernels *kernels = NoiseSimd::active()) {
+        kernels->perlin(ctx.p.data(), xs, ys, out, count);
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        out[i] = perlin(ctx, xs[i], ys[i]);
+    }
+}
+
+void simplexBatch(const NoiseContext &ctx, const double *xs, const double *ys, double *out, int count)
+{
+    if (const NoiseSimd::Kernels *kernels = NoiseSimd::active()) {
+        kernels->simplex(ctx.p.data(), xs, ys, out, count);
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        out[i] = simplex(ctx, xs[i], ys[i]);
+    }
+}
+
+void voronoiBatch(const double *xs, const double *ys, double *out, int count)
+{
+    if (const NoiseSimd::Kernels *kernels = NoiseSimd::active()) {
+        kernels->voronoi(xs, ys, out, count);
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        out[i] = voronoi(xs[i], ys[i]);
+    }
+}
+
+void sampleBatch(const NoiseContext &ctx, NoiseType type, const double *xs, const double *ys, double *out, int count)
+{
+    batchSampler(type, ctx.octaves)(ctx, xs, ys, out, count);
+}
+
+const char *simdPathName()
+{
+    const NoiseSimd::Kernels *kernels = NoiseSimd::active();
+    return kernels ? kernels->name : "escalar";
+}
+
+namespace {
+
+// Fila y de out = fila originY + y * step del mapa completo
+bool generateRows(HeightField &out, const NoiseContext &ctx, NoiseType type, double baseFrequency,
+                  int step, int originY, const std::atomic<bool> *cancel)
+{
+    const int width = out.width();
+    const BatchSampler sampler = batchSampler(type, ctx.octaves);
+    auto cancelled = [cancel]() { return cancel && cancel->load(std::memory_order_relaxed); };
+
+    // Cada píxel depende sólo de (x, y) y del contexto: las bandas
+    // pueden calcularse en cualquier orden sin cambiar el resultado
+    ThreadPool::instance().parallelFor(0, out.height(), [&](int rowBegin, int rowEnd) {
+        std::vector<double> sampleX(width);
+        std::vector<double> sampleY(width);
+        std::vector<double> noiseValues(width);
+
+        for (int x = 0; x < width; ++x) {
+            sampleX[x] = (double)(x * step) * baseFrequency + ctx.frequencyOffset;
+        }
+
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            if (cancelled()) return;
+
+            std::fill(sampleY.begin(), sampleY.end(), (double)(originY + y * step) * baseFrequency + ctx.frequencyOffset);
+
+            sampler(ctx, sampleX.data(), sampleY.data(), noiseValues.data(), width);
+
+            // Cuantización al formato del campo (u8 igual que siempre)
+            dispatchHeightFormat(out.format(), [&](auto tag) {
+                using T = decltype(tag);
+                T *row = out.row<T>(y);
+                for (int x = 0; x < width; ++x) {
+                    row[x] = HeightTraits<T>::fromNoise(noiseValues[x]);
+                }
+            });
+        }
+    });
+
+    return !cancelled();
+}
+
+} // namespace
+
+bool generate(HeightField &out, const NoiseContext &ctx, NoiseType type, double baseFrequency,
+              int step, const std::atomic<bool> *cancel)
+{
+    return generateRows(out, ctx, type, baseFrequency, step, 0, cancel);
+}
+
+bool generate(TiledHeightField &out, const NoiseContext &ctx, NoiseType type, double baseFrequency,
+              const std::atomic<bool> *cancel)
+{
+    HeightField band;
+
+    for (int bandY = 0; bandY < out.height(); bandY += TiledHeightField::TileSize) {
+        // La última banda puede ser más baja; assign reutiliza la reserva
+        band.assign(out.width(), std::min(TiledHeightField::TileSize, out.height() - bandY), out.format(), 0.0f);
+        if (!generateRows(band, ctx, type, baseFrequency, 1, bandY, cancel)) return false;
+        out.writeRegion(band, 0, bandY);
+    }
+    return true;
+}
+
+} // namespace Noise
@@ -0,0 +1,117 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "heightfield.h"
+#include "tiledheightfield.h"
+
+// =================================================================
+// === NOISE CONTEXT
+// =================================================================
+// Estado inmutable del ruido durante una generación. Se pasa por
+// referencia constante a todas las funciones, así que puede leerse
+// desde varios hilos a la vez sin sincronización.
+
+struct NoiseContext
+{
+    std::vector<int> p;             // Permutación duplicada (512 entradas)
+    int octaves = 6;
+    double persistence = 0.55;
+    double frequencyOffset = 0.0;
+
+    // Baraja la permutación y elige un desplazamiento aleatorio
+    void reseed(unsigned seed);
+    bool isSeeded() const { return p.size() == 512; }
+};
+
+enum class NoiseType {
+    Perlin,
+    Simplex,
+    Voronoi,
+    RidgedMultifractal,
+    Billowy,
+    DomainWarp
+};
+
+// Nombre corto de un tipo ("perlin", "ridged"...) para la línea de
+// órdenes y las pruebas de rendimiento
+struct NoiseName {
+    const char *name;
+    NoiseType type;
+};
+
+namespace Noise {
+
+// === NOMBRES ===
+// Todos los tipos, en el orden de NoiseType
+const std::vector<NoiseName> &noiseNames();
+// Tipo con ese nombre corto, sin distinguir mayúsculas; false si no hay
+bool noiseTypeFromName(const std::string &name, NoiseType &type);
+
+// === FUNCIONES BASE ===
+double perlin(const NoiseContext &ctx, double x, double y);
+double simplex(const NoiseContext &ctx, double x, double y);
+double voronoi(double x, double y);
+
+// === FRACTALES ===
+double fbm(const NoiseContext &ctx, double x, double y);
+double simplexFbm(const NoiseContext &ctx, double x, double y);
+double voronoiFbm(const NoiseContext &ctx, double x, double y);
+double ridgedMultifractal(const NoiseContext &ctx, double x, double y);
+double billowy(const NoiseContext &ctx, double x, double y);
+double billowyFbm(const NoiseContext &ctx, double x, double y);
+double domainWarp(const NoiseContext &ctx, double x, double y, double warpStrength = 0.5);
+
+// Valor en [-1, 1] del algoritmo indicado
+double sample(const NoiseContext &ctx, NoiseType type, double x, double y);
+
+// === LOTES (SIMD) ===
+// out[i] = f(xs[i], ys[i]) para count muestras, con SSE2, AVX2 o
+// AVX-512 según la CPU. Mismo resultado que las funciones escalares.
+void perlinBatch(const NoiseContext &ctx, const double *xs, const double *ys, double *out, int count);
+void simplexBatch(const NoiseContext &ctx, const double *xs, const double *ys, double *out, int count);
+void voronoiBatch(const double *xs, const double *ys, double *out, int count);
+void sampleBatch(const NoiseContext &ctx, NoiseType type, const double *xs, const double *ys, double *out, int count);
+
+// Generador especializado para un tipo de ruido y número de octavas
+// (bucle de octavas desenrollado hasta 10). Se elige una vez y se
+// reutiliza en todas las filas; el contexto debe tener esas octavas.
+using BatchSampler = void (*)(const NoiseContext &ctx, const double *xs, const double *ys, double *out, int count);
+BatchSampler batchSampler(NoiseType type, int octaves);
+
+// Ruta vectorial en uso ("AVX2", "SSE2", "escalar"...)
+const char *simdPathName();
+
+// Intensidad del domain warping usada por el generador de terreno
+constexpr double TerrainWarpStrength = 50.0;
+
+// Frecuencia base del generador de terreno: un ciclo de ruido cada
+// frequencyScale veces el lado menor del mapa
+inline double terrainBaseFrequency(int width, int height, double frequencyScale)
+{
+    double scale = width < height ? width : height;
+    return 1.0 / (scale * frequencyScale);
+}
+
+// Rellena todo el campo en paralelo por bandas de filas, evaluando
+// cada fila por lotes. El resultado es idéntico bit a bit al
+// recorrido serie con sample().
+//
+// Con step > 1, out es una vista previa: el píxel (x, y) toma el valor
+// del píxel (x * step, y * step) del mapa completo. Si cancel se activa
+// las filas pendientes se saltan y devuelve false.
+bool generate(HeightField &out, const NoiseContext &ctx, NoiseType type, double baseFrequency,
+              int step = 1, const std::atomic<bool> *cancel = nullptr);
+
+// Mapa completo por tiles: genera una fila de tiles cada vez (en
+// paralelo, como la versión anterior) y la vuelca al campo, así que la
+// memoria usada no depende del tamaño del mapa. Mismo resultado que
+// generate() sobre un HeightField con step = 1.
+bool generate(TiledHeightField &out, const NoiseContext &ctx, NoiseType type, double baseFrequency,
+              const std::atomic<bool> *cancel = nullptr);
+
+} // namespace Noise
+
+#endif // NOISE_H
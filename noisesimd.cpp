@@ -0,0 +1,100 @@
+#include "noisesimd.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(HEIGHTMAP_X86_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace NoiseSimd {
+
+namespace {
+
+#if defined(HEIGHTMAP_X86_SIMD)
+
+// Nivel más alto que soportan la CPU y el sistema operativo
+Level detectLevel()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || maxLeaf < 7) return Level::SSE2;
+
+    // El sistema debe guardar los registros YMM (y ZMM para AVX-512)
+    const unsigned long long xcr0 = _xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6) return Level::SSE2;
+
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    const bool avx512f = (info[1] & (1 << 16)) != 0;
+    if (avx512f && (xcr0 & 0xE6) == 0xE6) return Level::AVX512;
+    if (avx2) return Level::AVX2;
+    return Level::SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Level::AVX512;
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+    return Level::Scalar;
+#endif
+}
+
+#else
+
+Level detectLevel()
+{
+    return Level::Scalar;
+}
+
+#endif
+
+// HEIGHTMAP_SIMD permite forzar una ruta más baja (pruebas, medidas)
+Level requestedLevel(Level detected)
+{
+    const char *env = std::getenv("HEIGHTMAP_SIMD");
+    if (!env || !*env) return detected;
+
+    Level requested = detected;
+    if (std::strcmp(env, "scalar") == 0) requested = Level::Scalar;
+    else if (std::strcmp(env, "sse2") == 0) requested = Level::SSE2;
+    else if (std::strcmp(env, "avx2") == 0) requested = Level::AVX2;
+    else if (std::strcmp(env, "avx512") == 0) requested = Level::AVX512;
+
+    return (requested < detected) ? requested : detected;
+}
+
+const Kernels *kernelsFor(Level level)
+{
+#if defined(HEIGHTMAP_X86_SIMD)
+    switch (level) {
+    case Level::AVX512:
+        return &avx512Kernels();
+    case Level::AVX2:
+        return &avx2Kernels();
+    case Level::SSE2:
+        return &sse2Kernels();
+    case Level::Scalar:
+    default:
+        return nullptr;
+    }
+#else
+    (void)level;
+    return nullptr;
+#endif
+}
+
+} // namespace
+
+const Kernels *active()
+{
+    static const Kernels *kernels = kernelsFor(requestedLevel(detectLevel()));
+    return kernels;
+}
+
+} // namespace NoiseSimd
@@ -0,0 +1,45 @@
+#ifndef NOISESIMD_H
+#define NOISESIMD_H
+
+// =================================================================
+// === SIMD NOISE KERNELS (interno)
+// =================================================================
+// Tabla de kernels por lotes elegida en tiempo de ejecución. Cada
+// conjunto de instrucciones vive en su propia unidad de compilación
+// (noisesimd_sse2/avx2/avx512.cpp) compilada con sus flags, por eso
+// estas funciones sólo reciben punteros crudos y no usan plantillas
+// de la STL: nada compilado con AVX puede acabar en código común.
+
+namespace NoiseSimd {
+
+enum class Level {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+struct Kernels
+{
+    // p: permutación de 512 entradas. Evalúan out[i] = f(xs[i], ys[i]).
+    void (*perlin)(const int *p, const double *xs, const double *ys, double *out, int count);
+    void (*simplex)(const int *p, const double *xs, const double *ys, double *out, int count);
+    void (*voronoi)(const double *xs, const double *ys, double *out, int count);
+    Level level;
+    const char *name;
+};
+
+// Kernels para la mejor ruta disponible, o nullptr si sólo hay la
+// escalar. La variable de entorno HEIGHTMAP_SIMD (scalar, sse2, avx2,
+// avx512) limita la ruta elegida.
+const Kernels *active();
+
+#if defined(HEIGHTMAP_X86_SIMD)
+const Kernels &sse2Kernels();
+const Kernels &avx2Kernels();
+const Kernels &avx512Kernels();
+#endif
+
+} // namespace NoiseSimd
+
+#endif // NOISESIMD_H
@@ -0,0 +1,66 @@
+#include "noisesimd.h"
+#include <immintrin.h>
+
+namespace {
+
+// AVX2: cuatro carriles de double y cuatro enteros en un __m128i
+struct VecAvx2
+{
+    using D = __m256d;
+    using M = __m256d;
+    using I = __m128i;
+    static constexpr int N = 4;
+
+    static D load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, D v) { _mm256_storeu_pd(p, v); }
+    static D set1(double v) { return _mm256_set1_pd(v); }
+
+    static D add(D a, D b) { return _mm256_add_pd(a, b); }
+    static D sub(D a, D b) { return _mm256_sub_pd(a, b); }
+    static D mul(D a, D b) { return _mm256_mul_pd(a, b); }
+    static D div(D a, D b) { return _mm256_div_pd(a, b); }
+    static D min(D a, D b) { return _mm256_min_pd(a, b); }
+    static D sqrt(D a) { return _mm256_sqrt_pd(a); }
+    static D floor(D x) { return _mm256_floor_pd(x); }
+
+    static M cmpgt(D a, D b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static D select(M m, D a, D b) { return _mm256_blendv_pd(b, a, m); }
+    static D negateIf(M m, D a) { return _mm256_xor_pd(a, _mm256_and_pd(m, _mm256_set1_pd(-0.0))); }
+
+    static I toInt(D a) { return _mm256_cvttpd_epi32(a); }
+    static D toDouble(I a) { return _mm256_cvtepi32_pd(a); }
+    static M widen(I m) { return _mm256_castsi256_pd(_mm256_cvtepi32_epi64(m)); }
+
+    static I iset1(int v) { return _mm_set1_epi32(v); }
+    static I iadd(I a, I b) { return _mm_add_epi32(a, b); }
+    static I isub(I a, I b) { return _mm_sub_epi32(a, b); }
+    static I iand(I a, I b) { return _mm_and_si128(a, b); }
+    static I ior(I a, I b) { return _mm_or_si128(a, b); }
+    static I ixor(I a, I b) { return _mm_xor_si128(a, b); }
+    static I isrl(I a, int count) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+    static I imul(I a, I b) { return _mm_mullo_epi32(a, b); }
+    static I icmplt(I a, I b) { return _mm_cmplt_epi32(a, b); }
+    static I icmpeq(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+    static I iselect(I m, I a, I b) { return _mm_blendv_epi8(b, a, m); }
+    static I gather(const int *table, I index) { return _mm_i32gather_epi32(table, index, 4); }
+};
+
+} // namespace
+
+#include "noisesimd_kernels.h"
+
+namespace NoiseSimd {
+
+const Kernels &avx2Kernels()
+{
+    static const Kernels kernels = {
+        perlinKernel<VecAvx2>,
+        simplexKernel<VecAvx2>,
+        voronoiKernel<VecAvx2>,
+        Level::AVX2,
+        "AVX2"
+    };
+    return kernels;
+}
+
+} // namespace NoiseSimd
@@ -0,0 +1,78 @@
+#include "noisesimd.h"
+#include <cstdint>
+#include <immintrin.h>
+
+namespace {
+
+// AVX-512F: ocho carriles de double y ocho enteros en un __m256i. Las
+// máscaras de double son registros k; and/xor de double son de
+// AVX-512DQ, así que el cambio de signo se hace sobre enteros.
+struct VecAvx512
+{
+    using D = __m512d;
+    using M = __mmask8;
+    using I = __m256i;
+    static constexpr int N = 8;
+
+    static D load(const double *p) { return _mm512_loadu_pd(p); }
+    static void store(double *p, D v) { _mm512_storeu_pd(p, v); }
+    static D set1(double v) { return _mm512_set1_pd(v); }
+
+    static D add(D a, D b) { return _mm512_add_pd(a, b); }
+    static D sub(D a, D b) { return _mm512_sub_pd(a, b); }
+    static D mul(D a, D b) { return _mm512_mul_pd(a, b); }
+    static D div(D a, D b) { return _mm512_div_pd(a, b); }
+    static D min(D a, D b) { return _mm512_min_pd(a, b); }
+    static D sqrt(D a) { return _mm512_sqrt_pd(a); }
+    static D floor(D x) { return _mm512_roundscale_pd(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+    static M cmpgt(D a, D b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static D select(M m, D a, D b) { return _mm512_mask_blend_pd(m, b, a); }
+    static D negateIf(M m, D a)
+    {
+        const __m512i bits = _mm512_castpd_si512(a);
+        const __m512i sign = _mm512_set1_epi64(INT64_MIN);
+        return _mm512_castsi512_pd(_mm512_mask_xor_epi64(bits, m, bits, sign));
+    }
+
+    static I toInt(D a) { return _mm512_cvttpd_epi32(a); }
+    static D toDouble(I a) { return _mm512_cvtepi32_pd(a); }
+    static M widen(I m)
+    {
+        const __m512i wide = _mm512_cvtepi32_epi64(m);
+        return _mm512_test_epi64_mask(wide, wide);
+    }
+
+    static I iset1(int v) { return _mm256_set1_epi32(v); }
+    static I iadd(I a, I b) { return _mm256_add_epi32(a, b); }
+    static I isub(I a, I b) { return _mm256_sub_epi32(a, b); }
+    static I iand(I a, I b) { return _mm256_and_si256(a, b); }
+    static I ior(I a, I b) { return _mm256_or_si256(a, b); }
+    static I ixor(I a, I b) { return _mm256_xor_si256(a, b); }
+    static I isrl(I a, int count) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+    static I imul(I a, I b) { return _mm256_mullo_epi32(a, b); }
+    static I icmplt(I a, I b) { return _mm256_cmpgt_epi32(b, a); }
+    static I icmpeq(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+    static I iselect(I m, I a, I b) { return _mm256_blendv_epi8(b, a, m); }
+    static I gather(const int *table, I index) { return _mm256_i32gather_epi32(table, index, 4); }
+};
+
+} // namespace
+
+#include "noisesimd_kernels.h"
+
+namespace NoiseSimd {
+
+const Kernels &avx512Kernels()
+{
+    static const Kernels kernels = {
+        perlinKernel<VecAvx512>,
+        simplexKernel<VecAvx512>,
+        voronoiKernel<VecAvx512>,
+        Level::AVX512,
+        "AVX-512"
+    };
+    return kernels;
+}
+
+} // namespace NoiseSimd
@@ -0,0 +1,279 @@
+#ifndef NOISESIMD_KERNELS_H
+#define NOISESIMD_KERNELS_H
+
+// =================================================================
+// === SIMD NOISE KERNELS (plantillas)
+// =================================================================
+// Sólo lo incluyen noisesimd_sse2/avx2/avx512.cpp, cada uno dentro de
+// un espacio de nombres anónimo y con su propio tipo V que envuelve
+// los intrínsecos (V::N carriles de double). Las operaciones siguen
+// el mismo orden que las versiones escalares de noise.cpp para que
+// cada muestra dé exactamente el mismo valor.
+//
+// V::I lleva un entero de 32 bits por carril para los hashes y las
+// consultas a la permutación (gather); V::M es la máscara de double.
+
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// Índice del gradiente de simplex: v % 12 para v en [0, 255] sin
+// división (43691 / 2^19 aproxima 1/12 de sobra para ese rango)
+template <class V>
+inline typename V::I simdMod12(typename V::I v)
+{
+    const typename V::I quotient = V::isrl(V::imul(v, V::iset1(43691)), 19);
+    return V::isub(v, V::imul(quotient, V::iset1(12)));
+}
+
+template <class V>
+inline typename V::D simdFade(typename V::D t)
+{
+    using D = typename V::D;
+    const D inner = V::add(V::mul(t, V::sub(V::mul(t, V::set1(6.0)), V::set1(15.0))), V::set1(10.0));
+    return V::mul(V::mul(V::mul(t, t), t), inner);
+}
+
+template <class V>
+inline typename V::D simdLerp(typename V::D t, typename V::D a, typename V::D b)
+{
+    return V::add(a, V::mul(t, V::sub(b, a)));
+}
+
+// Mismo criterio que grad() en noise.cpp con z = 0
+template <class V>
+inline typename V::D simdGrad(typename V::I hash, typename V::D x, typename V::D y)
+{
+    using D = typename V::D;
+    using I = typename V::I;
+
+    const I h = V::iand(hash, V::iset1(15));
+    const I one = V::iset1(1);
+    const I two = V::iset1(2);
+
+    const D u = V::select(V::widen(V::icmplt(h, V::iset1(8))), x, y);
+    const I vIsX = V::ior(V::icmpeq(h, V::iset1(12)), V::icmpeq(h, V::iset1(14)));
+    const D v = V::select(V::widen(V::icmplt(h, V::iset1(4))), y,
+                          V::select(V::widen(vIsX), x, V::set1(0.0)));
+
+    return V::add(V::negateIf(V::widen(V::icmpeq(V::iand(h, one), one)), u),
+                  V::negateIf(V::widen(V::icmpeq(V::iand(h, two), two)), v));
+}
+
+// === PERLIN ===
+
+template <class V>
+inline void perlinBlock(const int *p, const double *xs, const double *ys, double *out)
+{
+    using D = typename V::D;
+    using I = typename V::I;
+
+    D x = V::load(xs);
+    D y = V::load(ys);
+    const D fx = V::floor(x);
+    const D fy = V::floor(y);
+
+    const I X = V::toInt(fx);
+    const I Y = V::toInt(fy);
+    const I mask255 = V::iset1(255);
+    const I mask511 = V::iset1(511);
+    const I one = V::iset1(1);
+
+    const I Yl = V::iand(Y, mask255);
+    const I A = V::iadd(V::gather(p, V::iand(X, mask255)), Yl);
+    const I B = V::iadd(V::gather(p, V::iand(V::iadd(X, one), mask255)), Yl);
+
+    const I AA = V::gather(p, V::iand(A, mask511));
+    const I AB = V::gather(p, V::iand(B, mask511));
+    const I BA = V::iadd(AA, one);
+    const I BB = V::iadd(AB, one);
+
+    x = V::sub(x, fx);
+    y = V::sub(y, fy);
+    const D x1 = V::sub(x, V::set1(1.0));
+    const D y1 = V::sub(y, V::set1(1.0));
+
+    const D u = simdFade<V>(x);
+    const D v = simdFade<V>(y);
+
+    const D result = simdLerp<V>(v,
+        simdLerp<V>(u, simdGrad<V>(V::gather(p, AA), x, y), simdGrad<V>(V::gather(p, BA), x1, y)),
+        simdLerp<V>(u, simdGrad<V>(V::gather(p, AB), x, y1), simdGrad<V>(V::gather(p, BB), x1, y1)));
+    V::store(out, result);
+}
+
+// === SIMPLEX ===
+
+// Contribución de una esquina; gi es el índice en grad3 (0..11)
+template <class V>
+inline typename V::D simplexCorner(typename V::I gi, typename V::D x, typename V::D y)
+{
+    using D = typename V::D;
+    using I = typename V::I;
+
+    // grad3[gi] = (gx, gy): signos según los bits bajos de gi
+    const I one = V::iset1(1);
+    const I signBit0 = V::isub(one, V::iadd(V::iand(gi, one), V::iand(gi, one)));
+    const I signBit1 = V::isub(one, V::iand(gi, V::iset1(2)));
+    const I below4 = V::icmplt(gi, V::iset1(4));
+    const I below8 = V::icmplt(gi, V::iset1(8));
+    const I gx = V::iand(below8, signBit0);
+    const I gy = V::iselect(below4, signBit1, V::iselect(below8, V::iset1(0), signBit0));
+
+    const D zero = V::set1(0.0);
+    D t = V::sub(V::sub(V::set1(0.5), V::mul(x, x)), V::mul(y, y));
+    const auto inside = V::cmpgt(t, zero);
+    t = V::mul(t, t);
+    const D n = V::mul(V::mul(t, t), V::add(V::mul(V::toDouble(gx), x), V::mul(V::toDouble(gy), y)));
+    return V::select(inside, n, zero);
+}
+
+template <class V>
+inline void simplexBlock(const int *p, const double *xs, const double *ys, double *out)
+{
+    using D = typename V::D;
+    using I = typename V::I;
+
+    const double F2 = 0.5 * (std::sqrt(3.0) - 1.0);
+    const double G2 = (3.0 - std::sqrt(3.0)) / 6.0;
+
+    const D xin = V::load(xs);
+    const D yin = V::load(ys);
+
+    const D s = V::mul(V::add(xin, yin), V::set1(F2));
+    const D fi = V::floor(V::add(xin, s));
+    const D fj = V::floor(V::add(yin, s));
+
+    const D t = V::mul(V::add(fi, fj), V::set1(G2));
+    const D x0 = V::sub(xin, V::sub(fi, t));
+    const D y0 = V::sub(yin, V::sub(fj, t));
+
+    const D zero = V::set1(0.0);
+    const D one = V::set1(1.0);
+    const auto upper = V::cmpgt(x0, y0);
+    const D i1 = V::select(upper, one, zero);
+    const D j1 = V::select(upper, zero, one);
+
+    const D g2 = V::set1(G2);
+    const D corner2 = V::set1(2.0 * G2);
+    const D x1 = V::add(V::sub(x0, i1), g2);
+    const D y1 = V::add(V::sub(y0, j1), g2);
+    const D x2 = V::add(V::sub(x0, one), corner2);
+    const D y2 = V::add(V::sub(y0, one), corner2);
+
+    const I mask255 = V::iset1(255);
+    const I ione = V::iset1(1);
+    const I ii = V::iand(V::toInt(fi), mask255);
+    const I jj = V::iand(V::toInt(fj), mask255);
+    const I ii1 = V::toInt(i1);
+    const I jj1 = V::toInt(j1);
+
+    const I gi0 = simdMod12<V>(V::gather(p, V::iadd(ii, V::gather(p, jj))));
+    const I gi1 = simdMod12<V>(V::gather(p, V::iadd(V::iadd(ii, ii1), V::gather(p, V::iadd(jj, jj1)))));
+    const I gi2 = simdMod12<V>(V::gather(p, V::iadd(V::iadd(ii, ione), V::gather(p, V::iadd(jj, ione)))));
+
+    const D n0 = simplexCorner<V>(gi0, x0, y0);
+    const D n1 = simplexCorner<V>(gi1, x1, y1);
+    const D n2 = simplexCorner<V>(gi2, x2, y2);
+
+    V::store(out, V::mul(V::set1(70.0), V::add(V::add(n0, n1), n2)));
+}
+
+// === VORONOI ===
+
+template <class V>
+inline void voronoiBlock(const double *xs, const double *ys, double *out)
+{
+    using D = typename V::D;
+    using I = typename V::I;
+
+    const D x = V::load(xs);
+    const D y = V::load(ys);
+    const I cellX = V::toInt(V::floor(x));
+    const I cellY = V::toInt(V::floor(y));
+
+    const I lowBits = V::iset1(0xFFFF);
+    const D hashRange = V::set1(65535.0);
+    D minDist = V::set1(DBL_MAX);
+
+    for (int offsetY = -1; offsetY <= 1; ++offsetY) {
+        for (int offsetX = -1; offsetX <= 1; ++offsetX) {
+            const I neighborX = V::iadd(cellX, V::iset1(offsetX));
+            const I neighborY = V::iadd(cellY, V::iset1(offsetY));
+
+            // Hash sin signo de 32 bits, como en voronoi()
+            I seed = V::iadd(V::imul(neighborX, V::iset1(374761393)),
+                             V::imul(neighborY, V::iset1(668265263)));
+            seed = V::imul(V::ixor(seed, V::isrl(seed, 13)), V::iset1(1274126177));
+            const D pointX = V::add(V::toDouble(neighborX), V::div(V::toDouble(V::iand(seed, lowBits)), hashRange));
+            seed = V::imul(V::ixor(seed, V::isrl(seed, 16)), V::iset1(85734257));
+            const D pointY = V::add(V::toDouble(neighborY), V::div(V::toDouble(V::iand(seed, lowBits)), hashRange));
+
+            const D dx = V::sub(x, pointX);
+            const D dy = V::sub(y, pointY);
+            const D dist = V::sqrt(V::add(V::mul(dx, dx), V::mul(dy, dy)));
+
+            // min(a, b) = a < b ? a : b, igual que el "if" escalar
+            minDist = V::min(dist, minDist);
+        }
+    }
+
+    const D normalized = V::min(V::set1(1.0), V::div(minDist, V::set1(1.5)));
+    V::store(out, V::sub(V::mul(normalized, V::set1(2.0)), V::set1(1.0)));
+}
+
+// === BUCLES ===
+// Bloques completos de N muestras; el resto se rellena en un bloque
+// temporal repitiendo la última muestra.
+
+template <int N, class Block>
+inline void forEachBlock(const double *xs, const double *ys, double *out, int count, Block block)
+{
+    int i = 0;
+    for (; i + N <= count; i += N) {
+        block(xs + i, ys + i, out + i);
+    }
+
+    const int rest = count - i;
+    if (rest > 0) {
+        double tailX[N], tailY[N], tailOut[N];
+        for (int k = 0; k < N; ++k) {
+            const int src = i + (k < rest ? k : rest - 1);
+            tailX[k] = xs[src];
+            tailY[k] = ys[src];
+        }
+        block(tailX, tailY, tailOut);
+        for (int k = 0; k < rest; ++k) {
+            out[i + k] = tailOut[k];
+        }
+    }
+}
+
+template <class V>
+void perlinKernel(const int *p, const double *xs, const double *ys, double *out, int count)
+{
+    forEachBlock<V::N>(xs, ys, out, count, [p](const double *bx, const double *by, double *bo) {
+        perlinBlock<V>(p, bx, by, bo);
+    });
+}
+
+template <class V>
+void simplexKernel(const int *p, const double *xs, const double *ys, double *out, int count)
+{
+    forEachBlock<V::N>(xs, ys, out, count, [p](const double *bx, const double *by, double *bo) {
+        simplexBlock<V>(p, bx, by, bo);
+    });
+}
+
+template <class V>
+void voronoiKernel(const double *xs, const double *ys, double *out, int count)
+{
+    forEachBlock<V::N>(xs, ys, out, count, [](const double *bx, const double *by, double *bo) {
+        voronoiBlock<V>(bx, by, bo);
+    });
+}
+
+} // namespace
+
+#endif // NOISESIMD_KERNELS_H
@@ -0,0 +1,95 @@
+#include "noisesimd.h"
+#include <emmintrin.h>
+
+namespace {
+
+// SSE2: dos carriles de double; los enteros usan los dos carriles
+// bajos de un __m128i. Faltan floor, mullo y gather, que se emulan.
+struct VecSse2
+{
+    using D = __m128d;
+    using M = __m128d;
+    using I = __m128i;
+    static constexpr int N = 2;
+
+    static D load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, D v) { _mm_storeu_pd(p, v); }
+    static D set1(double v) { return _mm_set1_pd(v); }
+
+    static D add(D a, D b) { return _mm_add_pd(a, b); }
+    static D sub(D a, D b) { return _mm_sub_pd(a, b); }
+    static D mul(D a, D b) { return _mm_mul_pd(a, b); }
+    static D div(D a, D b) { return _mm_div_pd(a, b); }
+    static D min(D a, D b) { return _mm_min_pd(a, b); }
+    static D sqrt(D a) { return _mm_sqrt_pd(a); }
+
+    static D floor(D x)
+    {
+        const D signMask = _mm_set1_pd(-0.0);
+        const D twoTo52 = _mm_set1_pd(4503599627370496.0);
+        const D magnitude = _mm_andnot_pd(signMask, x);
+
+        // Redondeo al entero más cercano conservando el signo
+        D rounded = _mm_sub_pd(_mm_add_pd(magnitude, twoTo52), twoTo52);
+        rounded = _mm_or_pd(rounded, _mm_and_pd(x, signMask));
+        rounded = _mm_sub_pd(rounded, _mm_and_pd(_mm_cmpgt_pd(rounded, x), _mm_set1_pd(1.0)));
+
+        // A partir de 2^52 todos los double ya son enteros
+        const M isIntegral = _mm_cmpge_pd(magnitude, twoTo52);
+        return select(isIntegral, x, rounded);
+    }
+
+    static M cmpgt(D a, D b) { return _mm_cmpgt_pd(a, b); }
+    static D select(M m, D a, D b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+    static D negateIf(M m, D a) { return _mm_xor_pd(a, _mm_and_pd(m, _mm_set1_pd(-0.0))); }
+
+    static I toInt(D a) { return _mm_cvttpd_epi32(a); }
+    static D toDouble(I a) { return _mm_cvtepi32_pd(a); }
+    static M widen(I m) { return _mm_castsi128_pd(_mm_unpacklo_epi32(m, m)); }
+
+    static I iset1(int v) { return _mm_set1_epi32(v); }
+    static I iadd(I a, I b) { return _mm_add_epi32(a, b); }
+    static I isub(I a, I b) { return _mm_sub_epi32(a, b); }
+    static I iand(I a, I b) { return _mm_and_si128(a, b); }
+    static I ior(I a, I b) { return _mm_or_si128(a, b); }
+    static I ixor(I a, I b) { return _mm_xor_si128(a, b); }
+    static I isrl(I a, int count) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+    static I icmplt(I a, I b) { return _mm_cmplt_epi32(a, b); }
+    static I icmpeq(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+    static I iselect(I m, I a, I b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+
+    static I imul(I a, I b)
+    {
+        // Producto bajo de 32 bits a partir de los productos de 64
+        const I even = _mm_mul_epu32(a, b);
+        const I odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    static I gather(const int *table, I index)
+    {
+        return _mm_setr_epi32(table[_mm_cvtsi128_si32(index)],
+                              table[_mm_cvtsi128_si32(_mm_srli_si128(index, 4))], 0, 0);
+    }
+};
+
+} // namespace
+
+#include "noisesimd_kernels.h"
+
+namespace NoiseSimd {
+
+const Kernels &sse2Kernels()
+{
+    static const Kernels kernels = {
+        perlinKernel<VecSse2>,
+        simplexKernel<VecSse2>,
+        voronoiKernel<VecSse2>,
+        Level::SSE2,
+        "SSE2"
+    };
+    return kernels;
+}
+
+} // namespace NoiseSimd
@@ -1,9 +1,14 @@
 #include "openglwidget.h"
+#include "terrainmesh.h"
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLPixelTransferOptions>
+#include <QVector2D>
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QKeyEvent>
 #include <QDebug>
 #include <cmath>
+#include <cstddef>
 #include <algorithm>
 
 OpenGLWidget::OpenGLWidget(QWidget *parent)
@@ -65,6 +70,13 @@ OpenGLWidget::~OpenGLWidget()
         delete waterEBO;
     }
 
+    delete heightShader;
+    delete heightTexture;
+    delete patchVAO;
+    delete patchVBO;
+    delete patchEBO;
+    delete patchInstanceVBO;
+
     if (terrainTexture) {
         delete terrainTexture;
         terrainTexture = nullptr;
@@ -117,6 +129,16 @@ void OpenGLWidget::setupShaders()
         return;
     }
 
+    // Shader del relieve en GPU: si falla, la vista usa la malla
+    heightShader = new QOpenGLShaderProgram(this);
+    if (!heightShader->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/terrain_height.vert")
+        || !heightShader->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/terrain_height.frag")
+        || !heightShader->link()) {
+        qDebug() << "ERROR: Failed to build height displacement shader:" << heightShader->log();
+        delete heightShader;
+        heightShader = nullptr;
+    }
+
     qDebug() << "Shaders compiled and linked successfully";
 }
 
@@ -174,6 +196,8 @@ void OpenGLWidget::initializeGL()
         waterEBO = new QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
         waterEBO->create();
 
+        if (heightShader) setupPatchBuffers();
+
         qDebug() << "VAOs and VBOs created successfully";
     }
 
@@ -181,7 +205,7 @@ void OpenGLWidget::initializeGL()
 
     if (!heightMapData.empty() && mapWidth > 0 && mapHeight > 0) {
         qDebug() << "Generating deferred meshes...";
-        generateMesh();
+        if (!displacementEnabled) generateMesh();
         generateWaterMesh();
 
         qDebug() << "Splatmap initialized:" << mapWidth << "x" << mapHeight;
@@ -198,21 +222,28 @@ void OpenGLWidget::setupTerrainBuffers()
     terrainVAO->bind();
 
     terrainVBO->bind();
-    terrainVBO->allocate(vertices.data(), vertices.size() * sizeof(float));
+    terrainVBO->allocate(vertices.data(), static_cast<int>(vertices.size() * sizeof(TerrainMesh::Vertex)));
 
     terrainShader->bind();
 
+    // TerrainMesh::Vertex: posición en el trozo (sin normalizar), altura
+    // y color (normalizados)
+    const GLsizei stride = sizeof(TerrainMesh::Vertex);
     terrainShader->enableAttributeArray(0);
-    terrainShader->setAttributeBuffer(0, GL_FLOAT, 0, 3, 8 * sizeof(float));
+    glVertexAttribPointer(0, 2, GL_UNSIGNED_BYTE, GL_FALSE, stride,
+                          reinterpret_cast<const void *>(offsetof(TerrainMesh::Vertex, x)));
 
     terrainShader->enableAttributeArray(1);
-    terrainShader->setAttributeBuffer(1, GL_FLOAT, 3 * sizeof(float), 3, 8 * sizeof(float));
+    glVertexAttribPointer(1, 1, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                          reinterpret_cast<const void *>(offsetof(TerrainMesh::Vertex, height)));
 
     terrainShader->enableAttributeArray(2);
-    terrainShader->setAttributeBuffer(2, GL_FLOAT, 6 * sizeof(float), 2, 8 * sizeof(float));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                          reinterpret_cast<const void *>(offsetof(TerrainMesh::Vertex, r)));
 
+    // Índices de un trozo, comunes a todos
     terrainEBO->bind();
-    terrainEBO->allocate(indices.data(), indices.size() * sizeof(unsigned int));
+    terrainEBO->allocate(indices.data(), static_cast<int>(indices.size() * sizeof(quint16)));
 
     terrainVAO->release();
     terrainShader->release();
@@ -256,171 +287,74 @@ void OpenGLWidget::generateMesh()
 {
     qDebug() << "generateMesh called";
 
-    vertices.clear();
-    indices.clear();
-
     if (heightMapData.empty() || mapWidth == 0 || mapHeight == 0) {
+        vertices.clear();
+        indices.clear();
         qDebug() << "ERROR: Cannot generate mesh - no heightmap data";
         return;
     }
 
-    // Reservar memoria
-    size_t totalVertices = static_cast<size_t>(mapWidth) * static_cast<size_t>(mapHeight);
-    size_t totalIndices = static_cast<size_t>(mapWidth - 1) * static_cast<size_t>(mapHeight - 1) * 6;
-
-    vertices.reserve(totalVertices * 8);
-    indices.reserve(totalIndices);
+    TerrainMesh::buildTerrain(heightMapData, colorMap, vertices);
+    TerrainMesh::buildChunkIndices(indices);
+    dirtyRegion = QRect();
+    pendingUpload = QRect();
 
-    qDebug() << "Reserved memory for" << totalVertices << "vertices and" << totalIndices << "indices";
+    qDebug() << "Mesh generated:" << vertices.size() << "vertices in" << chunks.size() << "chunks,"
+             << vertices.size() * sizeof(TerrainMesh::Vertex) / 1024 << "KB";
 
-    // Generar vértices
-    for (int y = 0; y < mapHeight; ++y) {
-        for (int x = 0; x < mapWidth; ++x) {
-            float height = heightMapData[y][x] / 255.0f * 100.0f;
-
-            vertices.push_back(static_cast<float>(x));
-            vertices.push_back(height);
-            vertices.push_back(static_cast<float>(y));
-
-            // Usar colorMap solo si NO está vacío y tiene las dimensiones correctas
-            float r, g, b;
-            if (!colorMap.empty() &&
-                colorMap.size() == static_cast<size_t>(mapHeight) &&
-                !colorMap[y].empty() &&
-                colorMap[y].size() == static_cast<size_t>(mapWidth) &&
-                colorMap[y][x].isValid()) {
-                // Usar color pintado
-                r = colorMap[y][x].redF();
-                g = colorMap[y][x].greenF();
-                b = colorMap[y][x].blueF();
-            } else {
-                // Usar colores por altura (sistema original)
-                if (height < 20.0f) {
-                    r = 0.2f; g = 0.4f; b = 0.8f;
-                } else if (height < 40.0f) {
-                    r = 0.76f; g = 0.7f; b = 0.5f;
-                } else if (height < 60.0f) {
-                    r = 0.2f; g = 0.6f; b = 0.2f;
-                } else if (height < 80.0f) {
-                    r = 0.5f; g = 0.5f; b = 0.5f;
-                } else {
-                    r = 1.0f; g = 1.0f; b = 1.0f;
-                }
-            }
+    setupTerrainBuffers();
+}
 
-            vertices.push_back(r);
-            vertices.push_back(g);
-            vertices.push_back(b);
+void OpenGLWidget::updateMesh()
+{
+    if (dirtyRegion.isEmpty()) return;
+    // Con relieve en GPU no hay malla que actualizar
+    if (displacementEnabled) {
+        dirtyRegion = QRect();
+        return;
+    }
 
-            vertices.push_back(static_cast<float>(x) / mapWidth);
-            vertices.push_back(static_cast<float>(y) / mapHeight);
-        }
+    if (vertices.size() != chunks.size() * TerrainMesh::ChunkVertices || indices.empty()) {
+        generateMesh();
+        return;
     }
 
-    // Generar índices (sin cambios)
-    for (int y = 0; y < mapHeight - 1; ++y) {
-        for (int x = 0; x < mapWidth - 1; ++x) {
-            unsigned int topLeft = y * mapWidth + x;
-            unsigned int topRight = topLeft + 1;
-            unsigned int bottomLeft = (y + 1) * mapWidth + x;
-            unsigned int bottomRight = bottomLeft + 1;
+    pendingUpload |= TerrainMesh::updateTerrain(heightMapData, colorMap, dirtyRegion, vertices);
+    dirtyRegion = QRect();
+}
 
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
+void OpenGLWidget::uploadPendingVertices()
+{
+    if (pendingUpload.isEmpty() || !terrainVBO) return;
+    const QRect area = pendingUpload;
+    pendingUpload = QRect();
 
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
-        }
+    // Cada trozo tocado sube sus filas de vértices afectadas de una vez
+    const int vertexBytes = sizeof(TerrainMesh::Vertex);
+    terrainVBO->bind();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const QRect local = TerrainMesh::chunkVertexArea(chunks[i], area, mapWidth, mapHeight);
+        if (local.isEmpty()) continue;
+        const size_t first = i * TerrainMesh::ChunkVertices + static_cast<size_t>(local.top()) * TerrainMesh::ChunkSide;
+        const size_t count = static_cast<size_t>(local.height()) * TerrainMesh::ChunkSide;
+        terrainVBO->write(static_cast<int>(first * vertexBytes), vertices.data() + first,
+                          static_cast<int>(count * vertexBytes));
     }
-
-    qDebug() << "Mesh generated:" << vertices.size() / 8 << "vertices,"
-             << indices.size() / 3 << "triangles";
-
-    setupTerrainBuffers();
+    terrainVBO->release();
 }
+
 void OpenGLWidget::generateWaterMesh()
 {
-    waterVertices.clear();
-    waterIndices.clear();
-
     if (mapWidth <= 0 || mapHeight <= 0 || heightMapData.empty()) {
+        waterVertices.clear();
+        waterIndices.clear();
         qDebug() << "ERROR: Invalid map dimensions for water mesh";
         return;
     }
 
-    float waterHeight = waterLevel;
-    unsigned int vertexIndex = 0;
-
-    // Generar agua solo en zonas bajas del terreno
-    for (int y = 0; y < mapHeight - 1; ++y) {
-        for (int x = 0; x < mapWidth - 1; ++x) {
-            // Obtener las alturas de las 4 esquinas de la celda
-            float h1 = heightMapData[y][x] / 255.0f * 100.0f;
-            float h2 = heightMapData[y][x + 1] / 255.0f * 100.0f;
-            float h3 = heightMapData[y + 1][x + 1] / 255.0f * 100.0f;
-            float h4 = heightMapData[y + 1][x] / 255.0f * 100.0f;
-
-            // Solo generar agua si AL MENOS UNA esquina está bajo el nivel del agua
-            if (h1 < waterHeight || h2 < waterHeight ||
-                h3 < waterHeight || h4 < waterHeight) {
-
-                // Vértice 0: esquina superior izquierda (X, Y, Z, R, G, B, U, V)
-                waterVertices.push_back(static_cast<float>(x));
-                waterVertices.push_back(waterHeight);
-                waterVertices.push_back(static_cast<float>(y));
-                waterVertices.push_back(waterColor.x());
-                waterVertices.push_back(waterColor.y());
-                waterVertices.push_back(waterColor.z());
-                waterVertices.push_back(static_cast<float>(x) / mapWidth);
-                waterVertices.push_back(static_cast<float>(y) / mapHeight);
-
-                // Vértice 1: esquina superior derecha
-                waterVertices.push_back(static_cast<float>(x + 1));
-                waterVertices.push_back(waterHeight);
-                waterVertices.push_back(static_cast<float>(y));
-                waterVertices.push_back(waterColor.x());
-                waterVertices.push_back(waterColor.y());
-                waterVertices.push_back(waterColor.z());
-                waterVertices.push_back(static_cast<float>(x + 1) / mapWidth);
-                waterVertices.push_back(static_cast<float>(y) / mapHeight);
-
-                // Vértice 2: esquina inferior derecha
-                waterVertices.push_back(static_cast<float>(x + 1));
-                waterVertices.push_back(waterHeight);
-                waterVertices.push_back(static_cast<float>(y + 1));
-                waterVertices.push_back(waterColor.x());
-                waterVertices.push_back(waterColor.y());
-                waterVertices.push_back(waterColor.z());
-                waterVertices.push_back(static_cast<float>(x + 1) / mapWidth);
-                waterVertices.push_back(static_cast<float>(y + 1) / mapHeight);
-
-                // Vértice 3: esquina inferior izquierda
-                waterVertices.push_back(static_cast<float>(x));
-                waterVertices.push_back(waterHeight);
-                waterVertices.push_back(static_cast<float>(y + 1));
-                waterVertices.push_back(waterColor.x());
-                waterVertices.push_back(waterColor.y());
-                waterVertices.push_back(waterColor.z());
-                waterVertices.push_back(static_cast<float>(x) / mapWidth);
-                waterVertices.push_back(static_cast<float>(y + 1) / mapHeight);
-
-                // Dos triángulos para formar el quad
-                waterIndices.push_back(vertexIndex);
-                waterIndices.push_back(vertexIndex + 1);
-                waterIndices.push_back(vertexIndex + 2);
-
-                waterIndices.push_back(vertexIndex);
-                waterIndices.push_back(vertexIndex + 2);
-                waterIndices.push_back(vertexIndex + 3);
-
-                vertexIndex += 4;
-            }
-        }
-    }
+    TerrainMesh::buildWater(heightMapData, waterLevel, waterColor, waterVertices, waterIndices);
 
-    qDebug() << "Water mesh generated:" << vertexIndex / 4 << "quads at level:" << waterLevel;
+    qDebug() << "Water mesh generated:" << waterIndices.size() / 6 << "quads at level:" << waterLevel;
 
     // Configurar buffers después de generar geometría
     setupWaterBuffers();
@@ -428,7 +362,11 @@ void OpenGLWidget::generateWaterMesh()
 void OpenGLWidget::setWaterLevel(float level)
 {
     waterLevel = level;
-    generateWaterMesh();
+    if (context() && context()->isValid()) {
+        makeCurrent();
+        generateWaterMesh();
+        doneCurrent();
+    }
     update();
 
     qDebug() << "Water level set to:" << waterLevel;
@@ -623,19 +561,19 @@ void OpenGLWidget::keyPressEvent(QKeyEvent *event)
 
     update();
 }
-void OpenGLWidget::setHeightMapData(const std::vector<std::vector<unsigned char>>& data)
+void OpenGLWidget::setHeightMapData(const HeightField& data)
 {
     qDebug() << "setHeightMapData called";
 
-    if (data.empty() || data[0].empty()) {
+    if (data.empty()) {
         qDebug() << "WARNING: Empty heightmap data!";
         return;
     }
 
     qDebug() << "Copying heightMapData...";
     heightMapData = data;
-    mapHeight = data.size();
-    mapWidth = data[0].size();
+    mapHeight = data.height();
+    mapWidth = data.width();
 
     qDebug() << "Map dimensions:" << mapWidth << "x" << mapHeight;
 
@@ -646,15 +584,26 @@ void OpenGLWidget::setHeightMapData(const std::vector<std::vector<unsigned char>
         colorMapValid = true;  // AGREGAR ESTA LÍNEA
         qDebug() << "colorMap initialized with dimensions:" << mapWidth << "x" << mapHeight;
     }
+    TerrainMesh::buildChunks(heightMapData, chunks);
+    TerrainMesh::buildLodPyramid(heightMapData, chunks, lodPyramid);
+
+    // Con relieve en GPU basta con volver a subir la textura
+    heightTextureDirty = true;
+    pendingHeightUpload = QRect();
+
     qDebug() << "Checking OpenGL context...";
     if (context() && context()->isValid()) {
-        qDebug() << "Calling generateMesh()...";
-        generateMesh();
-        qDebug() << "generateMesh() completed";
+        makeCurrent();
+        if (!displacementEnabled) {
+            qDebug() << "Calling generateMesh()...";
+            generateMesh();
+            qDebug() << "generateMesh() completed";
+        }
 
         qDebug() << "Calling generateWaterMesh()...";
         generateWaterMesh();
         qDebug() << "generateWaterMesh() completed";
+        doneCurrent();
 
         qDebug() << "Calling update()...";
         update();
@@ -671,6 +620,8 @@ void OpenGLWidget::setTexturePaintMode(bool enabled)
 {
     qDebug() << "setTexturePaintMode called with:" << enabled;
     texturePaintMode = enabled;
+    // Los colores pintados van en los vértices de la malla
+    if (enabled) setHeightDisplacement(false);
 
     if (!enabled) {
         qDebug() << "Texture paint mode disabled";
@@ -815,8 +766,9 @@ void OpenGLWidget::applyTextureBrush(const QPoint &screenPos)
 
     qDebug() << "Modified" << pixelsModified << "pixels at map coords:" << mapX << "," << mapZ;
 
-    // Regenerar malla para ver los cambios
-    generateMesh();
+    // Actualizar sólo los vértices del pincel
+    dirtyRegion |= QRect(mapX - brushRadius, mapZ - brushRadius, 2 * brushRadius + 1, 2 * brushRadius + 1);
+    updateMesh();
     update();
 }
 void OpenGLWidget::paintEvent(QPaintEvent *event)
@@ -867,10 +819,19 @@ void OpenGLWidget::paintGL()
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    if (vertices.empty() || indices.empty()) {
+    if (displacementEnabled && !heightMapData.empty() && !prepareHeightTexture()) {
+        qDebug() << "Height displacement unavailable, falling back to mesh";
+        displacementEnabled = false;
+        generateMesh();
+    }
+    const bool displaced = displacementEnabled && heightTexture;
+
+    if (!displaced && (vertices.empty() || indices.empty())) {
         return;
     }
 
+    if (!displaced) uploadPendingVertices();
+
     // Configurar matrices de transformación
     view.setToIdentity();
     view.translate(0.0f, -50.0f + cameraY, -zoom);
@@ -883,24 +844,26 @@ void OpenGLWidget::paintGL()
 
     QMatrix4x4 mvp = projection * view * model;
 
-    // RENDERIZAR TERRENO CON SHADER
-    terrainShader->bind();
-    terrainShader->setUniformValue("mvpMatrix", mvp);
-    terrainShader->setUniformValue("useTexture", useTexture);
-
-    if (useTexture && terrainTexture) {
-        terrainTexture->bind(0);
-        terrainShader->setUniformValue("textureSampler", 0);
+    // Trozos dentro del frustum
+    const int visible = TerrainMesh::visibleChunks(chunks, mvp, visibleChunks);
+    if (visible != visibleChunkTotal || chunks.size() != reportedChunks) {
+        visibleChunkTotal = visible;
+        reportedChunks = chunks.size();
+        emit chunkVisibilityChanged(visible, static_cast<int>(chunks.size()) - visible);
     }
 
-    terrainVAO->bind();
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    terrainVAO->release();
-
-    if (useTexture && terrainTexture) {
-        terrainTexture->release();
+    // RENDERIZAR TERRENO
+    int triangles = 0;
+    if (displaced) {
+        const QVector3D camera = (view * model).inverted().map(QVector3D(0.0f, 0.0f, 0.0f));
+        triangles = drawDisplacedTerrain(mvp, camera);
+    } else {
+        triangles = drawMeshTerrain(mvp);
+    }
+    if (triangles != triangleTotal) {
+        triangleTotal = triangles;
+        emit triangleCountChanged(triangles);
     }
-    terrainShader->release();
 
     // RENDERIZAR AGUA CON SHADER
     if (showWater && !waterVertices.empty() && !waterIndices.empty()) {
@@ -940,6 +903,340 @@ void OpenGLWidget::paintGL()
     }
 }
 
+// =================================================================
+// === RELIEVE EN GPU
+// =================================================================
+
+void OpenGLWidget::setHeightDisplacement(bool enabled)
+{
+    // Los colores pintados van en los vértices de la malla
+    if (texturePaintMode) enabled = false;
+    if (enabled == displacementEnabled) return;
+    displacementEnabled = enabled;
+
+    const bool ready = context() && context()->isValid();
+    if (enabled) {
+        // La malla ya no hace falta: fuera de la RAM y de la GPU
+        std::vector<TerrainMesh::Vertex>().swap(vertices);
+        std::vector<quint16>().swap(indices);
+        dirtyRegion = QRect();
+        pendingUpload = QRect();
+        heightTextureDirty = true;
+        if (ready) {
+            makeCurrent();
+            releaseMeshBuffers();
+            doneCurrent();
+        }
+    } else {
+        if (ready) {
+            makeCurrent();
+            delete heightTexture;
+            heightTexture = nullptr;
+            generateMesh();
+            doneCurrent();
+        }
+        heightTextureDirty = true;
+    }
+    update();
+}
+
+void OpenGLWidget::updateHeightRegion(const HeightField &patch, int x, int y)
+{
+    if (heightMapData.empty() || patch.empty()) return;
+
+    heightMapData.copyRegion(patch, 0, 0, patch.width(), patch.height(), x, y);
+    const QRect area = QRect(x, y, patch.width(), patch.height()) & QRect(0, 0, mapWidth, mapHeight);
+    if (area.isEmpty()) return;
+    TerrainMesh::updateChunkBounds(heightMapData, area, chunks);
+    TerrainMesh::buildLodPyramid(heightMapData, chunks, lodPyramid);
+
+    if (displacementEnabled) {
+        pendingHeightUpload |= area;
+    } else {
+        dirtyRegion |= area;
+        if (context() && context()->isValid()) {
+            makeCurrent();
+            updateMesh();
+            doneCurrent();
+        }
+    }
+    update();
+}
+
+void OpenGLWidget::setLodPixelError(float pixels)
+{
+    lodError = std::max(pixels, 0.1f);
+    update();
+}
+
+void OpenGLWidget::updateWater()
+{
+    if (!context() || !context()->isValid()) return;
+    makeCurrent();
+    generateWaterMesh();
+    doneCurrent();
+    update();
+}
+
+void OpenGLWidget::releaseMeshBuffers()
+{
+    if (!terrainVAO) return;
+    terrainVAO->bind();
+    terrainVBO->bind();
+    terrainVBO->allocate(0);
+    terrainEBO->bind();
+    terrainEBO->allocate(0);
+    terrainVAO->release();
+    terrainVBO->release();
+}
+
+void OpenGLWidget::setupPatchBuffers()
+{
+    // Rejilla de un nodo, (ChunkCells + 1)^2 vértices con sus
+    // coordenadas en vértices; cabe con índices de 16 bits
+    const int patchCells = TerrainMesh::ChunkCells;
+    const int side = patchCells + 1;
+    std::vector<GLushort> grid;
+    grid.reserve(static_cast<size_t>(side) * side * 2);
+    for (int z = 0; z < side; ++z) {
+        for (int x = 0; x < side; ++x) {
+            grid.push_back(static_cast<GLushort>(x));
+            grid.push_back(static_cast<GLushort>(z));
+        }
+    }
+
+    // Índices por cuadrantes: el primero solo dibuja los nodos quarter
+    const int half = patchCells / 2;
+    std::vector<GLushort> patchIndices;
+    patchIndices.reserve(static_cast<size_t>(patchCells) * patchCells * 6);
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        const int x0 = (quadrant & 1) * half;
+        const int z0 = (quadrant >> 1) * half;
+        for (int z = z0; z < z0 + half; ++z) {
+            for (int x = x0; x < x0 + half; ++x) {
+                // Mismo orden que TerrainMesh::buildChunkIndices
+                const GLushort topLeft = static_cast<GLushort>(z * side + x);
+                const GLushort topRight = static_cast<GLushort>(topLeft + 1);
+                const GLushort bottomLeft = static_cast<GLushort>((z + 1) * side + x);
+                const GLushort bottomRight = static_cast<GLushort>(bottomLeft + 1);
+                patchIndices.insert(patchIndices.end(), { topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight });
+            }
+        }
+    }
+    patchIndexCount = static_cast<int>(patchIndices.size());
+    patchQuarterIndexCount = patchIndexCount / 4;
+
+    patchVAO = new QOpenGLVertexArrayObject(this);
+    patchVAO->create();
+    patchVAO->bind();
+
+    patchVBO = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    patchVBO->create();
+    patchVBO->bind();
+    patchVBO->allocate(grid.data(), static_cast<int>(grid.size() * sizeof(GLushort)));
+
+    heightShader->bind();
+    heightShader->enableAttributeArray(0);
+    // setAttributeBuffer() normaliza los enteros: las coordenadas de la
+    // rejilla tienen que llegar tal cual
+    glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, 2 * sizeof(GLushort), nullptr);
+
+    // Nodos a dibujar, uno por instancia (ver drawDisplacedTerrain)
+    patchInstanceVBO = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    patchInstanceVBO->setUsagePattern(QOpenGLBuffer::StreamDraw);
+    patchInstanceVBO->create();
+    patchInstanceVBO->bind();
+    heightShader->enableAttributeArray(1);
+    heightShader->setAttributeBuffer(1, GL_FLOAT, 0, 4, 4 * sizeof(float));
+    context()->extraFunctions()->glVertexAttribDivisor(1, 1);
+
+    patchEBO = new QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    patchEBO->create();
+    patchEBO->bind();
+    patchEBO->allocate(patchIndices.data(), static_cast<int>(patchIndices.size() * sizeof(GLushort)));
+
+    patchVAO->release();
+    patchInstanceVBO->release();
+    heightShader->release();
+}
+
+bool OpenGLWidget::prepareHeightTexture()
+{
+    if (!heightShader || !patchVAO || !patchInstanceVBO) return false;
+
+    if (heightTextureDirty) {
+        heightTextureDirty = false;
+        pendingHeightUpload = QRect();
+
+        GLint maxSide = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSide);
+        if (mapWidth > maxSide || mapHeight > maxSide) return false;
+
+        // 8 bits bastan para mapas de 8 bits; el resto se sube en 16
+        const bool wide = heightMapData.format() != HeightFormat::U8;
+        const QOpenGLTexture::TextureFormat format = wide ? QOpenGLTexture::R16_UNorm : QOpenGLTexture::R8_UNorm;
+        if (!heightTexture || heightTexture->format() != format
+            || heightTexture->width() != mapWidth || heightTexture->height() != mapHeight) {
+            delete heightTexture;
+            heightTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+            heightTexture->setFormat(format);
+            heightTexture->setSize(mapWidth, mapHeight);
+            heightTexture->setMipLevels(1);
+            // Lineal: los vértices en transición caen entre muestras
+            heightTexture->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+            heightTexture->setWrapMode(QOpenGLTexture::ClampToEdge);
+            heightTexture->allocateStorage(QOpenGLTexture::Red, wide ? QOpenGLTexture::UInt16 : QOpenGLTexture::UInt8);
+            if (!heightTexture->isStorageAllocated()) {
+                delete heightTexture;
+                heightTexture = nullptr;
+                return false;
+            }
+        }
+        pendingHeightUpload = QRect(0, 0, mapWidth, mapHeight);
+    }
+
+    uploadPendingHeights();
+    return heightTexture != nullptr;
+}
+
+void OpenGLWidget::uploadPendingHeights()
+{
+    if (!heightTexture || pendingHeightUpload.isEmpty()) return;
+    const QRect area = pendingHeightUpload & QRect(0, 0, mapWidth, mapHeight);
+    pendingHeightUpload = QRect();
+    if (area.isEmpty()) return;
+
+    QOpenGLPixelTransferOptions options;
+    options.setAlignment(1);
+
+    if (heightMapData.format() != HeightFormat::F32) {
+        // Las filas del mapa ya tienen el formato de la textura
+        const bool wide = heightMapData.format() == HeightFormat::U16;
+        const int bps = heightMapData.bytesPerSample();
+        options.setRowLength(static_cast<int>(heightMapData.stride() / bps));
+        heightTexture->setData(area.x(), area.y(), 0, area.width(), area.height(), 1, QOpenGLTexture::Red,
+                               wide ? QOpenGLTexture::UInt16 : QOpenGLTexture::UInt8,
+                               heightMapData.rowBytes(area.y()) + static_cast<size_t>(area.x()) * bps, &options);
+        return;
+    }
+
+    // Float: se convierte a 16 bits
+    HeightField band(area.width(), area.height(), HeightFormat::U16);
+    band.copyRegion(heightMapData, area.x(), area.y(), area.width(), area.height(), 0, 0);
+    options.setRowLength(static_cast<int>(band.stride() / band.bytesPerSample()));
+    heightTexture->setData(area.x(), area.y(), 0, area.width(), area.height(), 1, QOpenGLTexture::Red,
+                           QOpenGLTexture::UInt16, band.data(), &options);
+}
+
+int OpenGLWidget::drawDisplacedTerrain(const QMatrix4x4 &mvp, const QVector3D &camera)
+{
+    const std::vector<float> ranges = TerrainMesh::lodRanges(lodPyramid, lodError, height(), 45.0f);
+    TerrainMesh::selectLod(lodPyramid, mvp, camera, ranges, lodNodes);
+    if (lodNodes.empty()) return 0;
+
+    // Una instancia por nodo (x, y, muestras entre vértices, nivel): los
+    // completos primero y después los quarter
+    std::vector<float> instances;
+    instances.reserve(lodNodes.size() * 4);
+    int fullNodes = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (const TerrainMesh::LodNode &node : lodNodes) {
+            if (node.quarter != (pass == 1)) continue;
+            instances.insert(instances.end(), { static_cast<float>(node.x), static_cast<float>(node.y),
+                                                static_cast<float>(1 << node.level), static_cast<float>(node.level) });
+            if (pass == 0) ++fullNodes;
+        }
+    }
+    const int quarterNodes = static_cast<int>(lodNodes.size()) - fullNodes;
+    patchInstanceVBO->bind();
+    patchInstanceVBO->allocate(instances.data(), static_cast<int>(instances.size() * sizeof(float)));
+    patchInstanceVBO->release();
+
+    // Transición de cada nivel en su último 30 %; el último nivel no
+    // tiene a cuál pasar
+    QVector2D morphRanges[TerrainMesh::MaxLodLevels];
+    for (size_t level = 0; level < ranges.size(); ++level) {
+        const float start = level > 0 ? ranges[level - 1] : 0.0f;
+        morphRanges[level] = QVector2D(ranges[level] - (ranges[level] - start) * 0.3f, ranges[level]);
+    }
+    if (!ranges.empty()) {
+        morphRanges[ranges.size() - 1] = QVector2D(1e30f, 2e30f);
+    }
+
+    heightShader->bind();
+    heightShader->setUniformValue("mvpMatrix", mvp);
+    heightShader->setUniformValue("mapWidth", mapWidth);
+    heightShader->setUniformValue("mapHeight", mapHeight);
+    // Misma escala que la malla: nivel 255 = altura 100
+    heightShader->setUniformValue("heightScale", 100.0f);
+    heightShader->setUniformValue("cameraPos", camera);
+    heightShader->setUniformValueArray("morphRanges", morphRanges, TerrainMesh::MaxLodLevels);
+    heightShader->setUniformValue("useTexture", useTexture && terrainTexture);
+
+    heightTexture->bind(1);
+    heightShader->setUniformValue("heightSampler", 1);
+    if (useTexture && terrainTexture) {
+        terrainTexture->bind(0);
+        heightShader->setUniformValue("textureSampler", 0);
+    }
+
+    QOpenGLExtraFunctions *gl = context()->extraFunctions();
+    patchVAO->bind();
+    if (fullNodes > 0) {
+        gl->glDrawElementsInstanced(GL_TRIANGLES, patchIndexCount, GL_UNSIGNED_SHORT, nullptr, fullNodes);
+    }
+    if (quarterNodes > 0) {
+        // Mismo búfer desde el primer quarter
+        patchInstanceVBO->bind();
+        heightShader->setAttributeBuffer(1, GL_FLOAT, fullNodes * 4 * sizeof(float), 4, 4 * sizeof(float));
+        gl->glDrawElementsInstanced(GL_TRIANGLES, patchQuarterIndexCount, GL_UNSIGNED_SHORT, nullptr, quarterNodes);
+        heightShader->setAttributeBuffer(1, GL_FLOAT, 0, 4, 4 * sizeof(float));
+        patchInstanceVBO->release();
+    }
+    patchVAO->release();
+
+    if (useTexture && terrainTexture) {
+        terrainTexture->release(0);
+    }
+    heightTexture->release(1);
+    heightShader->release();
+
+    return (fullNodes * patchIndexCount + quarterNodes * patchQuarterIndexCount) / 3;
+}
+
+int OpenGLWidget::drawMeshTerrain(const QMatrix4x4 &mvp)
+{
+    size_t drawn = 0;
+    terrainShader->bind();
+    terrainShader->setUniformValue("mvpMatrix", mvp);
+    terrainShader->setUniformValue("useTexture", useTexture);
+    terrainShader->setUniformValue("mapSize", QVector2D(mapWidth, mapHeight));
+
+    if (useTexture && terrainTexture) {
+        terrainTexture->bind(0);
+        terrainShader->setUniformValue("textureSampler", 0);
+    }
+
+    // Un bloque de vértices por trozo: los mismos índices desde el
+    // primer vértice de cada trozo visible
+    QOpenGLExtraFunctions *gl = context()->extraFunctions();
+    terrainVAO->bind();
+    for (int index : visibleChunks) {
+        const TerrainMesh::Chunk &chunk = chunks[index];
+        terrainShader->setUniformValue("chunkOrigin", QVector2D(chunk.cells.left(), chunk.cells.top()));
+        gl->glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_SHORT,
+                                     nullptr, index * TerrainMesh::ChunkVertices);
+        drawn += static_cast<size_t>(chunk.cells.width()) * chunk.cells.height() * 6;
+    }
+    terrainVAO->release();
+
+    if (useTexture && terrainTexture) {
+        terrainTexture->release();
+    }
+    terrainShader->release();
+    return static_cast<int>(drawn / 3);
+}
+
 QVector3D OpenGLWidget::screenToWorld(const QPoint &screenPos)
 {
     // Normalizar coordenadas de pantalla a NDC (-1 a 1)
@@ -1020,8 +1317,11 @@ void OpenGLWidget::setColorAtPosition(int x, int y, const QColor &color)
         }
     }
 
-    // Establecer el color en la posición especificada
+    // Establecer el color en la posición especificada. Sólo los que
+    // cambian cuentan para updateMesh() (deshacer repasa el mapa entero).
+    if (colorMap[y][x] == color) return;
     colorMap[y][x] = color;
+    dirtyRegion |= QRect(x, y, 1, 1);
 }
 
 QImage OpenGLWidget::generateColorMapImage() const
@@ -1039,7 +1339,7 @@ QImage OpenGLWidget::generateColorMapImage() const
                 image.setPixel(x, y, colorMap[y][x].rgb());
             } else {
                 // Usar color basado en altura (escala de grises)
-                unsigned char height = heightMapData[y][x];
+                int height = qRound(heightMapData.level(x, y));
                 image.setPixel(x, y, qRgb(height, height, height));
             }
         }
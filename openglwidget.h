@@ -10,7 +10,10 @@
 #include <QMatrix4x4>
 #include <QVector3D>
 #include <QPainter>
+#include <QRect>
 #include <vector>
+#include "heightfield.h"
+#include "terrainmesh.h"
 
 class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
@@ -20,7 +23,7 @@ public:
     explicit OpenGLWidget(QWidget *parent = nullptr);
     ~OpenGLWidget();
 
-    void setHeightMapData(const std::vector<std::vector<unsigned char>>& data);
+    void setHeightMapData(const HeightField& data);
     void loadTexture(const QString &path);
     void loadWaterTexture(const QString &path);
     void setWaterLevel(float level);
@@ -33,12 +36,46 @@ public:
     void setCurrentPaintColor(const QColor &color);
     void setColorAtPosition(int x, int y, const QColor &color);
     void generateMesh();
+    // Actualiza sólo los vértices de las muestras cambiadas con
+    // setColorAtPosition() desde la última llamada; se suben a la GPU en
+    // el próximo frame sin tocar los índices. Sin malla previa hace
+    // generateMesh().
+    void updateMesh();
     QImage generateColorMapImage() const;
+
+    // Relieve en GPU: el mapa se sube como textura R8/R16 y una rejilla
+    // compartida se desplaza en el vertex shader (terrain_height.vert),
+    // que también calcula normales y colores por altura. No hay malla en
+    // CPU, así que editar alturas es subir una subtextura. Los colores
+    // pintados van por vértice: en modo pintura se usa la malla.
+    void setHeightDisplacement(bool enabled);
+    bool heightDisplacement() const { return displacementEnabled; }
+    // Copia patch en (x, y) del mapa y actualiza sólo esa zona (textura
+    // o vértices, según el modo). El agua no se recalcula: updateWater().
+    void updateHeightRegion(const HeightField &patch, int x, int y);
+    void updateWater();
+
+    // El terreno se dibuja por trozos (TerrainMesh::Chunk) y cada frame
+    // se descartan los que quedan fuera del frustum de la cámara
+    int visibleChunkCount() const { return visibleChunkTotal; }
+    int culledChunkCount() const { return static_cast<int>(chunks.size()) - visibleChunkTotal; }
+
+    // Con relieve en GPU el detalle baja con la distancia (CDLOD, ver
+    // TerrainMesh::selectLod) mientras la celda de cada nodo no pase de
+    // pixels píxeles en pantalla; más error, menos triángulos
+    void setLodPixelError(float pixels);
+    float lodPixelError() const { return lodError; }
     bool showWater = true;
     float waterLevel = 50.0f;
     bool colorMapValid = !colorMap.empty() &&
                          colorMap.size() == static_cast<size_t>(mapHeight);
 
+signals:
+    // Al cambiar cuántos trozos se dibujan
+    void chunkVisibilityChanged(int visible, int culled);
+    // Al cambiar los triángulos del terreno por frame
+    void triangleCountChanged(int triangles);
+
 protected:
     void initializeGL() override;
     void resizeGL(int w, int h) override;
@@ -57,11 +94,29 @@ private:
     void setupTerrainBuffers();
     void setupWaterBuffers();
     void applyTextureBrush(const QPoint &screenPos);  // NUEVO
+    void uploadPendingVertices();
+    // Relieve en GPU
+    void setupPatchBuffers();
+    // Crea la textura si hace falta y sube lo pendiente; false si el
+    // modo no está disponible (sin shader o mapa mayor que el driver)
+    bool prepareHeightTexture();
+    void uploadPendingHeights();
+    // Devuelven los triángulos dibujados
+    int drawDisplacedTerrain(const QMatrix4x4 &mvp, const QVector3D &camera);
+    int drawMeshTerrain(const QMatrix4x4 &mvp);
+    void releaseMeshBuffers();
     QVector3D screenToWorld(const QPoint &screenPos);
     // Datos del heightmap
-    std::vector<std::vector<unsigned char>> heightMapData;
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
+    HeightField heightMapData;
+    std::vector<TerrainMesh::Vertex> vertices;     // Un bloque por trozo
+    std::vector<quint16> indices;                   // Los de un trozo
+    QRect dirtyRegion;      // Muestras cambiadas y sin pasar a vertices
+    QRect pendingUpload;    // Vértices actualizados en CPU y sin subir
+    std::vector<TerrainMesh::Chunk> chunks;
+    std::vector<int> visibleChunks;     // Del último frame, en orden
+    int visibleChunkTotal = 0;
+    size_t reportedChunks = 0;          // Total en la última señal
+    int triangleTotal = 0;
 
     int mapWidth = 0;
     int mapHeight = 0;
@@ -111,6 +166,23 @@ private:
     QOpenGLBuffer *terrainEBO = nullptr;
     QOpenGLVertexArrayObject *terrainVAO = nullptr;
 
+    // Relieve en GPU: textura de alturas, rejilla de un nodo y los nodos
+    // a dibujar (uno por instancia)
+    bool displacementEnabled = false;
+    QOpenGLShaderProgram *heightShader = nullptr;
+    QOpenGLTexture *heightTexture = nullptr;
+    QOpenGLBuffer *patchVBO = nullptr;
+    QOpenGLBuffer *patchEBO = nullptr;
+    QOpenGLBuffer *patchInstanceVBO = nullptr;
+    QOpenGLVertexArrayObject *patchVAO = nullptr;
+    int patchIndexCount = 0;
+    int patchQuarterIndexCount = 0;     // Primer cuadrante de la rejilla
+    TerrainMesh::LodPyramid lodPyramid;
+    std::vector<TerrainMesh::LodNode> lodNodes;
+    float lodError = 2.0f;              // Píxeles
+    bool heightTextureDirty = true;     // Recrear (mapa nuevo)
+    QRect pendingHeightUpload;          // Zona del mapa por subir
+
     // Buffers para agua
     QOpenGLBuffer *waterVBO = nullptr;
     QOpenGLBuffer *waterEBO = nullptr;
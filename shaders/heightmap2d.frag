@@ -0,0 +1,39 @@
+#version 330 core
+
+in vec2 fragTexCoord;
+
+uniform sampler2D heightSampler;    // Altura normalizada en el canal rojo
+uniform int shading;                // 0 gris, 1 falso color, 2 sombreado
+uniform vec2 texelSize;
+uniform float reliefScale;          // Altura (unidades de la vista 3D) por texel de distancia
+
+out vec4 finalColor;
+
+// Mismas franjas que la malla de la vista 3D (altura 0..100)
+vec3 heightColor(float h) {
+    if (h < 0.2) return vec3(0.2, 0.4, 0.8);
+    if (h < 0.4) return vec3(0.76, 0.7, 0.5);
+    if (h < 0.6) return vec3(0.2, 0.6, 0.2);
+    if (h < 0.8) return vec3(0.5, 0.5, 0.5);
+    return vec3(1.0);
+}
+
+void main() {
+    float h = texture(heightSampler, fragTexCoord).r;
+
+    if (shading == 1) {
+        finalColor = vec4(heightColor(h), 1.0);
+    } else if (shading == 2) {
+        // Normal por diferencias centrales, luz desde el noroeste a 45 grados
+        float left = texture(heightSampler, fragTexCoord - vec2(texelSize.x, 0.0)).r;
+        float right = texture(heightSampler, fragTexCoord + vec2(texelSize.x, 0.0)).r;
+        float up = texture(heightSampler, fragTexCoord - vec2(0.0, texelSize.y)).r;
+        float down = texture(heightSampler, fragTexCoord + vec2(0.0, texelSize.y)).r;
+        vec3 normal = normalize(vec3((left - right) * reliefScale, (up - down) * reliefScale, 1.0));
+        vec3 light = normalize(vec3(-1.0, -1.0, 1.41421356));
+        float shade = max(dot(normal, light), 0.0);
+        finalColor = vec4(vec3(shade), 1.0);
+    } else {
+        finalColor = vec4(vec3(h), 1.0);
+    }
+}
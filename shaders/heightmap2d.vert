@@ -0,0 +1,20 @@
+#version 330 core
+
+// Esquina del rectángulo del mapa, de (0, 0) a (1, 1)
+layout(location = 0) in vec2 corner;
+
+uniform vec2 mapSize;       // Muestras del mapa
+uniform vec2 viewSize;      // Píxeles del widget
+uniform vec2 origin;        // Punto del mapa en la esquina superior izquierda
+uniform float zoom;         // Píxeles por muestra
+uniform vec2 texelScale;    // Coordenada de textura por muestra del mapa
+
+out vec2 fragTexCoord;
+
+void main() {
+    vec2 mapPos = corner * mapSize;
+    vec2 widgetPos = (mapPos - origin) * zoom;
+    vec2 ndc = widgetPos / viewSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    fragTexCoord = mapPos * texelScale;
+}
@@ -1,17 +1,31 @@
-#version 330 core  
-  
-layout(location = 0) in vec3 position;  
-layout(location = 1) in vec3 color;  
-layout(location = 2) in vec2 texCoord;  
-  
-uniform mat4 mvpMatrix;  
-uniform bool useTexture;  
-  
-out vec3 fragColor;  
-out vec2 fragTexCoord;  
-  
-void main() {  
-    gl_Position = mvpMatrix * vec4(position, 1.0);  
-    fragColor = color;  
-    fragTexCoord = texCoord;  
+#version 330 core
+
+// TerrainMesh::Vertex: muestra dentro del trozo, nivel normalizado y
+// color pintado (a = 0: color por altura)
+layout(location = 0) in vec2 gridPos;
+layout(location = 1) in float height;
+layout(location = 2) in vec4 color;
+
+uniform mat4 mvpMatrix;
+uniform bool useTexture;
+uniform vec2 chunkOrigin;   // Primera muestra del trozo
+uniform vec2 mapSize;       // Muestras del mapa
+
+out vec3 fragColor;
+out vec2 fragTexCoord;
+
+// Mismas franjas que antes en CPU (altura 0..100)
+vec3 heightColor(float h) {
+    if (h < 0.2) return vec3(0.2, 0.4, 0.8);
+    if (h < 0.4) return vec3(0.76, 0.7, 0.5);
+    if (h < 0.6) return vec3(0.2, 0.6, 0.2);
+    if (h < 0.8) return vec3(0.5, 0.5, 0.5);
+    return vec3(1.0);
+}
+
+void main() {
+    vec2 pos = chunkOrigin + gridPos;
+    gl_Position = mvpMatrix * vec4(pos.x, height * 100.0, pos.y, 1.0);
+    fragColor = color.a > 0.5 ? color.rgb : heightColor(height);
+    fragTexCoord = pos / mapSize;
 }
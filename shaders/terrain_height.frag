@@ -0,0 +1,29 @@
+#version 330 core
+
+in float fragHeight;
+in vec3 fragNormal;
+in vec2 fragTexCoord;
+
+uniform bool useTexture;
+uniform sampler2D textureSampler;
+
+out vec4 finalColor;
+
+// Mismas franjas que la malla de la vista 3D (altura 0..100)
+vec3 heightColor(float h) {
+    if (h < 0.2) return vec3(0.2, 0.4, 0.8);
+    if (h < 0.4) return vec3(0.76, 0.7, 0.5);
+    if (h < 0.6) return vec3(0.2, 0.6, 0.2);
+    if (h < 0.8) return vec3(0.5, 0.5, 0.5);
+    return vec3(1.0);
+}
+
+void main() {
+    vec3 base = useTexture ? texture(textureSampler, fragTexCoord).rgb : heightColor(fragHeight);
+
+    // Luz difusa desde arriba y el noroeste, con ambiente para que las
+    // laderas en sombra no queden negras
+    vec3 light = normalize(vec3(-1.0, 1.5, -1.0));
+    float diffuse = max(dot(normalize(fragNormal), light), 0.0);
+    finalColor = vec4(base * (0.45 + 0.55 * diffuse), 1.0);
+}
@@ -0,0 +1,53 @@
+#version 330 core
+
+// Vértice de la rejilla compartida, en vértices dentro del nodo
+layout(location = 0) in vec2 gridPos;
+// Nodo (una instancia): primera celda, muestras entre vértices y nivel
+layout(location = 1) in vec4 patchNode;
+
+uniform mat4 mvpMatrix;
+uniform sampler2D heightSampler;    // Nivel normalizado en el canal rojo (filtro lineal)
+uniform int mapWidth;               // Muestras del mapa
+uniform int mapHeight;
+uniform float heightScale;          // Altura de la vista para el nivel máximo
+uniform vec3 cameraPos;             // En coordenadas de la malla
+// Por nivel: distancia a la que empieza y termina el paso al siguiente
+uniform vec2 morphRanges[16];
+
+out float fragHeight;
+out vec3 fragNormal;
+out vec2 fragTexCoord;
+
+// Altura en una posición (en muestras) que puede caer entre muestras
+float heightAt(vec2 pos) {
+    return texture(heightSampler, (pos + 0.5) / vec2(mapWidth, mapHeight)).r;
+}
+
+void main() {
+    vec2 mapMax = vec2(mapWidth - 1, mapHeight - 1);
+    vec2 origin = patchNode.xy;
+    float spacing = patchNode.z;
+
+    // Los nodos del borde se salen del mapa: esos vértices se pegan al
+    // último y sus triángulos quedan sin área
+    vec2 pos = min(origin + gridPos * spacing, mapMax);
+    float dist = distance(cameraPos, vec3(pos.x, heightAt(pos) * heightScale, pos.y));
+
+    // Cerca del final de su rango, los vértices impares se mueven hacia
+    // el par anterior: al llegar al final la rejilla es la del nivel
+    // siguiente y el borde con él coincide
+    vec2 range = morphRanges[int(patchNode.w)];
+    float morph = clamp((dist - range.x) / (range.y - range.x), 0.0, 1.0);
+    vec2 odd = fract(gridPos * 0.5) * 2.0;
+    pos = min(origin + (gridPos - odd * morph) * spacing, mapMax);
+    float h = heightAt(pos);
+
+    // Normal por diferencias centrales a la escala del nodo
+    float dx = (heightAt(pos + vec2(spacing, 0.0)) - heightAt(pos - vec2(spacing, 0.0))) * heightScale;
+    float dz = (heightAt(pos + vec2(0.0, spacing)) - heightAt(pos - vec2(0.0, spacing))) * heightScale;
+    fragNormal = normalize(vec3(-dx, 2.0 * spacing, -dz));
+
+    fragHeight = h;
+    fragTexCoord = pos / vec2(mapWidth, mapHeight);
+    gl_Position = mvpMatrix * vec4(pos.x, h * heightScale, pos.y, 1.0);
+}
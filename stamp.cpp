@@ -0,0 +1,60 @@
+#include "stamp.h"
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+// Máscaras distintas que se guardan como mucho; al superarlo se vacía
+// la caché (las que estén en uso siguen vivas por su shared_ptr)
+const std::size_t MaxCachedMasks = 64;
+
+} // namespace
+
+FalloffMask::FalloffMask(int radius, double hardness)
+    : m_radius(std::max(1, radius)),
+      m_hardness(std::clamp(hardness, 0.0, 1.0))
+{
+    const int side = 2 * m_radius + 1;
+    const double radiusSq = static_cast<double>(m_radius) * m_radius;
+    m_weights.assign(static_cast<std::size_t>(side) * side, 0.0f);
+    m_extents.assign(side, 0);
+
+    for (int dy = -m_radius; dy <= m_radius; ++dy) {
+        float *weights = m_weights.data() + static_cast<std::size_t>(dy + m_radius) * side;
+        int extent = 0;
+        for (int dx = -m_radius; dx <= m_radius; ++dx) {
+            const double distSq = static_cast<double>(dx) * dx + static_cast<double>(dy) * dy;
+            if (distSq > radiusSq) continue;
+
+            extent = std::max(extent, std::abs(dx));
+            double weight = 1.0;
+            if (m_hardness < 1.0) {
+                // Distancia normalizada fuera del núcleo duro
+                const double t = std::max(0.0, (std::sqrt(distSq / radiusSq) - m_hardness) / (1.0 - m_hardness));
+                weight = 1.0 - t * t;
+            }
+            weights[dx + m_radius] = static_cast<float>(weight);
+        }
+        m_extents[dy + m_radius] = extent;
+    }
+}
+
+std::shared_ptr<const FalloffMask> FalloffMask::get(int radius, double hardness)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<int, int>, std::shared_ptr<const FalloffMask>> cache;
+
+    radius = std::max(1, radius);
+    const int hardnessKey = static_cast<int>(std::lround(std::clamp(hardness, 0.0, 1.0) * 100.0));
+    const std::pair<int, int> key(radius, hardnessKey);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+
+    if (cache.size() >= MaxCachedMasks) cache.clear();
+    auto mask = std::make_shared<const FalloffMask>(radius, hardnessKey / 100.0);
+    cache.emplace(key, mask);
+    return mask;
+}
@@ -0,0 +1,123 @@
+#ifndef STAMP_H
+#define STAMP_H
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "tiledheightfield.h"
+
+// =================================================================
+// === STAMP ENGINE
+// =================================================================
+// Motor común de los pinceles: una máscara de caída precalculada por
+// radio y dureza, un único bucle que aplica máscara x operación sobre
+// los tiles bajo la pincelada, y el reparto de pinceladas a lo largo
+// del trazo entre dos eventos del ratón.
+
+// Pesos de un pincel circular de radio r en una rejilla (2r+1)².
+// Con dureza h, el peso es 1 hasta h * r y después cae como 1 - t²
+// (t = distancia normalizada tras el núcleo duro); con h = 0 es la
+// caída 1 - d² / r² de siempre.
+class FalloffMask
+{
+public:
+    FalloffMask(int radius, double hardness);
+
+    int radius() const { return m_radius; }
+    double hardness() const { return m_hardness; }
+
+    // Fila dy (-r..r), indexada por dx + r
+    const float *row(int dy) const
+    {
+        return m_weights.data() + static_cast<std::size_t>(dy + m_radius) * (2 * m_radius + 1);
+    }
+    // Las columnas con peso de la fila dy van de -extent a +extent
+    int rowExtent(int dy) const { return m_extents[dy + m_radius]; }
+
+    // Máscara compartida: cada radio/dureza (a pasos de 1/100) se
+    // calcula una sola vez. Se puede llamar desde cualquier hilo.
+    static std::shared_ptr<const FalloffMask> get(int radius, double hardness = 0.0);
+
+private:
+    int m_radius;
+    double m_hardness;
+    std::vector<float> m_weights;
+    std::vector<int> m_extents;
+};
+
+// Aplica una pincelada centrada en (centerX, centerY): llama a
+// f(int x, int y, T &value, float weight) para cada muestra del mapa
+// con peso de la máscara. Recorre sólo los tiles bajo la pincelada;
+// el centro puede estar fuera del mapa.
+template <typename T, typename F>
+void stampMask(TiledHeightField &field, int centerX, int centerY, const FalloffMask &mask, F &&f)
+{
+    const int radius = mask.radius();
+    const int minX = std::max(0, centerX - radius);
+    const int maxX = std::min(field.width() - 1, centerX + radius);
+    const int minY = std::max(0, centerY - radius);
+    const int maxY = std::min(field.height() - 1, centerY + radius);
+    if (minX > maxX || minY > maxY) return;
+
+    field.forEachSpan<T>(minX, minY, maxX + 1, maxY + 1, [&](int y, int spanX, T *span, int count) {
+        const int dy = y - centerY;
+        const int extent = mask.rowExtent(dy);
+        const int x0 = std::max(spanX, centerX - extent);
+        const int x1 = std::min(spanX + count - 1, centerX + extent);
+
+        // weights[x] es el peso de la columna x del mapa
+        const float *weights = mask.row(dy) + radius - centerX;
+        T *values = span - spanX;
+        for (int x = x0; x <= x1; ++x) {
+            f(x, y, values[x], weights[x]);
+        }
+    });
+}
+
+// Reparte pinceladas cada `spacing` muestras a lo largo del trazo,
+// interpolando entre posiciones sucesivas del ratón: un arrastre rápido
+// no deja huecos y uno lento no acumula pinceladas de más.
+class StrokeInterpolator
+{
+public:
+    // Primera pincelada del trazo, en (x, y)
+    template <typename F>
+    void begin(double x, double y, double spacing, F &&dab)
+    {
+        m_lastX = x;
+        m_lastY = y;
+        m_spacing = std::max(1.0, spacing);
+        m_travelled = 0.0;
+        dab(static_cast<int>(std::lround(x)), static_cast<int>(std::lround(y)));
+    }
+
+    // Continúa el trazo hasta (x, y): dab(int x, int y) en cada punto
+    // que dista `spacing` del anterior
+    template <typename F>
+    void moveTo(double x, double y, F &&dab)
+    {
+        const double dx = x - m_lastX;
+        const double dy = y - m_lastY;
+        const double length = std::sqrt(dx * dx + dy * dy);
+
+        double t = m_spacing - m_travelled;
+        while (t <= length) {
+            const double f = t / length;
+            dab(static_cast<int>(std::lround(m_lastX + dx * f)), static_cast<int>(std::lround(m_lastY + dy * f)));
+            t += m_spacing;
+        }
+        m_travelled = length - (t - m_spacing);
+
+        m_lastX = x;
+        m_lastY = y;
+    }
+
+private:
+    double m_lastX = 0.0;
+    double m_lastY = 0.0;
+    double m_spacing = 1.0;
+    double m_travelled = 0.0;   // Distancia recorrida desde la última pincelada
+};
+
+#endif // STAMP_H
@@ -0,0 +1,466 @@
+#include "terrainio.h"
+#include <QBuffer>
+#include <QFile>
+#include <QTextStream>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace TerrainIO {
+
+// =================================================================
+// === PNG
+// =================================================================
+
+static HeightFormat pngFormatFor(const TiledHeightField &field)
+{
+    return field.format() == HeightFormat::U8 ? HeightFormat::U8 : HeightFormat::U16;
+}
+
+bool fitsInPng(const TiledHeightField &field)
+{
+    return static_cast<qint64>(field.width()) * field.height() * bytesPerSample(pngFormatFor(field)) <= MaxImageBytes;
+}
+
+bool savePng(const TiledHeightField &field, const QString &fileName)
+{
+    if (field.empty() || !fitsInPng(field)) return false;
+
+    const HeightFormat pngFormat = pngFormatFor(field);
+    QImage image(field.width(), field.height(),
+                 pngFormat == HeightFormat::U8 ? QImage::Format_Grayscale8 : QImage::Format_Grayscale16);
+    if (image.isNull()) return false;
+
+    HeightField band;
+    for (int bandY = 0; bandY < field.height(); bandY += TiledHeightField::TileSize) {
+        band.assign(field.width(), std::min(TiledHeightField::TileSize, field.height() - bandY), pngFormat, 0);
+        field.readRegion(0, bandY, band);
+        for (int y = 0; y < band.height(); ++y) {
+            std::memcpy(image.scanLine(bandY + y), band.rowBytes(y), band.rowSizeInBytes());
+        }
+    }
+    return image.save(fileName, "PNG");
+}
+
+// =================================================================
+// === MALLAS
+// =================================================================
+
+bool exportObj(const TiledHeightField &field, const QString &fileName, qint64 *vertexCount)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    QTextStream out(&file);
+    const int mapWidth = field.width();
+    const int mapHeight = field.height();
+
+    // Alturas en escala de nivel (0-255) con la precisión del mapa
+    std::vector<float> levelRow0(mapWidth);
+    std::vector<float> levelRow1(mapWidth);
+
+    // Índice del primer vértice de cada fila: los índices de una fila
+    // se recalculan a partir de sus alturas en lugar de guardar un
+    // mapa completo de índices (no cabría en memoria en mapas grandes)
+    std::vector<qint64> rowStart(mapHeight);
+    qint64 vertexIndex = 1; // OBJ usa índices 1-based
+
+    // Escribir solo vértices con altura > umbral
+    for (int y = 0; y < mapHeight; ++y) {
+        field.rowToLevels(y, levelRow0.data());
+        const float *src = levelRow0.data();
+        rowStart[y] = vertexIndex;
+        for (int x = 0; x < mapWidth; ++x) {
+            if (src[x] > ExportHeightThreshold) {
+                float height = src[x] / 255.0f * 100.0f;
+                out << "v " << x << " " << height << " " << y << "\n";
+                vertexIndex++;
+            }
+        }
+    }
+
+    // Índices de la fila y (-1 en las muestras no exportadas)
+    auto rowIndices = [&](int y, std::vector<float> &levels, std::vector<qint64> &indices) {
+        field.rowToLevels(y, levels.data());
+        qint64 index = rowStart[y];
+        for (int x = 0; x < mapWidth; ++x) {
+            indices[x] = levels[x] > ExportHeightThreshold ? index++ : -1;
+        }
+    };
+    std::vector<qint64> indexRow0(mapWidth);
+    std::vector<qint64> indexRow1(mapWidth);
+
+    // Escribir coordenadas de textura solo para vértices exportados
+    for (int y = 0; y < mapHeight; ++y) {
+        rowIndices(y, levelRow0, indexRow0);
+        for (int x = 0; x < mapWidth; ++x) {
+            if (indexRow0[x] != -1) {
+                out << "vt " << (float)x/mapWidth << " " << (float)y/mapHeight << "\n";
+            }
+        }
+    }
+
+    // Escribir caras solo si todos los vértices existen
+    if (mapHeight > 0) rowIndices(0, levelRow0, indexRow0);
+    for (int y = 0; y < mapHeight - 1; ++y) {
+        rowIndices(y + 1, levelRow1, indexRow1);
+        for (int x = 0; x < mapWidth - 1; ++x) {
+            qint64 topLeft = indexRow0[x];
+            qint64 topRight = indexRow0[x+1];
+            qint64 bottomLeft = indexRow1[x];
+            qint64 bottomRight = indexRow1[x+1];
+
+            if (topLeft != -1 && topRight != -1 && bottomLeft != -1 && bottomRight != -1) {
+                out << "f " << topLeft << "/" << topLeft << " "
+                    << bottomLeft << "/" << bottomLeft << " "
+                    << topRight << "/" << topRight << "\n";
+
+                out << "f " << topRight << "/" << topRight << " "
+                    << bottomLeft << "/" << bottomLeft << " "
+                    << bottomRight << "/" << bottomRight << "\n";
+            }
+        }
+        indexRow0.swap(indexRow1);
+    }
+
+    out.flush();
+    file.close();
+    if (vertexCount) *vertexCount = vertexIndex - 1;
+    return out.status() == QTextStream::Ok;
+}
+
+// Recorre las celdas con algún vértice por encima del umbral:
+// f(x, y, h1, h2, h3, h4) con las alturas ya en unidades de malla
+// (h1 = (x, y), h2 = (x+1, y), h3 = (x, y+1), h4 = (x+1, y+1))
+template <typename F>
+static void forEachExportedCell(const TiledHeightField &field, F &&f)
+{
+    const int mapWidth = field.width();
+    std::vector<float> levelRow0(mapWidth);
+    std::vector<float> levelRow1(mapWidth);
+
+    if (field.height() > 0) field.rowToLevels(0, levelRow1.data());
+    for (int y = 0; y < field.height() - 1; ++y) {
+        levelRow0.swap(levelRow1);
+        field.rowToLevels(y + 1, levelRow1.data());
+        const float *row0 = levelRow0.data();
+        const float *row1 = levelRow1.data();
+        for (int x = 0; x < mapWidth - 1; ++x) {
+            bool hasSignificantHeight =
+                row0[x] > ExportHeightThreshold ||
+                row0[x+1] > ExportHeightThreshold ||
+                row1[x] > ExportHeightThreshold ||
+                row1[x+1] > ExportHeightThreshold;
+
+            if (!hasSignificantHeight) continue;
+
+            f(x, y,
+              row0[x] / 255.0f * 100.0f, row0[x+1] / 255.0f * 100.0f,
+              row1[x] / 255.0f * 100.0f, row1[x+1] / 255.0f * 100.0f);
+        }
+    }
+}
+
+bool exportStl(const TiledHeightField &field, const QString &fileName, bool binary, qint64 *triangleCount)
+{
+    if (!binary) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+        QTextStream out(&file);
+        out << "solid heightmap\n";
+
+        qint64 triangles = 0;
+        forEachExportedCell(field, [&](int x, int y, float h1, float h2, float h3, float h4) {
+            // Primer triángulo
+            out << "  facet normal 0 1 0\n";
+            out << "    outer loop\n";
+            out << "      vertex " << x << " " << h1 << " " << y << "\n";
+            out << "      vertex " << x << " " << h3 << " " << (y+1) << "\n";
+            out << "      vertex " << (x+1) << " " << h2 << " " << y << "\n";
+            out << "    endloop\n";
+            out << "  endfacet\n";
+
+            // Segundo triángulo
+            out << "  facet normal 0 1 0\n";
+            out << "    outer loop\n";
+            out << "      vertex " << (x+1) << " " << h2 << " " << y << "\n";
+            out << "      vertex " << x << " " << h3 << " " << (y+1) << "\n";
+            out << "      vertex " << (x+1) << " " << h4 << " " << (y+1) << "\n";
+            out << "    endloop\n";
+            out << "  endfacet\n";
+            triangles += 2;
+        });
+
+        out << "endsolid heightmap\n";
+        out.flush();
+        file.close();
+        if (triangleCount) *triangleCount = triangles;
+        return out.status() == QTextStream::Ok;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    // Primero contar triángulos válidos (la cabecera lleva el total)
+    quint32 numTriangles = 0;
+    forEachExportedCell(field, [&](int, int, float, float, float, float) {
+        numTriangles += 2;
+    });
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    // Header (80 bytes)
+    QByteArray header(80, 0);
+    QString headerText = "HeightMapGen Binary STL Export (Filtered)";
+    header.replace(0, headerText.length(), headerText.toUtf8());
+    file.write(header);
+
+    // Número de triángulos
+    out << numTriangles;
+
+    forEachExportedCell(field, [&](int x, int y, float h1, float h2, float h3, float h4) {
+        // Primer triángulo
+        out << 0.0f << 1.0f << 0.0f;
+        out << (float)x << h1 << (float)y;
+        out << (float)x << h3 << (float)(y+1);
+        out << (float)(x+1) << h2 << (float)y;
+        out << (quint16)0;
+
+        // Segundo triángulo
+        out << 0.0f << 1.0f << 0.0f;
+        out << (float)(x+1) << h2 << (float)y;
+        out << (float)x << h3 << (float)(y+1);
+        out << (float)(x+1) << h4 << (float)(y+1);
+        out << (quint16)0;
+    });
+
+    file.close();
+    if (triangleCount) *triangleCount = numTriangles;
+    return out.status() == QDataStream::Ok;
+}
+
+// =================================================================
+// === IMPORTACIÓN
+// =================================================================
+
+ImportResult importMesh(const QString &fileName, HeightFormat format, TiledHeightField &field)
+{
+    const bool isOBJ = fileName.endsWith(".obj", Qt::CaseInsensitive);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return ImportResult::OpenFailed;
+
+    // Vértices "v x y z" (OBJ) o "vertex x y z" (STL de texto)
+    const QString prefix = isOBJ ? "v " : "vertex";
+    std::vector<float> vertices_x, vertices_y, vertices_z;
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.startsWith(prefix)) {
+            QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+            if (parts.size() >= 4) {
+                vertices_x.push_back(parts[1].toFloat());
+                vertices_y.push_back(parts[2].toFloat());
+                vertices_z.push_back(parts[3].toFloat());
+            }
+        }
+    }
+    file.close();
+
+    if (vertices_x.empty()) return ImportResult::NoVertices;
+
+    // Encontrar límites
+    float minX = *std::min_element(vertices_x.begin(), vertices_x.end());
+    float maxX = *std::max_element(vertices_x.begin(), vertices_x.end());
+    float minZ = *std::min_element(vertices_z.begin(), vertices_z.end());
+    float maxZ = *std::max_element(vertices_z.begin(), vertices_z.end());
+    float minY = *std::min_element(vertices_y.begin(), vertices_y.end());
+    float maxY = *std::max_element(vertices_y.begin(), vertices_y.end());
+
+    float rangeX = maxX - minX;
+    float rangeZ = maxZ - minZ;
+
+    // Dimensiones según el rango real, entre 16 y el máximo del mapa por tiles
+    const int maxSize = TiledHeightField::MaxSize;
+    const int width = std::clamp(static_cast<int>(std::ceil(rangeX)), 16, maxSize);
+    const int height = std::clamp(static_cast<int>(std::ceil(rangeZ)), 16, maxSize);
+
+    TiledHeightField imported(width, height, format, 0);
+
+    // Proyectar vértices al mapa
+    dispatchHeightFormat(format, [&](auto tag) {
+        using T = decltype(tag);
+        const float heightRange = static_cast<float>(HeightTraits<T>::maxValue);
+
+        for (size_t i = 0; i < vertices_x.size(); ++i) {
+            // Normalizar coordenadas X,Z al rango del mapa
+            int x = static_cast<int>((vertices_x[i] - minX) / rangeX * (width - 1));
+            int z = static_cast<int>((vertices_z[i] - minZ) / rangeZ * (height - 1));
+
+            // Normalizar altura Y al rango del formato
+            float normalizedY = (vertices_y[i] - minY) / (maxY - minY);
+            T heightValue = HeightTraits<T>::fromValue(normalizedY * heightRange);
+
+            // Tomar el valor máximo si hay varios vértices en la misma posición
+            if (x >= 0 && x < width && z >= 0 && z < height) {
+                T &value = imported.at<T>(x, z);
+                value = std::max(value, heightValue);
+            }
+        }
+    });
+
+    field.swap(imported);
+    return ImportResult::Ok;
+}
+
+// =================================================================
+// === HMT
+// =================================================================
+
+quint32 hmtVersionFor(HeightFormat format)
+{
+    return format == HeightFormat::U8 ? 1 : 2;
+}
+
+bool hmtFormatFromCode(quint32 code, HeightFormat &format)
+{
+    if (code > static_cast<quint32>(HeightFormat::F32)) return false;
+    format = static_cast<HeightFormat>(code);
+    return true;
+}
+
+// Las alturas se copian por bandas de una fila de tiles, así que el
+// mapa nunca está entero en memoria
+void writeHmtHeights(QDataStream &out, const TiledHeightField &field)
+{
+    HeightField band;
+    QByteArray rowData(field.width() * field.bytesPerSample(), 0);
+    for (int bandY = 0; bandY < field.height(); bandY += TiledHeightField::TileSize) {
+        band.assign(field.width(), std::min(TiledHeightField::TileSize, field.height() - bandY), field.format(), 0);
+        field.readRegion(0, bandY, band);
+
+        for (int y = 0; y < band.height(); ++y) {
+            const unsigned char *src = band.rowBytes(y);
+            switch (band.bytesPerSample()) {
+            case 2: qToLittleEndian<quint16>(src, band.width(), rowData.data()); break;
+            case 4: qToLittleEndian<quint32>(src, band.width(), rowData.data()); break;
+            default: std::memcpy(rowData.data(), src, rowData.size()); break;
+            }
+            out.writeRawData(rowData.constData(), rowData.size());
+        }
+    }
+}
+
+void readHmtHeights(QDataStream &in, TiledHeightField &field)
+{
+    HeightField band;
+    for (int bandY = 0; bandY < field.height(); bandY += TiledHeightField::TileSize) {
+        band.assign(field.width(), std::min(TiledHeightField::TileSize, field.height() - bandY), field.format(), 0);
+
+        for (int y = 0; y < band.height(); ++y) {
+            unsigned char *dst = band.rowBytes(y);
+            in.readRawData(reinterpret_cast<char*>(dst), static_cast<int>(band.rowSizeInBytes()));
+            switch (band.bytesPerSample()) {
+            case 2: qFromLittleEndian<quint16>(dst, band.width(), dst); break;
+            case 4: qFromLittleEndian<quint32>(dst, band.width(), dst); break;
+            default: break;
+            }
+        }
+        field.writeRegion(band, 0, bandY);
+    }
+}
+
+bool saveHmtProject(const TiledHeightField &field, const QImage &texture, const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    // Header
+    const quint32 version = hmtVersionFor(field.format());
+    out.writeRawData("HMT\0", 4);
+    out << version;
+    out << static_cast<quint32>(field.width());
+    out << static_cast<quint32>(field.height());
+    if (version >= 2) {
+        out << static_cast<quint32>(field.format());
+    }
+
+    // Heightmap (una fila por iteración, sin el relleno de alineación)
+    writeHmtHeights(out, field);
+
+    // Textura
+    QByteArray textureData;
+    QBuffer buffer(&textureData);
+    buffer.open(QIODevice::WriteOnly);
+    texture.save(&buffer, "PNG");
+    out << textureData;
+
+    file.close();
+    return out.status() == QDataStream::Ok;
+}
+
+bool loadHmtProject(const QString &fileName, TiledHeightField &field, QImage *texture)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    char magic[4];
+    if (in.readRawData(magic, 4) != 4 || std::memcmp(magic, "HMT\0", 4) != 0) return false;
+
+    quint32 version, width, height;
+    in >> version >> width >> height;
+
+    HeightFormat format = HeightFormat::U8;
+    if (version >= 2) {
+        quint32 formatCode;
+        in >> formatCode;
+        if (!hmtFormatFromCode(formatCode, format)) return false;
+    }
+
+    const quint32 maxSize = TiledHeightField::MaxSize;
+    if (in.status() != QDataStream::Ok || width < 16 || height < 16 || width > maxSize || height > maxSize) {
+        return false;
+    }
+
+    TiledHeightField loaded(static_cast<int>(width), static_cast<int>(height), format, 0);
+    readHmtHeights(in, loaded);
+
+    QByteArray textureData;
+    in >> textureData;
+    if (in.status() != QDataStream::Ok) return false;
+    if (texture) texture->loadFromData(textureData, "PNG");
+
+    field.swap(loaded);
+    return true;
+}
+
+QImage grayscaleImage(const TiledHeightField &field, int step)
+{
+    const int width = (field.width() + step - 1) / step;
+    const int height = (field.height() + step - 1) / step;
+    QImage image(width, height, QImage::Format_RGB32);
+
+    std::vector<unsigned char> src(width);
+    for (int y = 0; y < height; ++y) {
+        QRgb *pixel = reinterpret_cast<QRgb*>(image.scanLine(y));
+        field.rowToU8(y * step, src.data(), step);
+        for (int x = 0; x < width; ++x) {
+            pixel[x] = qRgb(src[x], src[x], src[x]);
+        }
+    }
+    return image;
+}
+
+} // namespace TerrainIO
@@ -0,0 +1,71 @@
+#ifndef TERRAINIO_H
+#define TERRAINIO_H
+
+#include <QDataStream>
+#include <QImage>
+#include <QString>
+#include "tiledheightfield.h"
+
+// =================================================================
+// === TERRAIN I/O
+// =================================================================
+// Guardado y exportación del mapa de alturas sin interfaz: los usan
+// tanto la ventana principal como el modo por línea de comandos.
+// Todas recorren el mapa por filas o bandas de tiles, así que valen
+// para mapas volcados a disco. Devuelven false si no se pudo escribir.
+
+namespace TerrainIO {
+
+// Alturas por debajo de este nivel (0-255) no se exportan a OBJ/STL
+constexpr float ExportHeightThreshold = 5.0f;
+
+// Límite de un QImage con el mapa completo (PNG, texturizado)
+constexpr qint64 MaxImageBytes = 256ll * 1024 * 1024;
+
+// === PNG ===
+// 8 bits en escala de grises, o 16 bits si el mapa tiene más precisión
+bool fitsInPng(const TiledHeightField &field);
+bool savePng(const TiledHeightField &field, const QString &fileName);
+
+// === MALLAS ===
+// Rejilla de una unidad por muestra y altura 0-100. En OBJ sólo se
+// escriben los vértices por encima del umbral y las caras completas;
+// en STL, los triángulos con algún vértice por encima.
+bool exportObj(const TiledHeightField &field, const QString &fileName, qint64 *vertexCount = nullptr);
+bool exportStl(const TiledHeightField &field, const QString &fileName, bool binary,
+               qint64 *triangleCount = nullptr);
+
+// === IMPORTACIÓN ===
+enum class ImportResult {
+    Ok,
+    OpenFailed,
+    NoVertices
+};
+
+// Proyecta los vértices de un OBJ o STL de texto sobre un mapa nuevo
+// del tamaño de su huella en XZ (16..MaxSize), guardando la mayor
+// altura Y de cada muestra. Sólo toca field si el resultado es Ok;
+// lanza std::runtime_error si no se puede crear el mapa.
+ImportResult importMesh(const QString &fileName, HeightFormat format, TiledHeightField &field);
+
+// === HMT ===
+// Versión 1: muestras de 8 bits. Versión 2: el formato (HeightFormat)
+// va en la cabecera y las muestras se guardan en little-endian.
+quint32 hmtVersionFor(HeightFormat format);
+bool hmtFormatFromCode(quint32 code, HeightFormat &format);
+// Alturas sin relleno de alineación, por bandas de una fila de tiles
+void writeHmtHeights(QDataStream &out, const TiledHeightField &field);
+void readHmtHeights(QDataStream &in, TiledHeightField &field);
+
+// Proyecto .hmt del texturizado: cabecera, alturas y textura en PNG
+bool saveHmtProject(const TiledHeightField &field, const QImage &texture, const QString &fileName);
+// Lee un proyecto guardado con saveHmtProject; sólo toca field si la
+// cabecera es válida. Lanza std::runtime_error si no se puede crear el mapa.
+bool loadHmtProject(const QString &fileName, TiledHeightField &field, QImage *texture = nullptr);
+// Textura por defecto de un proyecto: el mapa en escala de grises,
+// reducido con una muestra de cada step
+QImage grayscaleImage(const TiledHeightField &field, int step = 1);
+
+} // namespace TerrainIO
+
+#endif // TERRAINIO_H
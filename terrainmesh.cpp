@@ -0,0 +1,455 @@
+#include "terrainmesh.h"
+#include <algorithm>
+#include <cmath>
+#include <QVector4D>
+
+namespace TerrainMesh {
+
+namespace {
+
+// Escribe el vértice (lx, lz) de un bloque con nivel level; painted es
+// nulo o el color pintado de la muestra
+inline void writeVertex(Vertex &out, int lx, int lz, float level, const QColor *painted)
+{
+    out.x = static_cast<quint8>(lx);
+    out.z = static_cast<quint8>(lz);
+    out.height = static_cast<quint16>(std::lround(std::clamp(level, 0.0f, 255.0f) / 255.0f * 65535.0f));
+
+    if (painted && painted->isValid()) {
+        // Usar color pintado
+        out.r = static_cast<quint8>(painted->red());
+        out.g = static_cast<quint8>(painted->green());
+        out.b = static_cast<quint8>(painted->blue());
+        out.a = 255;
+    } else {
+        // Colores por altura (sistema original), en el shader
+        out.r = out.g = out.b = out.a = 0;
+    }
+}
+
+// Fila y del colorMap si tiene las dimensiones del mapa
+inline const std::vector<QColor> *paintedRow(const HeightField &field, const std::vector<std::vector<QColor>> &colorMap, int y)
+{
+    if (colorMap.size() != static_cast<size_t>(field.height())) return nullptr;
+    const std::vector<QColor> &row = colorMap[y];
+    return row.size() == static_cast<size_t>(field.width()) ? &row : nullptr;
+}
+
+inline int chunkCount(int samples)
+{
+    return samples > 1 ? (samples - 1 + ChunkCells - 1) / ChunkCells : 0;
+}
+
+// Caja de alturas de las muestras del trozo
+void computeBounds(const HeightField &field, Chunk &chunk, std::vector<float> &levels)
+{
+    const int x0 = chunk.cells.left();
+    const int count = chunk.cells.width() + 1;
+    const int bps = field.bytesPerSample();
+    levels.resize(count);
+
+    float low = 255.0f;
+    float high = 0.0f;
+    for (int y = chunk.cells.top(); y <= chunk.cells.bottom() + 1; ++y) {
+        samplesToLevels(field.format(), field.rowBytes(y) + static_cast<size_t>(x0) * bps, levels.data(), count);
+        const auto range = std::minmax_element(levels.begin(), levels.end());
+        low = std::min(low, *range.first);
+        high = std::max(high, *range.second);
+    }
+    chunk.minHeight = low / 255.0f * 100.0f;
+    chunk.maxHeight = high / 255.0f * 100.0f;
+}
+
+// Planos del frustum a partir de las filas de la matriz: un punto p
+// está dentro si dot(plane.xyz, p) + plane.w >= 0 para los seis
+struct Frustum {
+    QVector4D planes[6];
+
+    explicit Frustum(const QMatrix4x4 &mvp)
+    {
+        const QVector4D r0 = mvp.row(0), r1 = mvp.row(1), r2 = mvp.row(2), r3 = mvp.row(3);
+        planes[0] = r3 + r0;
+        planes[1] = r3 - r0;
+        planes[2] = r3 + r1;
+        planes[3] = r3 - r1;
+        planes[4] = r3 + r2;
+        planes[5] = r3 - r2;
+    }
+
+    bool intersects(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) const
+    {
+        for (const QVector4D &plane : planes) {
+            // Esquina de la caja más adentro del plano
+            const float x = plane.x() >= 0.0f ? maxX : minX;
+            const float y = plane.y() >= 0.0f ? maxY : minY;
+            const float z = plane.z() >= 0.0f ? maxZ : minZ;
+            if (plane.x() * x + plane.y() * y + plane.z() * z + plane.w() < 0.0f) return false;
+        }
+        return true;
+    }
+};
+
+// Selección recursiva de selectLod
+struct LodSelector {
+    const LodPyramid &pyramid;
+    const Frustum frustum;
+    const QVector3D camera;
+    const std::vector<float> &ranges;
+    std::vector<LodNode> &nodes;
+
+    // Caja del nodo (ix, iy) del nivel; false si no existe
+    bool box(int level, int ix, int iy, float out[6]) const
+    {
+        const LodPyramid::Level &data = pyramid.levels[level];
+        if (ix >= data.columns || iy >= data.rows) return false;
+        const int size = ChunkCells << level;
+        const size_t index = static_cast<size_t>(iy) * data.columns + ix;
+        out[0] = static_cast<float>(ix * size);
+        out[1] = data.minHeight[index];
+        out[2] = static_cast<float>(iy * size);
+        out[3] = static_cast<float>(std::min((ix + 1) * size, pyramid.cellsX));
+        out[4] = data.maxHeight[index];
+        out[5] = static_cast<float>(std::min((iy + 1) * size, pyramid.cellsY));
+        return true;
+    }
+
+    bool withinRange(const float b[6], float range) const
+    {
+        const float dx = std::max({ b[0] - camera.x(), 0.0f, camera.x() - b[3] });
+        const float dy = std::max({ b[1] - camera.y(), 0.0f, camera.y() - b[4] });
+        const float dz = std::max({ b[2] - camera.z(), 0.0f, camera.z() - b[5] });
+        return dx * dx + dy * dy + dz * dz <= range * range;
+    }
+
+    // false si el nodo queda más allá del rango de su nivel: entonces lo
+    // dibuja el padre
+    bool select(int level, int ix, int iy)
+    {
+        float b[6];
+        if (!box(level, ix, iy, b)) return true;
+        const bool top = level + 1 == static_cast<int>(pyramid.levels.size());
+        if (!top && !withinRange(b, ranges[level])) return false;
+        if (!frustum.intersects(b[0], b[1], b[2], b[3], b[4], b[5])) return true;
+
+        const int size = ChunkCells << level;
+        if (level == 0 || !withinRange(b, ranges[level - 1])) {
+            nodes.push_back({ ix * size, iy * size, level, false });
+            return true;
+        }
+
+        for (int child = 0; child < 4; ++child) {
+            const int cx = ix * 2 + (child & 1);
+            const int cy = iy * 2 + (child >> 1);
+            float cb[6];
+            if (!box(level - 1, cx, cy, cb)) continue;
+            if (!select(level - 1, cx, cy)
+                && frustum.intersects(cb[0], cb[1], cb[2], cb[3], cb[4], cb[5])) {
+                nodes.push_back({ cx * (size / 2), cy * (size / 2), level, true });
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+void buildTerrain(const HeightField &field, const std::vector<std::vector<QColor>> &colorMap,
+                  std::vector<Vertex> &vertices)
+{
+    vertices.clear();
+    const int mapWidth = field.width();
+    const int mapHeight = field.height();
+    const int columns = chunkCount(mapWidth);
+    const int rows = chunkCount(mapHeight);
+    if (columns == 0 || rows == 0) return;
+
+    vertices.resize(static_cast<size_t>(columns) * rows * ChunkVertices);
+
+    // Cada fila de muestras se convierte una vez para toda la fila de
+    // trozos (alturas en escala de nivel con la precisión del mapa)
+    std::vector<float> levels(mapWidth);
+    for (int cy = 0; cy < rows; ++cy) {
+        const int y0 = cy * ChunkCells;
+        for (int lz = 0; lz < ChunkSide; ++lz) {
+            const int y = std::min(y0 + lz, mapHeight - 1);
+            field.rowToLevels(y, levels.data());
+            const std::vector<QColor> *painted = paintedRow(field, colorMap, y);
+
+            for (int cx = 0; cx < columns; ++cx) {
+                const int x0 = cx * ChunkCells;
+                Vertex *out = vertices.data() + (static_cast<size_t>(cy) * columns + cx) * ChunkVertices
+                              + static_cast<size_t>(lz) * ChunkSide;
+                for (int lx = 0; lx < ChunkSide; ++lx, ++out) {
+                    const int x = std::min(x0 + lx, mapWidth - 1);
+                    writeVertex(*out, x - x0, y - y0, levels[x], painted ? &(*painted)[x] : nullptr);
+                }
+            }
+        }
+    }
+}
+
+void buildChunkIndices(std::vector<quint16> &indices)
+{
+    indices.clear();
+    indices.reserve(static_cast<size_t>(ChunkCells) * ChunkCells * 6);
+    for (int z = 0; z < ChunkCells; ++z) {
+        for (int x = 0; x < ChunkCells; ++x) {
+            const quint16 topLeft = static_cast<quint16>(z * ChunkSide + x);
+            const quint16 topRight = static_cast<quint16>(topLeft + 1);
+            const quint16 bottomLeft = static_cast<quint16>((z + 1) * ChunkSide + x);
+            const quint16 bottomRight = static_cast<quint16>(bottomLeft + 1);
+
+            indices.push_back(topLeft);
+            indices.push_back(bottomLeft);
+            indices.push_back(topRight);
+
+            indices.push_back(topRight);
+            indices.push_back(bottomLeft);
+            indices.push_back(bottomRight);
+        }
+    }
+}
+
+QRect chunkVertexArea(const Chunk &chunk, const QRect &area, int mapWidth, int mapHeight)
+{
+    // Los vértices pegados al borde repiten la última muestra
+    const int x0 = chunk.cells.left();
+    const int y0 = chunk.cells.top();
+    const int left = std::max(0, area.left() - x0);
+    const int right = area.right() >= mapWidth - 1 ? ChunkCells : std::min(ChunkCells, area.right() - x0);
+    const int top = std::max(0, area.top() - y0);
+    const int bottom = area.bottom() >= mapHeight - 1 ? ChunkCells : std::min(ChunkCells, area.bottom() - y0);
+    if (left > right || top > bottom || left > ChunkCells || top > ChunkCells) return QRect();
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+void buildChunks(const HeightField &field, std::vector<Chunk> &chunks)
+{
+    chunks.clear();
+    const int columns = chunkCount(field.width());
+    const int rows = chunkCount(field.height());
+    chunks.reserve(static_cast<size_t>(columns) * rows);
+
+    std::vector<float> levels;
+    for (int cy = 0; cy < rows; ++cy) {
+        for (int cx = 0; cx < columns; ++cx) {
+            Chunk chunk;
+            const int x0 = cx * ChunkCells;
+            const int y0 = cy * ChunkCells;
+            chunk.cells = QRect(x0, y0, std::min(ChunkCells, field.width() - 1 - x0),
+                                std::min(ChunkCells, field.height() - 1 - y0));
+            computeBounds(field, chunk, levels);
+            chunks.push_back(chunk);
+        }
+    }
+}
+
+void updateChunkBounds(const HeightField &field, const QRect &area, std::vector<Chunk> &chunks)
+{
+    const int columns = chunkCount(field.width());
+    const int rows = chunkCount(field.height());
+    if (chunks.size() != static_cast<size_t>(columns) * rows) return;
+
+    const QRect clipped = area & QRect(0, 0, field.width(), field.height());
+    if (clipped.isEmpty()) return;
+
+    // Las muestras de los bordes de un trozo son también del vecino
+    const int cx0 = std::max(0, (clipped.left() - 1) / ChunkCells);
+    const int cx1 = std::min(columns - 1, clipped.right() / ChunkCells);
+    const int cy0 = std::max(0, (clipped.top() - 1) / ChunkCells);
+    const int cy1 = std::min(rows - 1, clipped.bottom() / ChunkCells);
+
+    std::vector<float> levels;
+    for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            computeBounds(field, chunks[static_cast<size_t>(cy) * columns + cx], levels);
+        }
+    }
+}
+
+int visibleChunks(const std::vector<Chunk> &chunks, const QMatrix4x4 &mvp, std::vector<int> &visible)
+{
+    visible.clear();
+    const Frustum frustum(mvp);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const Chunk &chunk = chunks[i];
+        if (frustum.intersects(chunk.cells.left(), chunk.minHeight, chunk.cells.top(),
+                               chunk.cells.right() + 1, chunk.maxHeight, chunk.cells.bottom() + 1)) {
+            visible.push_back(static_cast<int>(i));
+        }
+    }
+    return static_cast<int>(visible.size());
+}
+
+void buildLodPyramid(const HeightField &field, const std::vector<Chunk> &chunks, LodPyramid &pyramid)
+{
+    pyramid.levels.clear();
+    pyramid.cellsX = std::max(0, field.width() - 1);
+    pyramid.cellsY = std::max(0, field.height() - 1);
+
+    LodPyramid::Level base;
+    base.columns = chunkCount(field.width());
+    base.rows = chunkCount(field.height());
+    if (chunks.empty() || chunks.size() != static_cast<size_t>(base.columns) * base.rows) return;
+    for (const Chunk &chunk : chunks) {
+        base.minHeight.push_back(chunk.minHeight);
+        base.maxHeight.push_back(chunk.maxHeight);
+    }
+    pyramid.levels.push_back(std::move(base));
+
+    while (pyramid.levels.size() < static_cast<size_t>(MaxLodLevels)) {
+        const LodPyramid::Level &below = pyramid.levels.back();
+        if (below.columns == 1 && below.rows == 1) break;
+
+        LodPyramid::Level level;
+        level.columns = (below.columns + 1) / 2;
+        level.rows = (below.rows + 1) / 2;
+        level.minHeight.assign(static_cast<size_t>(level.columns) * level.rows, 100.0f);
+        level.maxHeight.assign(level.minHeight.size(), 0.0f);
+        for (int y = 0; y < below.rows; ++y) {
+            for (int x = 0; x < below.columns; ++x) {
+                const size_t from = static_cast<size_t>(y) * below.columns + x;
+                const size_t to = static_cast<size_t>(y / 2) * level.columns + x / 2;
+                level.minHeight[to] = std::min(level.minHeight[to], below.minHeight[from]);
+                level.maxHeight[to] = std::max(level.maxHeight[to], below.maxHeight[from]);
+            }
+        }
+        pyramid.levels.push_back(std::move(level));
+    }
+}
+
+std::vector<float> lodRanges(const LodPyramid &pyramid, float pixelError, int viewportHeight, float fovY)
+{
+    // Una celda de 1 << L muestras a distancia d ocupa unos
+    // (1 << L) * pixelsPerUnit / d píxeles
+    const float pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f * 3.14159265f / 180.0f));
+    float range = pixelsPerUnit / std::max(pixelError, 0.1f);
+
+    // Para que un nodo sólo linde con el nivel siguiente, cada rango debe
+    // superar al anterior en más que la diagonal de sus nodos (con toda
+    // la altura, 0-100)
+    const float minimum = std::sqrt(2.0f * ChunkCells * ChunkCells + 100.0f * 100.0f) * 1.25f;
+    range = std::max(range, minimum);
+
+    std::vector<float> ranges(pyramid.levels.size());
+    for (float &value : ranges) {
+        value = range;
+        range *= 2.0f;
+    }
+    return ranges;
+}
+
+void selectLod(const LodPyramid &pyramid, const QMatrix4x4 &mvp, const QVector3D &camera,
+               const std::vector<float> &ranges, std::vector<LodNode> &nodes)
+{
+    nodes.clear();
+    if (pyramid.levels.empty() || ranges.size() != pyramid.levels.size()) return;
+
+    LodSelector selector{ pyramid, Frustum(mvp), camera, ranges, nodes };
+    selector.select(static_cast<int>(pyramid.levels.size()) - 1, 0, 0);
+}
+
+QRect updateTerrain(const HeightField &field, const std::vector<std::vector<QColor>> &colorMap,
+                    const QRect &area, std::vector<Vertex> &vertices)
+{
+    const int mapWidth = field.width();
+    const int mapHeight = field.height();
+    const int columns = chunkCount(mapWidth);
+    const int rows = chunkCount(mapHeight);
+    if (vertices.empty() || vertices.size() != static_cast<size_t>(columns) * rows * ChunkVertices) return QRect();
+
+    const QRect clipped = area & QRect(0, 0, mapWidth, mapHeight);
+    if (clipped.isEmpty()) return QRect();
+
+    // Trozos cuyas muestras (o vértices pegados al borde) tocan clipped
+    const int cx0 = std::max(0, (clipped.left() - 1) / ChunkCells);
+    const int cx1 = std::min(columns - 1, clipped.right() / ChunkCells);
+    const int cy0 = std::max(0, (clipped.top() - 1) / ChunkCells);
+    const int cy1 = std::min(rows - 1, clipped.bottom() / ChunkCells);
+
+    for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            Chunk chunk;
+            chunk.cells = QRect(cx * ChunkCells, cy * ChunkCells, ChunkCells, ChunkCells);
+            const QRect local = chunkVertexArea(chunk, clipped, mapWidth, mapHeight);
+            if (local.isEmpty()) continue;
+
+            Vertex *block = vertices.data() + (static_cast<size_t>(cy) * columns + cx) * ChunkVertices;
+            for (int lz = local.top(); lz <= local.bottom(); ++lz) {
+                const int y = std::min(chunk.cells.top() + lz, mapHeight - 1);
+                const std::vector<QColor> *painted = paintedRow(field, colorMap, y);
+                for (int lx = local.left(); lx <= local.right(); ++lx) {
+                    const int x = std::min(chunk.cells.left() + lx, mapWidth - 1);
+                    writeVertex(block[lz * ChunkSide + lx], x - chunk.cells.left(), y - chunk.cells.top(),
+                                field.level(x, y), painted ? &(*painted)[x] : nullptr);
+                }
+            }
+        }
+    }
+    return clipped;
+}
+
+void buildWater(const HeightField &field, float waterLevel, const QVector3D &color,
+                std::vector<float> &vertices, std::vector<unsigned int> &indices)
+{
+    vertices.clear();
+    indices.clear();
+    if (field.empty()) return;
+
+    const int mapWidth = field.width();
+    const int mapHeight = field.height();
+    const float waterHeight = waterLevel;
+    unsigned int vertexIndex = 0;
+
+    // Vértice (X, Y, Z, R, G, B, U, V) sobre la esquina (x, y)
+    auto pushVertex = [&](int x, int y) {
+        vertices.push_back(static_cast<float>(x));
+        vertices.push_back(waterHeight);
+        vertices.push_back(static_cast<float>(y));
+        vertices.push_back(color.x());
+        vertices.push_back(color.y());
+        vertices.push_back(color.z());
+        vertices.push_back(static_cast<float>(x) / mapWidth);
+        vertices.push_back(static_cast<float>(y) / mapHeight);
+    };
+
+    // Generar agua solo en zonas bajas del terreno
+    std::vector<float> levelRow0(mapWidth);
+    std::vector<float> levelRow1(mapWidth);
+    for (int y = 0; y < mapHeight - 1; ++y) {
+        field.rowToLevels(y, levelRow0.data());
+        field.rowToLevels(y + 1, levelRow1.data());
+        const float *row0 = levelRow0.data();
+        const float *row1 = levelRow1.data();
+        for (int x = 0; x < mapWidth - 1; ++x) {
+            // Obtener las alturas de las 4 esquinas de la celda
+            float h1 = row0[x] / 255.0f * 100.0f;
+            float h2 = row0[x + 1] / 255.0f * 100.0f;
+            float h3 = row1[x + 1] / 255.0f * 100.0f;
+            float h4 = row1[x] / 255.0f * 100.0f;
+
+            // Solo generar agua si AL MENOS UNA esquina está bajo el nivel del agua
+            if (h1 < waterHeight || h2 < waterHeight ||
+                h3 < waterHeight || h4 < waterHeight) {
+
+                pushVertex(x, y);          // Superior izquierda
+                pushVertex(x + 1, y);      // Superior derecha
+                pushVertex(x + 1, y + 1);  // Inferior derecha
+                pushVertex(x, y + 1);      // Inferior izquierda
+
+                // Dos triángulos para formar el quad
+                indices.push_back(vertexIndex);
+                indices.push_back(vertexIndex + 1);
+                indices.push_back(vertexIndex + 2);
+
+                indices.push_back(vertexIndex);
+                indices.push_back(vertexIndex + 2);
+                indices.push_back(vertexIndex + 3);
+
+                vertexIndex += 4;
+            }
+        }
+    }
+}
+
+} // namespace TerrainMesh
@@ -0,0 +1,132 @@
+#ifndef TERRAINMESH_H
+#define TERRAINMESH_H
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <QRect>
+#include <QVector3D>
+#include <QtGlobal>
+#include <vector>
+#include "heightfield.h"
+
+// =================================================================
+// === TERRAIN MESH
+// =================================================================
+// Geometría de la vista 3D construida en CPU, sin contexto OpenGL:
+// OpenGLWidget la sube a sus buffers y el banco de pruebas la mide.
+// Rejilla de una unidad por muestra y altura 0-100 (nivel / 255 * 100).
+
+namespace TerrainMesh {
+
+// Celdas por lado de los trozos en que se divide el terreno; los de la
+// última columna y la última fila pueden ser menores
+constexpr int ChunkCells = 64;
+// Vértices del bloque de cada trozo (ver buildTerrain)
+constexpr int ChunkSide = ChunkCells + 1;
+constexpr int ChunkVertices = ChunkSide * ChunkSide;
+
+// Trozo del terreno: sus celdas y la caja de alturas de sus muestras
+struct Chunk {
+    QRect cells;                    // Sus muestras llegan a right() + 1
+    float minHeight = 0.0f;         // Altura de la vista (0-100)
+    float maxHeight = 0.0f;
+};
+
+// Vértice de la malla (8 bytes). La posición es relativa al trozo y las
+// coordenadas de textura salen de ella en el shader.
+struct Vertex {
+    quint8 x;                       // Muestra dentro del trozo (0..ChunkCells)
+    quint8 z;
+    quint16 height;                 // Nivel / 255 en 16 bits
+    quint8 r;                       // Color pintado
+    quint8 g;
+    quint8 b;
+    quint8 a;                       // 0: color por altura (en el shader)
+};
+static_assert(sizeof(Vertex) == 8, "TerrainMesh::Vertex debe ocupar 8 bytes");
+
+// Un bloque de ChunkVertices vértices por trozo, en el orden de
+// buildChunks; en los trozos del borde, los vértices que se salen del
+// mapa se pegan a la última muestra. Todos los bloques se dibujan con
+// los mismos índices (buildChunkIndices) desde su primer vértice. Si
+// colorMap tiene las dimensiones del mapa, sus colores válidos
+// sustituyen a los colores por altura.
+void buildTerrain(const HeightField &field, const std::vector<std::vector<QColor>> &colorMap,
+                  std::vector<Vertex> &vertices);
+// Dos triángulos por celda de un trozo completo, en índices de 16 bits
+void buildChunkIndices(std::vector<quint16> &indices);
+
+// Vértices (x, z dentro del bloque) del trozo que corresponden a
+// muestras de area; vacío si ninguno
+QRect chunkVertexArea(const Chunk &chunk, const QRect &area, int mapWidth, int mapHeight);
+
+// Vuelve a escribir en vertices (de buildTerrain con el mismo mapa) los
+// vértices de las muestras de area. Devuelve la zona escrita: area
+// recortada al mapa, o vacía si vertices no corresponde al mapa.
+QRect updateTerrain(const HeightField &field, const std::vector<std::vector<QColor>> &colorMap,
+                    const QRect &area, std::vector<Vertex> &vertices);
+
+// Trozos del mapa, fila a fila, con sus cajas
+void buildChunks(const HeightField &field, std::vector<Chunk> &chunks);
+// Recalcula las cajas de los trozos que tocan las muestras de area
+void updateChunkBounds(const HeightField &field, const QRect &area, std::vector<Chunk> &chunks);
+// Deja en visible, en orden, los trozos cuya caja corta el frustum de
+// mvp (que lleva de coordenadas de la malla a clip); devuelve cuántos
+int visibleChunks(const std::vector<Chunk> &chunks, const QMatrix4x4 &mvp, std::vector<int> &visible);
+
+// =================================================================
+// === NIVEL DE DETALLE (CDLOD)
+// =================================================================
+// Quadtree sobre los trozos: un nodo de nivel L cubre ChunkCells << L
+// celdas por lado y se dibuja con la rejilla de un trozo, con un vértice
+// cada 1 << L muestras. Cada nivel se usa hasta una distancia (ranges)
+// y, antes de llegar a ella, sus vértices impares se desplazan hacia
+// los del nivel siguiente (en el shader), así que no hay grietas ni
+// saltos entre niveles. El número de nodos depende de los rangos y no
+// del tamaño del mapa.
+
+// Niveles como máximo (1 << 15 trozos por lado)
+constexpr int MaxLodLevels = 16;
+
+// Pirámide de cajas: el nivel 0 son las de los trozos y cada nivel
+// toma mínimo y máximo de los cuatro nodos del anterior
+struct LodPyramid {
+    struct Level {
+        int columns = 0;
+        int rows = 0;
+        std::vector<float> minHeight;
+        std::vector<float> maxHeight;
+    };
+    std::vector<Level> levels;      // El último tiene un solo nodo
+    int cellsX = 0;                 // Celdas del mapa
+    int cellsY = 0;
+};
+
+// Nodo a dibujar. Un quarter es un hijo que se dibuja con el detalle
+// del padre: sólo el primer cuadrante de la rejilla.
+struct LodNode {
+    int x = 0;                      // Primera celda
+    int y = 0;
+    int level = 0;
+    bool quarter = false;
+};
+
+void buildLodPyramid(const HeightField &field, const std::vector<Chunk> &chunks, LodPyramid &pyramid);
+// Distancia hasta la que se usa cada nivel para que la celda de un
+// nodo no pase de pixelError píxeles en una vista de viewportHeight
+// píxeles y campo vertical fovY grados. Crece al doble por nivel y
+// nunca baja de lo que necesita el paso suave entre niveles.
+std::vector<float> lodRanges(const LodPyramid &pyramid, float pixelError, int viewportHeight, float fovY);
+// Nodos dentro del frustum de mvp con el nivel que pide su distancia a
+// camera (ambos en coordenadas de la malla)
+void selectLod(const LodPyramid &pyramid, const QMatrix4x4 &mvp, const QVector3D &camera,
+               const std::vector<float> &ranges, std::vector<LodNode> &nodes);
+
+// Un quad a la altura waterLevel por cada celda con alguna esquina por
+// debajo de ese nivel
+void buildWater(const HeightField &field, float waterLevel, const QVector3D &color,
+                std::vector<float> &vertices, std::vector<unsigned int> &indices);
+
+} // namespace TerrainMesh
+
+#endif // TERRAINMESH_H
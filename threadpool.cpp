@@ -0,0 +1,106 @@
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount <= 0) {
+        threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    threadCount = std::max(1, threadCount);
+
+    // El hilo llamante cuenta como uno más
+    for (int i = 0; i < threadCount - 1; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)> &body, int grain)
+{
+    const int count = end - begin;
+    if (count <= 0) return;
+
+    if (grain <= 0) {
+        grain = std::max(1, count / (threadCount() * 4));
+    }
+    const int chunks = (count + grain - 1) / grain;
+
+    if (chunks == 1 || workers.empty()) {
+        body(begin, end);
+        return;
+    }
+
+    // Estado compartido: los ayudantes que arranquen tarde sólo ven
+    // que no quedan bandas, nunca tocan body fuera de esta llamada
+    struct Job {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto job = std::make_shared<Job>();
+
+    auto run = [job, begin, end, grain, chunks, &body]() {
+        int chunk;
+        while ((chunk = job->next.fetch_add(1)) < chunks) {
+            int bandBegin = begin + chunk * grain;
+            int bandEnd = std::min(end, bandBegin + grain);
+            body(bandBegin, bandEnd);
+
+            if (job->done.fetch_add(1) + 1 == chunks) {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->finished.notify_all();
+            }
+        }
+    };
+
+    const int helpers = std::min(static_cast<int>(workers.size()), chunks - 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < helpers; ++i) {
+            tasks.emplace_back(run);
+        }
+    }
+    condition.notify_all();
+
+    run();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job, chunks]() { return job->done.load() == chunks; });
+}
@@ -0,0 +1,47 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// =================================================================
+// === THREAD POOL
+// =================================================================
+// Pool de hilos persistente para trabajos por bandas de filas.
+// parallelFor() reparte [begin, end) en bandas y el hilo llamante
+// también trabaja, así que puede anidarse sin bloquearse.
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Pool compartido del proceso (un hilo por núcleo)
+    static ThreadPool &instance();
+
+    // Hilos que participan en parallelFor (trabajadores + llamante)
+    int threadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Ejecuta body(bandBegin, bandEnd) sobre bandas de tamaño grain.
+    // grain <= 0 elige unas cuatro bandas por hilo.
+    void parallelFor(int begin, int end, const std::function<void(int, int)> &body, int grain = 0);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,682 @@
+#include "tiledheightfield.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// =================================================================
+// === SPILL FILE
+// =================================================================
+// Archivo temporal (se borra solo al cerrarse) del que se proyectan
+// tiles sueltos. Los desplazamientos son múltiplos del tamaño de un
+// tile, que a su vez es múltiplo de 64 KB: vale como alineación tanto
+// para mmap como para MapViewOfFile. La carpeta se puede cambiar con
+// la variable de entorno HEIGHTMAP_SPILL_DIR.
+
+class SpillFile
+{
+public:
+    static std::unique_ptr<SpillFile> create(std::size_t size);
+    ~SpillFile();
+
+    unsigned char *map(std::size_t offset, std::size_t size);
+    void unmap(unsigned char *data, std::size_t size);
+
+private:
+    SpillFile() = default;
+
+#if defined(_WIN32)
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+namespace {
+
+std::filesystem::path spillDirectory()
+{
+    if (const char *dir = std::getenv("HEIGHTMAP_SPILL_DIR")) {
+        if (*dir) return std::filesystem::path(dir);
+    }
+    std::error_code error;
+    std::filesystem::path dir = std::filesystem::temp_directory_path(error);
+    return error ? std::filesystem::path(".") : dir;
+}
+
+} // namespace
+
+#if defined(_WIN32)
+
+std::unique_ptr<SpillFile> SpillFile::create(std::size_t size)
+{
+    wchar_t path[MAX_PATH];
+    if (GetTempFileNameW(spillDirectory().wstring().c_str(), L"hmt", 0, path) == 0) return nullptr;
+
+    std::unique_ptr<SpillFile> file(new SpillFile());
+    file->m_file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (file->m_file == INVALID_HANDLE_VALUE) return nullptr;
+
+    // La proyección fija el tamaño del archivo
+    const unsigned long long bytes = size;
+    file->m_mapping = CreateFileMappingW(file->m_file, nullptr, PAGE_READWRITE,
+                                         static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), nullptr);
+    if (!file->m_mapping) return nullptr;
+    return file;
+}
+
+SpillFile::~SpillFile()
+{
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+
+unsigned char *SpillFile::map(std::size_t offset, std::size_t size)
+{
+    const unsigned long long start = offset;
+    void *view = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS,
+                               static_cast<DWORD>(start >> 32), static_cast<DWORD>(start), size);
+    if (!view) throw std::bad_alloc();
+    return static_cast<unsigned char *>(view);
+}
+
+void SpillFile::unmap(unsigned char *data, std::size_t)
+{
+    UnmapViewOfFile(data);
+}
+
+#else
+
+std::unique_ptr<SpillFile> SpillFile::create(std::size_t size)
+{
+    std::string pattern = (spillDirectory() / "heightmap-XXXXXX").string();
+    std::unique_ptr<SpillFile> file(new SpillFile());
+    file->m_fd = mkstemp(pattern.data());
+    if (file->m_fd < 0) return nullptr;
+
+    // Sin nombre desde ya: el sistema lo borra al cerrar el descriptor.
+    // ftruncate deja el archivo disperso; sólo ocupan disco los tiles escritos.
+    unlink(pattern.c_str());
+    if (ftruncate(file->m_fd, static_cast<off_t>(size)) != 0) return nullptr;
+    return file;
+}
+
+SpillFile::~SpillFile()
+{
+    if (m_fd >= 0) close(m_fd);
+}
+
+unsigned char *SpillFile::map(std::size_t offset, std::size_t size)
+{
+    void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off_t>(offset));
+    if (view == MAP_FAILED) throw std::bad_alloc();
+    return static_cast<unsigned char *>(view);
+}
+
+void SpillFile::unmap(unsigned char *data, std::size_t size)
+{
+    munmap(data, size);
+}
+
+#endif
+
+// =================================================================
+// === TILED HEIGHTFIELD
+// =================================================================
+
+namespace {
+
+std::atomic<std::size_t> residentBudget{ std::size_t(256) * 1024 * 1024 };
+
+// Muestra (en el formato del mapa) de un tile sin materializar,
+// convertida a otro formato
+void uniformSample(HeightFormat format, float level, HeightFormat dstFormat, void *dst)
+{
+    unsigned char sample[sizeof(float)];
+    fillSamples(format, sample, 1, level);
+    convertSamples(format, sample, dstFormat, dst, 1);
+}
+
+void replicateSample(const void *sample, int sampleBytes, void *dst, int count)
+{
+    unsigned char *out = static_cast<unsigned char *>(dst);
+    for (int i = 0; i < count; ++i) {
+        std::memcpy(out + static_cast<std::size_t>(i) * sampleBytes, sample, sampleBytes);
+    }
+}
+
+} // namespace
+
+void TiledHeightField::setMemoryBudget(std::size_t bytes)
+{
+    residentBudget = bytes;
+}
+
+std::size_t TiledHeightField::memoryBudget()
+{
+    return residentBudget;
+}
+
+// Fuera de línea: SpillFile sólo está completo en esta unidad
+TiledHeightField::TiledHeightField() = default;
+
+TiledHeightField::TiledHeightField(int width, int height, HeightFormat format, float level)
+{
+    assign(width, height, format, level);
+}
+
+TiledHeightField::TiledHeightField(const TiledHeightField &other)
+{
+    *this = other;
+}
+
+TiledHeightField::TiledHeightField(TiledHeightField &&other) noexcept
+{
+    swap(other);
+}
+
+TiledHeightField &TiledHeightField::operator=(const TiledHeightField &other)
+{
+    if (this == &other) return *this;
+
+    assign(other.m_width, other.m_height, other.m_format, 0.0f);
+    const std::size_t bytes = tileBytes();
+    for (std::size_t i = 0; i < m_tiles.size(); ++i) {
+        const Tile &source = other.m_tiles[i];
+        if (source.materialized) {
+            std::memcpy(tileData(static_cast<int>(i), true), other.tileData(static_cast<int>(i)), bytes);
+        } else {
+            m_tiles[i].fillLevel = source.fillLevel;
+        }
+    }
+
+    // La copia (normalmente un estado de deshacer) no retiene memoria
+    releaseResident();
+    return *this;
+}
+
+TiledHeightField &TiledHeightField::operator=(TiledHeightField &&other) noexcept
+{
+    if (this != &other) {
+        clear();
+        swap(other);
+    }
+    return *this;
+}
+
+TiledHeightField::~TiledHeightField()
+{
+    clear();
+}
+
+void TiledHeightField::assign(int width, int height, HeightFormat format, float level)
+{
+    clear();
+    if (width <= 0 || height <= 0) {
+        m_format = format;
+        return;
+    }
+
+    m_format = format;
+    m_width = width;
+    m_height = height;
+    m_tilesX = (width + TileSize - 1) / TileSize;
+    m_tilesY = (height + TileSize - 1) / TileSize;
+    m_tiles.assign(static_cast<std::size_t>(m_tilesX) * m_tilesY, Tile());
+    for (Tile &tile : m_tiles) {
+        tile.fillLevel = level;
+    }
+
+    const std::size_t bytes = tileBytes();
+    const std::size_t totalBytes = bytes * m_tiles.size();
+    const std::size_t budget = memoryBudget();
+
+    if (totalBytes <= budget / 4) {
+        m_memoryTiles.resize(m_tiles.size());
+        return;
+    }
+
+    m_file = SpillFile::create(totalBytes);
+    if (!m_file) {
+        clear();
+        throw std::runtime_error("No se pudo crear el archivo temporal del mapa");
+    }
+    // Al menos una fila de tiles residente: los recorridos por filas
+    // (pantalla, exportación) no vuelven a proyectar cada tile
+    m_maxResident = std::max<std::size_t>(budget / bytes, static_cast<std::size_t>(m_tilesX) + 1);
+}
+
+void TiledHeightField::clear()
+{
+    releaseResident();
+    m_file.reset();
+    m_tiles.clear();
+    m_memoryTiles.clear();
+    m_width = 0;
+    m_height = 0;
+    m_tilesX = 0;
+    m_tilesY = 0;
+    m_maxResident = 0;
+}
+
+void TiledHeightField::swap(TiledHeightField &other) noexcept
+{
+    std::swap(m_format, other.m_format);
+    std::swap(m_width, other.m_width);
+    std::swap(m_height, other.m_height);
+    std::swap(m_tilesX, other.m_tilesX);
+    std::swap(m_tilesY, other.m_tilesY);
+    m_tiles.swap(other.m_tiles);
+    m_memoryTiles.swap(other.m_memoryTiles);
+    m_file.swap(other.m_file);
+    m_lru.swap(other.m_lru);
+    std::swap(m_maxResident, other.m_maxResident);
+}
+
+void TiledHeightField::convertTo(HeightFormat format)
+{
+    if (format == m_format || empty()) {
+        m_format = format;
+        return;
+    }
+
+    TiledHeightField result(m_width, m_height, format, 0.0f);
+    for (std::size_t i = 0; i < m_tiles.size(); ++i) {
+        const Tile &source = m_tiles[i];
+        if (source.materialized) {
+            const int index = static_cast<int>(i);
+            convertSamples(m_format, tileData(index), format, result.tileData(index, true), TileSize * TileSize);
+        } else {
+            // Mismo redondeo que si el tile estuviera materializado
+            unsigned char sample[sizeof(float)];
+            float level;
+            fillSamples(m_format, sample, 1, source.fillLevel);
+            samplesToLevels(m_format, sample, &level, 1);
+            result.m_tiles[i].fillLevel = level;
+        }
+    }
+
+    swap(result);
+}
+
+std::size_t TiledHeightField::tileRowBytes() const
+{
+    return static_cast<std::size_t>(TileSize) * bytesPerSample();
+}
+
+std::size_t TiledHeightField::tileBytes() const
+{
+    return tileRowBytes() * TileSize;
+}
+
+unsigned char *TiledHeightField::tileData(int index, bool discard) const
+{
+    Tile &tile = m_tiles[index];
+
+    if (!m_file) {
+        if (!tile.materialized) {
+            m_memoryTiles[index] = HeightField(TileSize, TileSize, m_format, tile.fillLevel);
+            tile.data = m_memoryTiles[index].data();
+            tile.materialized = true;
+        }
+        return tile.data;
+    }
+
+    if (tile.data) {
+        m_lru.splice(m_lru.begin(), m_lru, tile.lruPos);
+        return tile.data;
+    }
+
+    while (m_lru.size() >= m_maxResident) {
+        evictTile(m_lru.back());
+    }
+
+    tile.data = m_file->map(static_cast<std::size_t>(index) * tileBytes(), tileBytes());
+    m_lru.push_front(index);
+    tile.lruPos = m_lru.begin();
+
+    if (!tile.materialized) {
+        if (!discard) fillSamples(m_format, tile.data, TileSize * TileSize, tile.fillLevel);
+        tile.materialized = true;
+    }
+    return tile.data;
+}
+
+void TiledHeightField::evictTile(int index) const
+{
+    Tile &tile = m_tiles[index];
+    if (!tile.data || !m_file) return;
+
+    // El contenido queda en el archivo (MAP_SHARED / vista compartida)
+    m_file->unmap(tile.data, tileBytes());
+    tile.data = nullptr;
+    m_lru.erase(tile.lruPos);
+}
+
+void TiledHeightField::releaseResident() const
+{
+    while (!m_lru.empty()) {
+        evictTile(m_lru.back());
+    }
+}
+
+TiledHeightField::TileSnapshot TiledHeightField::saveTile(int index) const
+{
+    TileSnapshot snapshot;
+    const Tile &tile = m_tiles[index];
+    if (!tile.materialized) {
+        snapshot.fillLevel = tile.fillLevel;
+        return snapshot;
+    }
+
+    snapshot.samples = HeightField(TileSize, TileSize, m_format);
+    std::memcpy(snapshot.samples.data(), tileData(index), tileBytes());
+    return snapshot;
+}
+
+void TiledHeightField::restoreTile(int index, const TileSnapshot &snapshot)
+{
+    if (snapshot.samples.empty()) {
+        makeUniform(index, snapshot.fillLevel);
+        return;
+    }
+    std::memcpy(tileData(index, true), snapshot.samples.data(), tileBytes());
+}
+
+bool TiledHeightField::tileEquals(int index, const TileSnapshot &snapshot) const
+{
+    const Tile &tile = m_tiles[index];
+    if (!tile.materialized && snapshot.samples.empty()) return tile.fillLevel == snapshot.fillLevel;
+
+    // Uno de los dos es uniforme: se compara con sus muestras de relleno
+    HeightField filled;
+    const unsigned char *current = nullptr;
+    const unsigned char *saved = snapshot.samples.data();
+    if (!tile.materialized) {
+        filled = HeightField(TileSize, TileSize, m_format, tile.fillLevel);
+        current = filled.data();
+    } else {
+        current = tileData(index);
+        if (!saved) {
+            filled = HeightField(TileSize, TileSize, m_format, snapshot.fillLevel);
+            saved = filled.data();
+        }
+    }
+    return std::memcmp(current, saved, tileBytes()) == 0;
+}
+
+void TiledHeightField::tileBounds(int index, int &x, int &y, int &boundsWidth, int &boundsHeight) const
+{
+    x = index % m_tilesX * TileSize;
+    y = index / m_tilesX * TileSize;
+    boundsWidth = std::min(TileSize, m_width - x);
+    boundsHeight = std::min(TileSize, m_height - y);
+}
+
+void TiledHeightField::makeUniform(int index, float level)
+{
+    Tile &tile = m_tiles[index];
+    if (m_file) {
+        evictTile(index);
+    } else {
+        m_memoryTiles[index].clear();
+        tile.data = nullptr;
+    }
+    tile.materialized = false;
+    tile.fillLevel = level;
+}
+
+template <typename F>
+void TiledHeightField::forEachRowSegment(int y, int x0, int x1, F &&f) const
+{
+    if (x1 <= x0) return;
+    const int ty = y / TileSize;
+    const std::size_t rowOffset = static_cast<std::size_t>(y - ty * TileSize) * tileRowBytes();
+    for (int tx = x0 / TileSize; tx <= (x1 - 1) / TileSize; ++tx) {
+        const int index = tileIndex(tx, ty);
+        const Tile &tile = m_tiles[index];
+        const int x = tx * TileSize;
+        const int count = std::min(TileSize, m_width - x);
+        const unsigned char *samples = tile.materialized ? tileData(index) + rowOffset : nullptr;
+        f(x, samples, tile, count);
+    }
+}
+
+void TiledHeightField::readRegion(int x, int y, HeightField &dst) const
+{
+    const int x0 = std::max(0, x);
+    const int y0 = std::max(0, y);
+    const int x1 = std::min(m_width, x + dst.width());
+    const int y1 = std::min(m_height, y + dst.height());
+    if (x1 <= x0 || y1 <= y0) return;
+
+    const int bps = bytesPerSample();
+    const int dstBps = dst.bytesPerSample();
+    for (int ty = y0 / TileSize; ty <= (y1 - 1) / TileSize; ++ty) {
+        const int rowBegin = std::max(y0, ty * TileSize);
+        const int rowEnd = std::min(y1, (ty + 1) * TileSize);
+        for (int tx = x0 / TileSize; tx <= (x1 - 1) / TileSize; ++tx) {
+            const int colBegin = std::max(x0, tx * TileSize);
+            const int count = std::min(x1, (tx + 1) * TileSize) - colBegin;
+            const int index = tileIndex(tx, ty);
+            const Tile &tile = m_tiles[index];
+
+            if (!tile.materialized) {
+                unsigned char sample[sizeof(float)];
+                uniformSample(m_format, tile.fillLevel, dst.format(), sample);
+                for (int row = rowBegin; row < rowEnd; ++row) {
+                    replicateSample(sample, dstBps, dst.rowBytes(row - y) + (colBegin - x) * dstBps, count);
+                }
+                continue;
+            }
+
+            const unsigned char *samples = tileData(index);
+            for (int row = rowBegin; row < rowEnd; ++row) {
+                const unsigned char *src = samples + (row - ty * TileSize) * tileRowBytes()
+                                           + static_cast<std::size_t>(colBegin - tx * TileSize) * bps;
+                convertSamples(m_format, src, dst.format(), dst.rowBytes(row - y) + (colBegin - x) * dstBps, count);
+            }
+        }
+    }
+}
+
+HeightField TiledHeightField::region(int x, int y, int regionWidth, int regionHeight) const
+{
+    HeightField result(regionWidth, regionHeight, m_format);
+    readRegion(x, y, result);
+    return result;
+}
+
+void TiledHeightField::writeRegion(const HeightField &src, int x, int y)
+{
+    const int x0 = std::max(0, x);
+    const int y0 = std::max(0, y);
+    const int x1 = std::min(m_width, x + src.width());
+    const int y1 = std::min(m_height, y + src.height());
+    if (x1 <= x0 || y1 <= y0) return;
+
+    const int bps = bytesPerSample();
+    const int srcBps = src.bytesPerSample();
+    for (int ty = y0 / TileSize; ty <= (y1 - 1) / TileSize; ++ty) {
+        const int rowBegin = std::max(y0, ty * TileSize);
+        const int rowEnd = std::min(y1, (ty + 1) * TileSize);
+        for (int tx = x0 / TileSize; tx <= (x1 - 1) / TileSize; ++tx) {
+            const int colBegin = std::max(x0, tx * TileSize);
+            const int count = std::min(x1, (tx + 1) * TileSize) - colBegin;
+
+            // Un tile cubierto entero (hasta el borde del mapa) no necesita
+            // su contenido anterior
+            const bool wholeTile = rowBegin == ty * TileSize && rowEnd == std::min(m_height, (ty + 1) * TileSize)
+                                   && colBegin == tx * TileSize && colBegin + count == std::min(m_width, (tx + 1) * TileSize);
+            unsigned char *samples = tileData(tileIndex(tx, ty), wholeTile);
+
+            for (int row = rowBegin; row < rowEnd; ++row) {
+                unsigned char *dst = samples + (row - ty * TileSize) * tileRowBytes()
+                                     + static_cast<std::size_t>(colBegin - tx * TileSize) * bps;
+                convertSamples(src.format(), src.rowBytes(row - y) + (colBegin - x) * srcBps, m_format, dst, count);
+            }
+        }
+    }
+}
+
+void TiledHeightField::fillRegion(int x, int y, int regionWidth, int regionHeight, float level)
+{
+    const int x0 = std::max(0, x);
+    const int y0 = std::max(0, y);
+    const int x1 = std::min(m_width, x + regionWidth);
+    const int y1 = std::min(m_height, y + regionHeight);
+    if (x1 <= x0 || y1 <= y0) return;
+
+    const int bps = bytesPerSample();
+    for (int ty = y0 / TileSize; ty <= (y1 - 1) / TileSize; ++ty) {
+        const int rowBegin = std::max(y0, ty * TileSize);
+        const int rowEnd = std::min(y1, (ty + 1) * TileSize);
+        for (int tx = x0 / TileSize; tx <= (x1 - 1) / TileSize; ++tx) {
+            const int colBegin = std::max(x0, tx * TileSize);
+            const int colEnd = std::min(x1, (tx + 1) * TileSize);
+            const int index = tileIndex(tx, ty);
+
+            // Las zonas fuera del mapa de los tiles del borde no importan
+            const bool wholeTile = rowBegin == ty * TileSize && rowEnd == std::min(m_height, (ty + 1) * TileSize)
+                                   && colBegin == tx * TileSize && colEnd == std::min(m_width, (tx + 1) * TileSize);
+            if (wholeTile) {
+                makeUniform(index, level);
+                continue;
+            }
+
+            unsigned char *samples = tileData(index);
+            for (int row = rowBegin; row < rowEnd; ++row) {
+                fillSamples(m_format, samples + (row - ty * TileSize) * tileRowBytes()
+                                          + static_cast<std::size_t>(colBegin - tx * TileSize) * bps,
+                            colEnd - colBegin, level);
+            }
+        }
+    }
+}
+
+float TiledHeightField::level(int x, int y) const
+{
+    const int index = tileIndex(x / TileSize, y / TileSize);
+    const Tile &tile = m_tiles[index];
+    float result;
+
+    if (!tile.materialized) {
+        unsigned char sample[sizeof(float)];
+        fillSamples(m_format, sample, 1, tile.fillLevel);
+        samplesToLevels(m_format, sample, &result, 1);
+        return result;
+    }
+
+    const std::size_t offset = static_cast<std::size_t>((y % TileSize) * TileSize + x % TileSize) * bytesPerSample();
+    samplesToLevels(m_format, tileData(index) + offset, &result, 1);
+    return result;
+}
+
+void TiledHeightField::setLevel(int x, int y, float level)
+{
+    const std::size_t offset = static_cast<std::size_t>((y % TileSize) * TileSize + x % TileSize) * bytesPerSample();
+    fillSamples(m_format, tileData(tileIndex(x / TileSize, y / TileSize)) + offset, 1, level);
+}
+
+void TiledHeightField::rowToU8(int y, unsigned char *out, int step) const
+{
+    rowToU8(y, out, step, 0, m_width);
+}
+
+void TiledHeightField::rowToU8(int y, unsigned char *out, int step, int x0, int x1) const
+{
+    rowToFormat(y, HeightFormat::U8, out, step, x0, x1);
+}
+
+void TiledHeightField::rowToFormat(int y, HeightFormat format, void *out, int step, int x0, int x1) const
+{
+    x0 = std::max(0, x0);
+    x1 = std::min(m_width, x1);
+
+    const int bps = bytesPerSample();
+    const int outBps = ::bytesPerSample(format);
+    unsigned char *dst = static_cast<unsigned char *>(out);
+    forEachRowSegment(y, x0, x1, [&](int x, const unsigned char *samples, const Tile &tile, int count) {
+        // Primera columna de este tramo (recortado a [x0, x1)) que cae en la rejilla de step
+        const int begin = std::max(x, x0);
+        const int end = std::min(x + count, x1);
+        const int first = (begin + step - 1) / step * step;
+        if (first >= end) return;
+
+        unsigned char *target = dst + static_cast<std::size_t>(first / step) * outBps;
+        if (!samples) {
+            unsigned char value[sizeof(float)];
+            uniformSample(m_format, tile.fillLevel, format, value);
+            if (outBps == 1) {
+                std::memset(target, value[0], (end - first + step - 1) / step);
+            } else {
+                replicateSample(value, outBps, target, (end - first + step - 1) / step);
+            }
+        } else if (step == 1) {
+            convertSamples(m_format, samples + static_cast<std::size_t>(first - x) * bps, format,
+                           target, end - first);
+        } else {
+            for (int sx = first; sx < end; sx += step) {
+                convertSamples(m_format, samples + static_cast<std::size_t>(sx - x) * bps,
+                               format, dst + static_cast<std::size_t>(sx / step) * outBps, 1);
+            }
+        }
+    });
+}
+
+void TiledHeightField::rowToLevels(int y, float *out) const
+{
+    forEachRowSegment(y, [&](int x, const unsigned char *samples, const Tile &tile, int count) {
+        if (samples) {
+            samplesToLevels(m_format, samples, out + x, count);
+        } else {
+            float value;
+            unsigned char sample[sizeof(float)];
+            fillSamples(m_format, sample, 1, tile.fillLevel);
+            samplesToLevels(m_format, sample, &value, 1);
+            std::fill_n(out + x, count, value);
+        }
+    });
+}
+
+HeightField TiledHeightField::downsampled(int step) const
+{
+    if (step <= 1) return region(0, 0, m_width, m_height);
+
+    HeightField result((m_width + step - 1) / step, (m_height + step - 1) / step, m_format);
+    const int bps = bytesPerSample();
+    for (int oy = 0; oy < result.height(); ++oy) {
+        unsigned char *dst = result.rowBytes(oy);
+        forEachRowSegment(oy * step, [&](int x, const unsigned char *samples, const Tile &tile, int count) {
+            const int first = (x + step - 1) / step * step;
+            for (int sx = first; sx < x + count; sx += step) {
+                unsigned char *out = dst + static_cast<std::size_t>(sx / step) * bps;
+                if (samples) {
+                    std::memcpy(out, samples + static_cast<std::size_t>(sx - x) * bps, bps);
+                } else {
+                    fillSamples(m_format, out, 1, tile.fillLevel);
+                }
+            }
+        });
+    }
+    return result;
+}
@@ -0,0 +1,193 @@
+#ifndef TILEDHEIGHTFIELD_H
+#define TILEDHEIGHTFIELD_H
+
+#include "heightfield.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <vector>
+
+class SpillFile;
+
+// =================================================================
+// === TILED HEIGHTFIELD
+// =================================================================
+// Mapa de alturas dividido en tiles de TileSize x TileSize muestras,
+// pensado para mapas de hasta MaxSize x MaxSize.
+//
+// - Los mapas que caben en memoryBudget() / 4 viven enteros en RAM.
+// - Los mayores se vuelcan a un archivo temporal proyectado en memoria
+//   y sólo se mantienen proyectados los tiles usados más recientemente
+//   (LRU), hasta memoryBudget() bytes.
+// - Un tile que nunca se ha escrito sólo guarda su nivel de relleno,
+//   así que crear un mapa enorme no cuesta nada.
+//
+// Las lecturas también mueven la caché: un mismo objeto no se puede
+// usar desde varios hilos a la vez.
+
+class TiledHeightField
+{
+public:
+    static constexpr int TileSize = 256;
+    static constexpr int MaxSize = 32768;
+
+    TiledHeightField();
+    TiledHeightField(int width, int height, HeightFormat format = HeightFormat::U8, float level = 0.0f);
+    TiledHeightField(const TiledHeightField &other);
+    TiledHeightField(TiledHeightField &&other) noexcept;
+    TiledHeightField &operator=(const TiledHeightField &other);
+    TiledHeightField &operator=(TiledHeightField &&other) noexcept;
+    ~TiledHeightField();
+
+    // Lanza std::runtime_error si no se puede crear el archivo de volcado
+    void assign(int width, int height, HeightFormat format, float level);
+    void clear();
+    void swap(TiledHeightField &other) noexcept;
+
+    // Cambia la precisión conservando las alturas (en escala de nivel)
+    void convertTo(HeightFormat format);
+
+    HeightFormat format() const { return m_format; }
+    int bytesPerSample() const { return ::bytesPerSample(m_format); }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    bool empty() const { return m_width == 0 || m_height == 0; }
+    bool contains(int x, int y) const { return x >= 0 && x < m_width && y >= 0 && y < m_height; }
+    int tilesX() const { return m_tilesX; }
+    int tilesY() const { return m_tilesY; }
+    // true si los tiles viven en el archivo de volcado
+    bool isSpilled() const { return m_file != nullptr; }
+
+    // Copias rectangulares (recortadas a los límites). readRegion
+    // convierte al formato de dst; writeRegion al del mapa.
+    void readRegion(int x, int y, HeightField &dst) const;
+    HeightField region(int x, int y, int regionWidth, int regionHeight) const;
+    void writeRegion(const HeightField &src, int x, int y);
+    void fillRegion(int x, int y, int regionWidth, int regionHeight, float level);
+
+    // Acceso en escala de nivel (0..255) a una muestra suelta
+    float level(int x, int y) const;
+    void setLevel(int x, int y, float level);
+
+    // Fila y en 8 bits tomando una muestra de cada `step` columnas
+    // (width() / step redondeado hacia arriba); pantalla y vistas generales
+    void rowToU8(int y, unsigned char *out, int step = 1) const;
+    // Igual, pero sólo las columnas de la rejilla en [x0, x1); out tiene
+    // la misma disposición que la fila completa (columna x en out[x / step])
+    void rowToU8(int y, unsigned char *out, int step, int x0, int x1) const;
+    // Igual, convirtiendo a cualquier formato (p. ej. texturas de 16 bits)
+    void rowToFormat(int y, HeightFormat format, void *out, int step, int x0, int x1) const;
+    // Fila y completa en escala de nivel, sin redondear
+    void rowToLevels(int y, float *out) const;
+    // Copia reducida con una muestra de cada step x step
+    HeightField downsampled(int step) const;
+
+    // Acceso tipado a una muestra; T debe ser el tipo del formato
+    template <typename T>
+    T &at(int x, int y)
+    {
+        const int index = tileIndex(x / TileSize, y / TileSize);
+        if (m_writeObserver) m_writeObserver(index);
+        T *tile = reinterpret_cast<T *>(tileData(index));
+        return tile[(y % TileSize) * TileSize + x % TileSize];
+    }
+
+    // Recorre [x0, x1) x [y0, y1) tile a tile con tramos contiguos de
+    // fila: f(int y, int x, T *samples, int count). T debe ser el tipo
+    // del formato; el orden de los tramos no es el de las filas.
+    template <typename T, typename F>
+    void forEachSpan(int x0, int y0, int x1, int y1, F &&f)
+    {
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x1 > m_width) x1 = m_width;
+        if (y1 > m_height) y1 = m_height;
+        if (x1 <= x0 || y1 <= y0) return;
+
+        for (int ty = y0 / TileSize; ty <= (y1 - 1) / TileSize; ++ty) {
+            const int rowBegin = std::max(y0, ty * TileSize);
+            const int rowEnd = std::min(y1, (ty + 1) * TileSize);
+            for (int tx = x0 / TileSize; tx <= (x1 - 1) / TileSize; ++tx) {
+                const int colBegin = std::max(x0, tx * TileSize);
+                const int colEnd = std::min(x1, (tx + 1) * TileSize);
+                if (m_writeObserver) m_writeObserver(tileIndex(tx, ty));
+                T *tile = reinterpret_cast<T *>(tileData(tileIndex(tx, ty)));
+                for (int y = rowBegin; y < rowEnd; ++y) {
+                    f(y, colBegin, tile + (y - ty * TileSize) * TileSize + (colBegin - tx * TileSize),
+                      colEnd - colBegin);
+                }
+            }
+        }
+    }
+
+    // Suelta todos los tiles proyectados (p. ej. en copias de deshacer)
+    void releaseResident() const;
+
+    // === Tiles sueltos (deshacer por tiles) ===
+    // Copia exacta de un tile; los que nunca se han escrito sólo guardan
+    // su nivel de relleno
+    struct TileSnapshot {
+        HeightField samples;        // Vacío si el tile es uniforme
+        float fillLevel = 0.0f;
+
+        std::size_t bytes() const { return samples.sizeInBytes(); }
+    };
+    TileSnapshot saveTile(int index) const;
+    void restoreTile(int index, const TileSnapshot &snapshot);
+    bool tileEquals(int index, const TileSnapshot &snapshot) const;
+    int tileCount() const { return static_cast<int>(m_tiles.size()); }
+    // Muestras que cubre el tile, recortadas al mapa: x, y, ancho, alto
+    void tileBounds(int index, int &x, int &y, int &boundsWidth, int &boundsHeight) const;
+
+    // Observador de escrituras: at() y forEachSpan() no constantes lo
+    // llaman con el índice de cada tile antes de dar acceso a sus
+    // muestras (aunque sólo se vayan a leer). writeRegion, fillRegion,
+    // setLevel y convertTo no avisan. Pertenece al objeto: no se copia
+    // ni se intercambia con swap().
+    using WriteObserver = std::function<void(int tileIndex)>;
+    void setWriteObserver(WriteObserver observer) { m_writeObserver = std::move(observer); }
+
+    // Memoria para tiles residentes, compartida como límite por mapa
+    static void setMemoryBudget(std::size_t bytes);
+    static std::size_t memoryBudget();
+
+private:
+    struct Tile {
+        unsigned char *data = nullptr;      // Muestras si está residente
+        bool materialized = false;          // false: todo el tile vale fillLevel
+        float fillLevel = 0.0f;
+        std::list<int>::iterator lruPos;
+    };
+
+    int tileIndex(int tx, int ty) const { return ty * m_tilesX + tx; }
+    std::size_t tileBytes() const;
+    std::size_t tileRowBytes() const;
+    // Puntero a las muestras del tile, proyectándolo si hace falta. Con
+    // discard no se rellena un tile nuevo porque se va a sobrescribir.
+    unsigned char *tileData(int index, bool discard = false) const;
+    void evictTile(int index) const;
+    void makeUniform(int index, float level);
+    // Tramos de la fila y por tile: f(int x, const unsigned char *samples, const Tile &tile, int count);
+    // samples es nullptr en tiles sin materializar. Sólo se recorren los
+    // tiles que cortan [x0, x1), pero cada tramo es el del tile completo.
+    template <typename F>
+    void forEachRowSegment(int y, F &&f) const { forEachRowSegment(y, 0, m_width, f); }
+    template <typename F>
+    void forEachRowSegment(int y, int x0, int x1, F &&f) const;
+
+    HeightFormat m_format = HeightFormat::U8;
+    int m_width = 0;
+    int m_height = 0;
+    int m_tilesX = 0;
+    int m_tilesY = 0;
+    mutable std::vector<Tile> m_tiles;
+    mutable std::vector<HeightField> m_memoryTiles;    // Almacenamiento en modo RAM
+    std::unique_ptr<SpillFile> m_file;                 // Almacenamiento en modo volcado
+    mutable std::list<int> m_lru;                      // Tiles proyectados, el más reciente delante
+    std::size_t m_maxResident = 0;
+    WriteObserver m_writeObserver;
+};
+
+#endif // TILEDHEIGHTFIELD_H
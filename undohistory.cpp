@@ -0,0 +1,848 @@
+#include "undohistory.h"
+#include <QDir>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace {
+
+using TileList = std::vector<std::pair<int, TiledHeightField::TileSnapshot>>;
+
+constexpr int TileSize = TiledHeightField::TileSize;
+constexpr int TileSamples = TileSize * TileSize;
+
+// Nivel de qCompress: el 1 comprime casi igual las diferencias y es
+// varias veces más rápido que el predeterminado
+constexpr int CompressionLevel = 1;
+
+// Hueco que se tolera en el archivo antes de compactarlo
+constexpr qint64 CompactSlack = qint64(64) * 1024 * 1024;
+
+std::size_t fieldBytes(const TiledHeightField &field)
+{
+    return static_cast<std::size_t>(field.width()) * field.height() * field.bytesPerSample();
+}
+
+std::size_t tileListBytes(const TileList &tiles)
+{
+    std::size_t bytes = 0;
+    for (const auto &tile : tiles) {
+        bytes += tile.second.bytes();
+    }
+    return bytes;
+}
+
+// === Codificación de tiles ===
+// Cada fila se guarda como diferencias entre muestras vecinas (con
+// aritmética modular sobre los bits, así que también vale para float)
+// y los bytes se separan por planos: primero el byte bajo de todas las
+// muestras, luego el siguiente... En terreno suave casi todo son ceros
+// y qCompress los aprovecha mucho mejor que las muestras tal cual.
+
+template <typename U>
+void encodeSamples(const unsigned char *samples, unsigned char *out)
+{
+    for (int y = 0; y < TileSize; ++y) {
+        U previous = 0;
+        for (int x = 0; x < TileSize; ++x) {
+            const int i = y * TileSize + x;
+            U value;
+            std::memcpy(&value, samples + i * sizeof(U), sizeof(U));
+            const U delta = static_cast<U>(value - previous);
+            previous = value;
+            for (std::size_t k = 0; k < sizeof(U); ++k) {
+                out[k * TileSamples + i] = static_cast<unsigned char>(delta >> (8 * k));
+            }
+        }
+    }
+}
+
+template <typename U>
+void decodeSamples(const unsigned char *in, unsigned char *samples)
+{
+    for (int y = 0; y < TileSize; ++y) {
+        U previous = 0;
+        for (int x = 0; x < TileSize; ++x) {
+            const int i = y * TileSize + x;
+            U delta = 0;
+            for (std::size_t k = 0; k < sizeof(U); ++k) {
+                delta |= static_cast<U>(static_cast<U>(in[k * TileSamples + i]) << (8 * k));
+            }
+            previous = static_cast<U>(previous + delta);
+            std::memcpy(samples + i * sizeof(U), &previous, sizeof(U));
+        }
+    }
+}
+
+template <typename T>
+void appendValue(QByteArray &data, T value)
+{
+    data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(const QByteArray &data, qsizetype &pos, T &value)
+{
+    if (pos + static_cast<qsizetype>(sizeof(T)) > data.size()) return false;
+    std::memcpy(&value, data.constData() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+void appendTile(QByteArray &data, int index, const TiledHeightField::TileSnapshot &tile, HeightFormat format)
+{
+    const bool uniform = tile.samples.empty();
+    appendValue<qint32>(data, index);
+    appendValue<quint8>(data, uniform ? 1 : 0);
+    appendValue<float>(data, tile.fillLevel);
+    if (uniform) return;
+
+    const qsizetype pos = data.size();
+    data.resize(pos + static_cast<qsizetype>(TileSamples) * bytesPerSample(format));
+    unsigned char *out = reinterpret_cast<unsigned char *>(data.data()) + pos;
+    switch (format) {
+    case HeightFormat::U8: encodeSamples<quint8>(tile.samples.data(), out); break;
+    case HeightFormat::U16: encodeSamples<quint16>(tile.samples.data(), out); break;
+    case HeightFormat::F32: encodeSamples<quint32>(tile.samples.data(), out); break;
+    }
+}
+
+bool readTile(const QByteArray &data, qsizetype &pos, HeightFormat format, int &index,
+              TiledHeightField::TileSnapshot &tile)
+{
+    qint32 tileIndex = 0;
+    quint8 uniform = 0;
+    float fillLevel = 0.0f;
+    if (!readValue(data, pos, tileIndex) || !readValue(data, pos, uniform) || !readValue(data, pos, fillLevel)) {
+        return false;
+    }
+    index = tileIndex;
+    tile.fillLevel = fillLevel;
+    tile.samples = HeightField();
+    if (uniform) return true;
+
+    const qsizetype size = static_cast<qsizetype>(TileSamples) * bytesPerSample(format);
+    if (pos + size > data.size()) return false;
+    tile.samples = HeightField(TileSize, TileSize, format);
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(data.constData()) + pos;
+    switch (format) {
+    case HeightFormat::U8: decodeSamples<quint8>(in, tile.samples.data()); break;
+    case HeightFormat::U16: decodeSamples<quint16>(in, tile.samples.data()); break;
+    case HeightFormat::F32: decodeSamples<quint32>(in, tile.samples.data()); break;
+    }
+    pos += size;
+    return true;
+}
+
+// Formato: cabecera sin comprimir (tipo: 0 tiles, 1 mapa completo;
+// formato; ancho y alto si es completo; número de tiles) y después los
+// tiles en trozos de hasta PackChunkBytes, cada uno comprimido por
+// separado y precedido de su tamaño. Así ni el paso entero sin comprimir
+// ni una entrada demasiado grande para qCompress llegan a existir.
+
+constexpr qsizetype PackChunkBytes = 4 * 1024 * 1024;
+
+// Lee exactamente size bytes seguidos del paso comprimido
+using ReadBytes = std::function<bool(char *data, qint64 size)>;
+
+template <typename T>
+bool readValue(const ReadBytes &read, T &value)
+{
+    return read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+// false si la compresión falla o el resultado pasaría de maxBytes; el
+// paso se queda entonces sin comprimir
+bool packStep(const TileList &tiles, const TiledHeightField &snapshot, bool full, HeightFormat format,
+              qsizetype maxBytes, QByteArray &packed)
+{
+    packed.clear();
+    appendValue<quint8>(packed, full ? 1 : 0);
+    appendValue<quint8>(packed, static_cast<quint8>(full ? snapshot.format() : format));
+    if (full) {
+        appendValue<qint32>(packed, snapshot.width());
+        appendValue<qint32>(packed, snapshot.height());
+    }
+    const int count = full ? snapshot.tileCount() : static_cast<int>(tiles.size());
+    appendValue<qint32>(packed, count);
+
+    QByteArray chunk;
+    auto flushChunk = [&]() {
+        const QByteArray compressed = qCompress(chunk, CompressionLevel);
+        chunk.clear();
+        if (compressed.isEmpty()) return false;
+        if (packed.size() + static_cast<qsizetype>(sizeof(qint32)) + compressed.size() > maxBytes) return false;
+        appendValue<qint32>(packed, static_cast<qint32>(compressed.size()));
+        packed.append(compressed);
+        return true;
+    };
+
+    bool ok = true;
+    for (int i = 0; i < count && ok; ++i) {
+        if (full) {
+            appendTile(chunk, i, snapshot.saveTile(i), snapshot.format());
+        } else {
+            appendTile(chunk, tiles[i].first, tiles[i].second, format);
+        }
+        if (chunk.size() >= PackChunkBytes || i == count - 1) ok = flushChunk();
+    }
+    // La copia ya no se va a leer: que no retenga tiles proyectados
+    if (full) snapshot.releaseResident();
+
+    if (!ok) packed = QByteArray();
+    return ok;
+}
+
+bool unpackStep(const ReadBytes &read, TileList &tiles, TiledHeightField &snapshot)
+{
+    quint8 full = 0, formatValue = 0;
+    if (!readValue(read, full) || !readValue(read, formatValue)) return false;
+    if (formatValue > static_cast<quint8>(HeightFormat::F32)) return false;
+    const HeightFormat format = static_cast<HeightFormat>(formatValue);
+
+    qint32 width = 0, height = 0, count = 0;
+    if (full && (!readValue(read, width) || !readValue(read, height))) return false;
+    if (!readValue(read, count) || count < 0) return false;
+
+    try {
+        if (full) snapshot = TiledHeightField(width, height, format);
+        if (full && snapshot.tileCount() != count) return false;
+
+        tiles.clear();
+        tiles.reserve(full ? 0 : count);
+        QByteArray data;
+        qsizetype pos = 0;
+        for (int i = 0; i < count; ++i) {
+            // Siguiente trozo cuando se acaba el actual
+            if (pos == data.size()) {
+                qint32 size = 0;
+                if (!readValue(read, size) || size <= 0) return false;
+                QByteArray compressed(size, Qt::Uninitialized);
+                if (!read(compressed.data(), size)) return false;
+                data = qUncompress(compressed);
+                pos = 0;
+            }
+
+            int index = 0;
+            TiledHeightField::TileSnapshot tile;
+            if (!readTile(data, pos, format, index, tile)) return false;
+            if (index < 0 || (full && index >= count)) return false;
+            if (full) {
+                snapshot.restoreTile(index, tile);
+            } else {
+                tiles.emplace_back(index, std::move(tile));
+            }
+        }
+    } catch (const std::exception &) {
+        // Sin sitio para volver a crear el mapa volcado
+        return false;
+    }
+    return true;
+}
+
+QString undoFileTemplate()
+{
+    // Misma carpeta que los mapas volcados (tiledheightfield.cpp)
+    QString dir = qEnvironmentVariable("HEIGHTMAP_SPILL_DIR");
+    if (dir.isEmpty()) dir = QDir::tempPath();
+    return QDir(dir).filePath("heightmap-undo-XXXXXX");
+}
+
+} // namespace
+
+// =================================================================
+// === PACKER
+// =================================================================
+// Hilo que comprime pasos. Cada trabajo se queda con el contenido sin
+// comprimir del paso hasta que el historial recoge el resultado, así
+// que se puede cancelar (o esperar) sin perder nada.
+
+struct UndoHistory::PackJob {
+    TileList tiles;
+    TiledHeightField snapshot;
+    bool full = false;
+    HeightFormat format = HeightFormat::U8;
+    qsizetype maxBytes = 0;     // Tope del resultado
+
+    QByteArray result;          // Vacío si no se pudo comprimir
+    bool started = false;       // Protegidos por el mutex del Packer
+    bool done = false;
+};
+
+class UndoHistory::Packer
+{
+public:
+    Packer() : thread([this] { run(); }) {}
+
+    ~Packer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            queue.clear();
+        }
+        condition.notify_all();
+        thread.join();
+    }
+
+    void submit(const std::shared_ptr<PackJob> &job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(job);
+        }
+        condition.notify_all();
+    }
+
+    bool isDone(const std::shared_ptr<PackJob> &job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return job->done;
+    }
+
+    // Quita el trabajo de la cola si aún no ha empezado. Con wait, si ya
+    // había empezado, espera a que termine.
+    void cancel(const std::shared_ptr<PackJob> &job, bool wait)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!job->started) {
+            queue.erase(std::remove(queue.begin(), queue.end(), job), queue.end());
+            return;
+        }
+        if (wait) condition.wait(lock, [&] { return job->done; });
+    }
+
+    void wait(const std::shared_ptr<PackJob> &job)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&] { return job->done; });
+    }
+
+    void cancelAll()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.clear();
+    }
+
+private:
+    void run()
+    {
+        for (;;) {
+            std::shared_ptr<PackJob> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (stopping) return;
+                job = std::move(queue.front());
+                queue.pop_front();
+                job->started = true;
+            }
+
+            QByteArray result;
+            packStep(job->tiles, job->snapshot, job->full, job->format, job->maxBytes, result);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job->result = std::move(result);
+                job->done = true;
+            }
+            condition.notify_all();
+        }
+    }
+
+    std::deque<std::shared_ptr<PackJob>> queue;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+    std::thread thread;         // El último: arranca con lo demás ya construido
+};
+
+// =================================================================
+// === UNDO HISTORY
+// =================================================================
+
+UndoHistory::UndoHistory() = default;
+
+UndoHistory::~UndoHistory()
+{
+    if (m_open) m_open->setWriteObserver(nullptr);
+}
+
+void UndoHistory::setMemoryBudget(std::size_t bytes)
+{
+    m_budget = bytes;
+    trim();
+}
+
+void UndoHistory::setDiskBudget(std::size_t bytes)
+{
+    m_diskBudget = bytes;
+    trim();
+}
+
+void UndoHistory::begin(TiledHeightField &current)
+{
+    if (m_open) commit();
+
+    m_open = &current;
+    m_openStep = Step();
+    m_openStep.format = current.format();
+    m_openStep.width = current.width();
+    m_openStep.height = current.height();
+    m_captured.assign(current.tileCount(), 0);
+    current.setWriteObserver([this](int index) { captureTile(index); });
+}
+
+void UndoHistory::captureTile(int index)
+{
+    if (index < 0 || index >= static_cast<int>(m_captured.size()) || m_captured[index]) return;
+    m_captured[index] = 1;
+
+    TiledHeightField::TileSnapshot snapshot = m_open->saveTile(index);
+    m_openStep.bytes += snapshot.bytes();
+    m_openStep.tiles.emplace_back(index, std::move(snapshot));
+}
+
+void UndoHistory::commit()
+{
+    if (!m_open) return;
+    m_open->setWriteObserver(nullptr);
+
+    // El observador también salta con accesos de sólo lectura; los tiles
+    // que terminan igual que al copiarlos no entran en el paso
+    Step step = std::move(m_openStep);
+    auto unchanged = [&](const std::pair<int, TiledHeightField::TileSnapshot> &tile) {
+        return m_open->tileEquals(tile.first, tile.second);
+    };
+    step.tiles.erase(std::remove_if(step.tiles.begin(), step.tiles.end(), unchanged), step.tiles.end());
+
+    m_open = nullptr;
+    m_openStep = Step();
+    m_captured.clear();
+    if (step.tiles.empty()) return;
+
+    step.bytes = tileListBytes(step.tiles);
+    push(std::move(step));
+}
+
+void UndoHistory::save(const TiledHeightField &current)
+{
+    commit();
+
+    Step step;
+    step.full = true;
+    step.snapshot = current;
+    step.bytes = fieldBytes(current);
+    push(std::move(step));
+}
+
+void UndoHistory::push(Step &&step)
+{
+    clearRedo();
+    m_used += step.bytes;
+    m_undo.push_back(std::move(step));
+
+    collectPacked();
+    schedulePacking();
+    trim();
+}
+
+void UndoHistory::apply(Step &step, TiledHeightField &current, QRect *dirty)
+{
+    if (step.full) {
+        m_used -= step.bytes;
+
+        TiledHeightField previous = std::move(current);
+        current = std::move(step.snapshot);
+        step.snapshot = std::move(previous);
+        step.bytes = fieldBytes(step.snapshot);
+
+        m_used += step.bytes;
+        if (dirty) *dirty = QRect(0, 0, current.width(), current.height());
+        return;
+    }
+
+    QRect changed;
+    for (auto &tile : step.tiles) {
+        TiledHeightField::TileSnapshot previous = current.saveTile(tile.first);
+        current.restoreTile(tile.first, tile.second);
+
+        m_used = m_used - tile.second.bytes() + previous.bytes();
+        step.bytes = step.bytes - tile.second.bytes() + previous.bytes();
+        tile.second = std::move(previous);
+
+        int x, y, tileWidth, tileHeight;
+        current.tileBounds(tile.first, x, y, tileWidth, tileHeight);
+        changed |= QRect(x, y, tileWidth, tileHeight);
+    }
+    if (dirty) *dirty = changed;
+}
+
+bool UndoHistory::fits(const Step &step, const TiledHeightField &current)
+{
+    // Los tiles sólo encajan en un mapa con la misma rejilla y formato
+    return step.full || (step.width == current.width() && step.height == current.height() &&
+                         step.format == current.format());
+}
+
+bool UndoHistory::undo(TiledHeightField &current, QRect *dirty)
+{
+    commit();
+    collectPacked();
+    if (m_undo.empty()) return false;
+
+    Step step = std::move(m_undo.back());
+    m_undo.pop_back();
+    if (!fits(step, current) || !unpack(step)) {
+        // Sin este paso los anteriores ya no se pueden aplicar
+        release(step);
+        for (Step &older : m_undo) {
+            release(older);
+        }
+        m_undo.clear();
+        return false;
+    }
+    apply(step, current, dirty);
+    m_redo.push_back(std::move(step));
+
+    schedulePacking();
+    trim();
+    return true;
+}
+
+bool UndoHistory::redo(TiledHeightField &current, QRect *dirty)
+{
+    commit();
+    collectPacked();
+    if (m_redo.empty()) return false;
+
+    Step step = std::move(m_redo.back());
+    m_redo.pop_back();
+    if (!fits(step, current) || !unpack(step)) {
+        release(step);
+        clearRedo();
+        return false;
+    }
+    apply(step, current, dirty);
+    m_undo.push_back(std::move(step));
+
+    schedulePacking();
+    trim();
+    return true;
+}
+
+void UndoHistory::clear()
+{
+    if (m_open) m_open->setWriteObserver(nullptr);
+    m_open = nullptr;
+    m_openStep = Step();
+    m_captured.clear();
+
+    if (m_packer) m_packer->cancelAll();
+    m_undo.clear();
+    m_redo.clear();
+    m_used = 0;
+    m_packing = 0;
+
+    m_file.reset();
+    m_fileFailed = false;
+    m_fileEnd = 0;
+    m_fileLive = 0;
+}
+
+void UndoHistory::flush()
+{
+    commit();
+    if (m_packer) {
+        for (Step &step : m_undo) {
+            if (step.packing) m_packer->wait(step.packing);
+        }
+        for (Step &step : m_redo) {
+            if (step.packing) m_packer->wait(step.packing);
+        }
+    }
+    collectPacked();
+    trim();
+}
+
+void UndoHistory::clearRedo()
+{
+    for (Step &step : m_redo) {
+        release(step);
+    }
+    m_redo.clear();
+}
+
+bool UndoHistory::dropFarthest()
+{
+    if (m_undo.size() > 1 || (!m_undo.empty() && !m_redo.empty())) {
+        release(m_undo.front());
+        m_undo.pop_front();
+        return true;
+    }
+    if (m_redo.size() > 1) {
+        release(m_redo.front());
+        m_redo.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void UndoHistory::release(Step &step)
+{
+    if (step.packing) {
+        m_packer->cancel(step.packing, false);
+        step.packing.reset();
+        --m_packing;
+    }
+    if (step.fileOffset >= 0) {
+        m_fileLive -= step.fileSize;
+        step.fileOffset = -1;
+        if (m_fileLive == 0) {
+            // Vacío: se vuelve a escribir desde el principio
+            m_fileEnd = 0;
+            if (m_file) m_file->resize(0);
+        }
+    }
+    m_used -= step.bytes;
+    step.bytes = 0;
+}
+
+void UndoHistory::schedulePacking()
+{
+    schedulePacking(m_undo);
+    schedulePacking(m_redo);
+}
+
+void UndoHistory::schedulePacking(std::deque<Step> &steps)
+{
+    // Los pasos más lejanos ya se mandaron en llamadas anteriores: se
+    // para en el primero que no está sin comprimir
+    for (int i = static_cast<int>(steps.size()) - 1 - RecentSteps; i >= 0; --i) {
+        if (steps[i].keepRaw) continue;
+        if (!steps[i].raw() || !schedulePacking(steps[i])) break;
+    }
+}
+
+bool UndoHistory::schedulePacking(Step &step)
+{
+    if (!m_packer) m_packer.reset(new Packer());
+
+    // Comprimido no debe ocupar más RAM que sin comprimir; una copia de
+    // un mapa volcado ya está en disco y sólo tiene el presupuesto
+    const std::size_t maxBytes = step.full && step.snapshot.isSpilled() ? m_budget : step.bytes;
+
+    auto job = std::make_shared<PackJob>();
+    job->maxBytes = static_cast<qsizetype>(std::min<std::size_t>(maxBytes, std::numeric_limits<qsizetype>::max()));
+    job->tiles = std::move(step.tiles);
+    job->snapshot = std::move(step.snapshot);
+    job->full = step.full;
+    job->format = step.format;
+    step.tiles.clear();
+    step.packing = job;
+    ++m_packing;
+    m_packer->submit(job);
+    return true;
+}
+
+void UndoHistory::collectPacked()
+{
+    if (m_packing == 0) return;
+    for (Step &step : m_undo) {
+        if (step.packing) collectPacked(step);
+    }
+    for (Step &step : m_redo) {
+        if (step.packing) collectPacked(step);
+    }
+}
+
+void UndoHistory::collectPacked(Step &step)
+{
+    if (!m_packer->isDone(step.packing)) return;
+
+    if (step.packing->result.isEmpty()) {
+        // No se pudo comprimir: el paso recupera su contenido y ya no se
+        // vuelve a intentar
+        step.tiles = std::move(step.packing->tiles);
+        step.snapshot = std::move(step.packing->snapshot);
+        step.keepRaw = true;
+        step.packing.reset();
+        --m_packing;
+        return;
+    }
+
+    // El trabajo se lleva con él el contenido sin comprimir
+    step.packed = std::move(step.packing->result);
+    step.packing.reset();
+    --m_packing;
+
+    m_used -= step.bytes;
+    step.bytes = static_cast<std::size_t>(step.packed.size());
+    m_used += step.bytes;
+}
+
+bool UndoHistory::unpack(Step &step)
+{
+    if (step.packing) {
+        // Si aún no había empezado se cancela; si no, se espera. En los
+        // dos casos el contenido sigue en el trabajo.
+        m_packer->cancel(step.packing, true);
+        step.tiles = std::move(step.packing->tiles);
+        step.snapshot = std::move(step.packing->snapshot);
+        step.packing.reset();
+        --m_packing;
+        return true;
+    }
+
+    bool ok;
+    if (step.fileOffset >= 0) {
+        // Se lee del archivo trozo a trozo
+        qint64 left = step.fileSize;
+        ok = m_file && m_file->seek(step.fileOffset)
+             && unpackStep([&](char *data, qint64 size) {
+                    if (size > left || m_file->read(data, size) != size) return false;
+                    left -= size;
+                    return true;
+                }, step.tiles, step.snapshot);
+        release(step);
+    } else if (!step.packed.isEmpty()) {
+        const QByteArray packed = std::move(step.packed);
+        step.packed = QByteArray();
+        release(step);
+        qsizetype pos = 0;
+        ok = unpackStep([&](char *data, qint64 size) {
+            if (size > packed.size() - pos) return false;
+            std::memcpy(data, packed.constData() + pos, size);
+            pos += size;
+            return true;
+        }, step.tiles, step.snapshot);
+    } else {
+        return true;
+    }
+
+    if (!ok) return false;
+    step.bytes = step.full ? fieldBytes(step.snapshot) : tileListBytes(step.tiles);
+    m_used += step.bytes;
+    return true;
+}
+
+bool UndoHistory::spill(Step &step)
+{
+    if (!m_file) {
+        m_file.reset(new QTemporaryFile(undoFileTemplate()));
+        if (!m_file->open()) {
+            m_file.reset();
+            m_fileFailed = true;
+            return false;
+        }
+        m_fileEnd = 0;
+    }
+    if (m_fileEnd - m_fileLive > CompactSlack && m_fileEnd > 2 * m_fileLive) compactFile();
+
+    const qint64 size = step.packed.size();
+    if (!m_file->seek(m_fileEnd) || m_file->write(step.packed) != size) {
+        m_fileFailed = true;
+        return false;
+    }
+
+    m_used -= step.bytes;
+    step.bytes = 0;
+    step.packed = QByteArray();
+    step.fileOffset = m_fileEnd;
+    step.fileSize = size;
+    m_fileEnd += size;
+    m_fileLive += size;
+    return true;
+}
+
+void UndoHistory::compactFile()
+{
+    // Los huecos son de pasos descartados o ya leídos: se copian los
+    // vivos a un archivo nuevo, en el mismo orden
+    std::unique_ptr<QTemporaryFile> file(new QTemporaryFile(undoFileTemplate()));
+    if (!file->open()) return;
+
+    std::vector<Step *> spilled;
+    for (Step &step : m_undo) {
+        if (step.fileOffset >= 0) spilled.push_back(&step);
+    }
+    for (Step &step : m_redo) {
+        if (step.fileOffset >= 0) spilled.push_back(&step);
+    }
+
+    // Se copia por bloques, sin cargar ningún paso entero
+    std::vector<qint64> offsets;
+    offsets.reserve(spilled.size());
+    qint64 end = 0;
+    for (Step *step : spilled) {
+        if (!m_file->seek(step->fileOffset)) return;
+        for (qint64 copied = 0; copied < step->fileSize;) {
+            const QByteArray block = m_file->read(std::min<qint64>(PackChunkBytes, step->fileSize - copied));
+            if (block.isEmpty() || file->write(block) != block.size()) return;
+            copied += block.size();
+        }
+        offsets.push_back(end);
+        end += step->fileSize;
+    }
+
+    for (std::size_t i = 0; i < spilled.size(); ++i) {
+        spilled[i]->fileOffset = offsets[i];
+    }
+    m_file = std::move(file);
+    m_fileEnd = end;
+}
+
+void UndoHistory::trim()
+{
+    // RAM: se vuelcan los pasos comprimidos, los más lejanos primero. Si
+    // no basta y quedan pasos comprimiéndose, se espera al más lejano:
+    // editar sólo se frena si va más deprisa que la compresión.
+    while (m_used > m_budget) {
+        if (!m_fileFailed) spillFarthest();
+        if (m_used <= m_budget) break;
+
+        Step *pending = farthestPacking();
+        if (!pending) break;
+        m_packer->wait(pending->packing);
+        collectPacked(*pending);
+    }
+
+    // Sin archivo sólo queda descartar
+    if (m_fileFailed) {
+        while (m_used > m_budget && dropFarthest()) {
+        }
+    }
+    while (static_cast<std::size_t>(m_fileLive) > m_diskBudget && dropFarthest()) {
+    }
+}
+
+void UndoHistory::spillFarthest()
+{
+    for (Step &step : m_undo) {
+        if (m_used <= m_budget || m_fileFailed) return;
+        if (!step.packed.isEmpty()) spill(step);
+    }
+    for (Step &step : m_redo) {
+        if (m_used <= m_budget || m_fileFailed) return;
+        if (!step.packed.isEmpty()) spill(step);
+    }
+}
+
+UndoHistory::Step *UndoHistory::farthestPacking()
+{
+    if (m_packing == 0) return nullptr;
+    for (Step &step : m_undo) {
+        if (step.packing) return &step;
+    }
+    for (Step &step : m_redo) {
+        if (step.packing) return &step;
+    }
+    return nullptr;
+}
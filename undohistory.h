@@ -0,0 +1,171 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include "tiledheightfield.h"
+#include <QByteArray>
+#include <QRect>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class QTemporaryFile;
+
+// =================================================================
+// === UNDO HISTORY
+// =================================================================
+// Historial de deshacer/rehacer del mapa de alturas. Hay dos tipos de
+// paso:
+//
+// - Por tiles (begin() ... commit()): mientras el paso está abierto se
+//   observan las escrituras del mapa y cada tile se copia antes de su
+//   primera modificación; al cerrarlo se descartan los que quedaron
+//   iguales. Deshacer y rehacer intercambian sólo esos tiles, así que
+//   cuestan lo que la edición y no lo que el mapa.
+// - Completos (save()): copia del mapa entero, para cambios de formato.
+//
+// Salvo los RecentSteps más cercanos de cada lado, los pasos se
+// comprimen en un hilo aparte (diferencias por fila + qCompress, en
+// trozos acotados), así que cerrar un paso no espera a la compresión.
+// Un paso que no se puede comprimir, o que comprimido ocuparía más RAM
+// que sin comprimir (en copias de mapas volcados, más que
+// memoryBudget()), se queda como estaba. Cuando la RAM usada
+// supera memoryBudget(), los pasos comprimidos más antiguos pasan a un
+// archivo temporal; deshacer o rehacer uno de ellos lo lee y lo
+// descomprime en ese momento. Sólo si la compresión va por detrás y no
+// queda RAM, cerrar un paso espera a la pendiente.
+//
+// Sólo se descartan pasos (los más antiguos) cuando el archivo supera
+// diskBudget() o si no se puede crear. Los pasos recientes se
+// conservan aunque no quepan.
+
+class UndoHistory
+{
+public:
+    static constexpr int RecentSteps = 2;
+    static constexpr std::size_t DefaultMemoryBudget = std::size_t(256) * 1024 * 1024;
+    // 8 GB (2 GB donde size_t es de 32 bits)
+    static constexpr std::size_t DefaultDiskBudget =
+        sizeof(std::size_t) >= 8 ? std::size_t(8) * 1024 * 1024 * 1024 : std::size_t(2) * 1024 * 1024 * 1024;
+
+    UndoHistory();
+    UndoHistory(const UndoHistory &) = delete;
+    UndoHistory &operator=(const UndoHistory &) = delete;
+    ~UndoHistory();
+
+    // Límite de RAM para los pasos guardados
+    void setMemoryBudget(std::size_t bytes);
+    std::size_t memoryBudget() const { return m_budget; }
+    // Límite del archivo de pasos volcados
+    void setDiskBudget(std::size_t bytes);
+    std::size_t diskBudget() const { return m_diskBudget; }
+    // Bytes que ocupan ahora los pasos guardados, en RAM y en disco
+    std::size_t memoryUsed() const { return m_used; }
+    std::size_t diskUsed() const { return static_cast<std::size_t>(m_fileLive); }
+
+    // Abre un paso por tiles sobre current, que debe seguir vivo y sin
+    // cambiar de tamaño ni de formato hasta commit(). Si había otro
+    // abierto, lo cierra antes.
+    void begin(TiledHeightField &current);
+    // Cierra el paso abierto; si no cambió nada, no se guarda y rehacer
+    // se conserva
+    void commit();
+    bool isOpen() const { return m_open != nullptr; }
+
+    // Guarda el mapa entero antes de modificarlo y vacía rehacer.
+    // Lanza std::runtime_error si no se puede copiar un mapa volcado.
+    void save(const TiledHeightField &current);
+    // Aplican a current el paso anterior/siguiente; false si no hay. En
+    // dirty (si no es nulo) queda la zona del mapa que cambió. Un paso
+    // por tiles de un mapa de otro tamaño o formato no se aplica: se
+    // descarta con los que dependen de él y devuelve false.
+    bool undo(TiledHeightField &current, QRect *dirty = nullptr);
+    bool redo(TiledHeightField &current, QRect *dirty = nullptr);
+    void clear();
+
+    bool canUndo() const { return !m_undo.empty(); }
+    bool canRedo() const { return !m_redo.empty(); }
+    int undoSteps() const { return static_cast<int>(m_undo.size()); }
+
+    // Espera a que termine la compresión pendiente y aplica el
+    // presupuesto (para medir o antes de consultar memoryUsed())
+    void flush();
+
+private:
+    class Packer;
+    struct PackJob;
+
+    // Un paso está en uno de estos estados: sin comprimir (tiles o
+    // snapshot), comprimiéndose (packing), comprimido en RAM (packed)
+    // o volcado (fileOffset >= 0)
+    struct Step {
+        std::vector<std::pair<int, TiledHeightField::TileSnapshot>> tiles;
+        TiledHeightField snapshot;      // Sólo en pasos completos
+        bool full = false;
+        HeightFormat format = HeightFormat::U8;    // De los tiles
+        int width = 0;                  // Mapa del que salen los tiles
+        int height = 0;
+        std::shared_ptr<PackJob> packing;
+        QByteArray packed;
+        qint64 fileOffset = -1;
+        qint64 fileSize = 0;
+        std::size_t bytes = 0;          // RAM que ocupa
+        bool keepRaw = false;           // La compresión falló: no se reintenta
+
+        bool raw() const { return !packing && packed.isEmpty() && fileOffset < 0; }
+    };
+
+    // Intercambia el contenido del paso con el de current: después el
+    // paso guarda el estado que se acaba de quitar (para el sentido
+    // contrario)
+    void apply(Step &step, TiledHeightField &current, QRect *dirty);
+    static bool fits(const Step &step, const TiledHeightField &current);
+    void captureTile(int index);
+    void push(Step &&step);
+    void clearRedo();
+    // Descarta el paso más lejano (deshacer más antiguo o rehacer más
+    // lejano); false si sólo queda uno
+    bool dropFarthest();
+    // Descuenta el paso de la memoria, la cola de compresión y el archivo
+    void release(Step &step);
+
+    // Compresión y volcado
+    // Manda a comprimir los pasos sin comprimir lejos del actual
+    void schedulePacking();
+    void schedulePacking(std::deque<Step> &steps);
+    bool schedulePacking(Step &step);
+    // Recoge lo que ya ha comprimido el hilo
+    void collectPacked();
+    void collectPacked(Step &step);
+    // Deja el paso sin comprimir, esperando o leyendo lo que haga falta;
+    // false si no se puede leer del archivo
+    bool unpack(Step &step);
+    bool spill(Step &step);
+    // Vuelca pasos comprimidos, los más lejanos primero, hasta cumplir
+    // el presupuesto de RAM
+    void spillFarthest();
+    Step *farthestPacking();
+    void compactFile();
+    // Vuelca o descarta pasos hasta cumplir los presupuestos
+    void trim();
+
+    std::deque<Step> m_undo;        // El más antiguo delante
+    std::deque<Step> m_redo;        // El siguiente a rehacer detrás
+    std::size_t m_budget = DefaultMemoryBudget;
+    std::size_t m_diskBudget = DefaultDiskBudget;
+    std::size_t m_used = 0;
+    int m_packing = 0;              // Pasos comprimiéndose
+
+    std::unique_ptr<Packer> m_packer;
+    std::unique_ptr<QTemporaryFile> m_file;
+    bool m_fileFailed = false;      // No se pudo crear: se descarta en vez de volcar
+    qint64 m_fileEnd = 0;           // Final escrito del archivo
+    qint64 m_fileLive = 0;          // Bytes de pasos que siguen volcados
+
+    TiledHeightField *m_open = nullptr;
+    Step m_openStep;
+    std::vector<unsigned char> m_captured;  // Tiles ya copiados en el paso abierto
+};
+
+#endif // UNDOHISTORY_H